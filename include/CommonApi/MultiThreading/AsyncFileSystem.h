@@ -0,0 +1,32 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+#include "CommonApi/MultiThreading/FileSystem.h"
+#include "CommonApi/MultiThreading/ThreadPools/Coroutine.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace MultiThreading
+{
+    // Awaitable versions of the FileSystem reads. The read blocks a worker of ioPool, a pool set
+    // aside for blocking calls, while the awaiting coroutine's own worker moves on to other tasks.
+    // Errors are rethrown by the co_await.
+    class AsyncFileSystem
+    {
+    public:
+        static inline auto readFileText(MinimalThreadPool& ioPool, std::string path) {
+            return offload(ioPool, [path = std::move(path)]() { return FileSystem::readFileText(path); });
+        }
+
+        static inline auto readFileBinary(MinimalThreadPool& ioPool, std::string path) {
+            return offload(ioPool, [path = std::move(path)]() { return FileSystem::readFileBinary(path); });
+        }
+
+        static inline auto readFileBinaryRange(MinimalThreadPool& ioPool, std::string path, size_t offset, size_t length) {
+            return offload(ioPool, [path = std::move(path), offset, length]() {
+                return FileSystem::readFileBinaryRange(path, offset, length);
+            });
+        }
+    };
+}
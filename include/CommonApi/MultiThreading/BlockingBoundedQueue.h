@@ -0,0 +1,170 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+#include "CommonApi/MultiThreading/BoundedQueue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <thread>
+#include <utility>
+
+namespace MultiThreading
+{
+    // BoundedQueue with blocking push and pop. Both stay lock-free while the queue is neither full nor
+    // empty, a thread only parks on an event count once it found the queue full or empty s_retryCount
+    // times in a row, and the other side only pays for a notify while someone is parked. A woken thread
+    // gets the full retry budget again, since another thread often takes the slot it was woken for.
+    // close() wakes everyone and fails later pushes.
+    template <typename T>
+    class BlockingBoundedQueue
+    {
+    private:
+        static constexpr int s_retryCount = 16;
+
+        // Waiters read the epoch, announce themselves and check the queue once more before waiting on it
+        struct alignas(64) EventCount {
+            std::atomic<uint32_t> epoch = 0;
+            std::atomic<uint32_t> waiterCount = 0;
+
+            // Pairs with the fence in wait, either we see the waiter or it sees our change to the queue
+            inline void notify(size_t count) {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (waiterCount.load(std::memory_order_relaxed) == 0) return;
+                epoch.fetch_add(1, std::memory_order_release);
+                if (count == 1) epoch.notify_one();
+                else epoch.notify_all();
+            }
+
+            inline void notifyAll() {
+                epoch.fetch_add(1, std::memory_order_release);
+                epoch.notify_all();
+            }
+
+            // Parks until notified unless ready() already holds after announcing
+            template<typename Ready>
+            inline void wait(Ready&& ready) {
+                uint32_t observed = epoch.load(std::memory_order_acquire);
+                waiterCount.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!ready()) epoch.wait(observed, std::memory_order_acquire);
+                waiterCount.fetch_sub(1, std::memory_order_relaxed);
+            }
+        };
+
+        BoundedQueue<T> m_queue;
+        std::atomic<bool> m_closed = false;
+        EventCount m_notEmpty;
+        EventCount m_notFull;
+
+    public:
+        explicit BlockingBoundedQueue(size_t capacity) : m_queue(capacity) {}
+
+        BlockingBoundedQueue(const BlockingBoundedQueue&) = delete;
+        BlockingBoundedQueue& operator=(const BlockingBoundedQueue&) = delete;
+
+        bool tryPush(const T& value) {
+            if (m_closed.load(std::memory_order_relaxed) || !m_queue.tryPush(value)) return false;
+            m_notEmpty.notify(1);
+            return true;
+        }
+
+        bool tryPush(T&& value) {
+            if (m_closed.load(std::memory_order_relaxed) || !m_queue.tryPush(std::move(value))) return false;
+            m_notEmpty.notify(1);
+            return true;
+        }
+
+        bool tryPop(T& value) {
+            if (!m_queue.tryPop(value)) return false;
+            m_notFull.notify(1);
+            return true;
+        }
+
+        // Blocks while the queue is full, false once the queue is closed
+        bool push(T value) {
+            for (int retry = 0; !m_closed.load(std::memory_order_relaxed); ++retry) {
+                if (m_queue.tryPush(std::move(value))) {
+                    m_notEmpty.notify(1);
+                    return true;
+                }
+                if (retry < s_retryCount) std::this_thread::yield();
+                else {
+                    m_notFull.wait([this]() { return m_queue.sizeApprox() < m_queue.capacity() || m_closed.load(std::memory_order_relaxed); });
+                    retry = 0;
+                }
+            }
+            return false;
+        }
+
+        // Blocks while the queue is empty, false once the queue is closed and drained
+        bool pop(T& value) {
+            for (int retry = 0;; ++retry) {
+                if (m_queue.tryPop(value)) {
+                    m_notFull.notify(1);
+                    return true;
+                }
+                if (m_closed.load(std::memory_order_acquire) && m_queue.emptyApprox()) return false;
+                if (retry < s_retryCount) std::this_thread::yield();
+                else {
+                    m_notEmpty.wait([this]() { return !m_queue.emptyApprox() || m_closed.load(std::memory_order_relaxed); });
+                    retry = 0;
+                }
+            }
+        }
+
+        // Pushes all count elements, blocking whenever the queue is full. Returns how many were
+        // pushed, fewer than count only if the queue was closed.
+        template<typename Iterator>
+        size_t pushN(Iterator first, size_t count) {
+            size_t pushed = 0;
+            for (int retry = 0; pushed < count && !m_closed.load(std::memory_order_relaxed); ++retry) {
+                size_t batch = m_queue.pushN(first, count - pushed);
+                if (batch > 0) {
+                    std::advance(first, batch);
+                    pushed += batch;
+                    m_notEmpty.notify(batch);
+                    retry = 0;
+                }
+                else if (retry < s_retryCount) std::this_thread::yield();
+                else {
+                    m_notFull.wait([this]() { return m_queue.sizeApprox() < m_queue.capacity() || m_closed.load(std::memory_order_relaxed); });
+                    retry = 0;
+                }
+            }
+            return pushed;
+        }
+
+        // Blocks until at least one element is available and pops up to maxCount of them.
+        // Returns 0 only once the queue is closed and drained.
+        template<typename OutputIterator>
+        size_t popN(OutputIterator output, size_t maxCount) {
+            if (maxCount == 0) return 0;
+            for (int retry = 0;; ++retry) {
+                size_t popped = m_queue.popN(output, maxCount);
+                if (popped > 0) {
+                    m_notFull.notify(popped);
+                    return popped;
+                }
+                if (m_closed.load(std::memory_order_acquire) && m_queue.emptyApprox()) return 0;
+                if (retry < s_retryCount) std::this_thread::yield();
+                else {
+                    m_notEmpty.wait([this]() { return !m_queue.emptyApprox() || m_closed.load(std::memory_order_relaxed); });
+                    retry = 0;
+                }
+            }
+        }
+
+        // Fails every later push and wakes all waiters, pops keep draining what is queued
+        void close() {
+            m_closed.store(true, std::memory_order_release);
+            m_notEmpty.notifyAll();
+            m_notFull.notifyAll();
+        }
+
+        inline bool isClosed() const { return m_closed.load(std::memory_order_acquire); }
+        inline size_t capacity() const { return m_queue.capacity(); }
+        inline size_t sizeApprox() const { return m_queue.sizeApprox(); }
+        inline bool emptyApprox() const { return m_queue.emptyApprox(); }
+    };
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace MultiThreading
+{
+    // Lock-free bounded multi-producer multi-consumer queue (Vyukov's array queue).
+    // Every cell carries a sequence number telling producers and consumers whose turn it is,
+    // so tryPush/tryPop are a single CAS on the enqueue or dequeue position plus a store.
+    // Cells are cache-line padded so neighbouring producers and consumers do not false share.
+    // Capacity is rounded up to a power of two and fixed at construction.
+    template <typename T>
+    class BoundedQueue
+    {
+    private:
+        static constexpr size_t s_cacheLine = 64;
+
+        struct alignas(s_cacheLine) Cell {
+            std::atomic<size_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+
+            inline T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+        };
+
+        std::unique_ptr<Cell[]> m_cells;
+        size_t m_mask;
+        alignas(s_cacheLine) std::atomic<size_t> m_enqueuePosition = 0;
+        alignas(s_cacheLine) std::atomic<size_t> m_dequeuePosition = 0;
+
+        static size_t roundCapacity(size_t capacity) {
+            size_t rounded = 2;
+            while (rounded < capacity) rounded <<= 1;
+            return rounded;
+        }
+
+    public:
+        explicit BoundedQueue(size_t capacity) :
+            m_cells(new Cell[roundCapacity(capacity)]), m_mask(roundCapacity(capacity) - 1) {
+            for (size_t i = 0; i <= m_mask; ++i) m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+        BoundedQueue(BoundedQueue&&) = delete;
+        BoundedQueue& operator=(BoundedQueue&&) = delete;
+
+        ~BoundedQueue() {
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                size_t end = m_enqueuePosition.load(std::memory_order_relaxed);
+                for (size_t position = m_dequeuePosition.load(std::memory_order_relaxed); position != end; ++position)
+                    m_cells[position & m_mask].value()->~T();
+            }
+        }
+
+        // Returns false without constructing anything when the queue is full
+        template<typename... Args>
+        bool tryEmplace(Args&&... args) {
+            size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true) {
+                cell = &m_cells[position & m_mask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                if (difference == 0) {
+                    if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                }
+                else if (difference < 0) return false;
+                else position = m_enqueuePosition.load(std::memory_order_relaxed);
+            }
+            new (cell->storage) T(std::forward<Args>(args)...);
+            cell->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        inline bool tryPush(const T& value) { return tryEmplace(value); }
+        inline bool tryPush(T&& value) { return tryEmplace(std::move(value)); }
+
+        // Returns false when the queue is empty, or when the oldest element is still being written
+        bool tryPop(T& value) {
+            size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true) {
+                cell = &m_cells[position & m_mask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+                if (difference == 0) {
+                    if (m_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+                }
+                else if (difference < 0) return false;
+                else position = m_dequeuePosition.load(std::memory_order_relaxed);
+            }
+            value = std::move(*cell->value());
+            cell->value()->~T();
+            cell->sequence.store(position + m_mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Pushes up to count elements constructed from first, first + 1, ... with a single CAS for the whole
+        // batch, returns how many fit. Like tryEmplace the element constructor must not throw, a claimed
+        // cell that is never published stalls the consumers behind it.
+        template<typename Iterator>
+        size_t pushN(Iterator first, size_t count) {
+            if (count == 0) return 0;
+            size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+            size_t claimed;
+            while (true) {
+                claimed = 0;
+                while (claimed < count && claimed <= m_mask &&
+                    m_cells[(position + claimed) & m_mask].sequence.load(std::memory_order_acquire) == position + claimed)
+                    ++claimed;
+                if (claimed > 0) {
+                    if (m_enqueuePosition.compare_exchange_weak(position, position + claimed, std::memory_order_relaxed)) break;
+                    continue;
+                }
+                size_t sequence = m_cells[position & m_mask].sequence.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position) < 0) return 0;
+                position = m_enqueuePosition.load(std::memory_order_relaxed);
+            }
+
+            for (size_t i = 0; i < claimed; ++i, ++first) {
+                Cell& cell = m_cells[(position + i) & m_mask];
+                new (cell.storage) T(*first);
+                cell.sequence.store(position + i + 1, std::memory_order_release);
+            }
+            return claimed;
+        }
+
+        // Moves up to maxCount elements to output with a single CAS for the whole batch, returns how many
+        template<typename OutputIterator>
+        size_t popN(OutputIterator output, size_t maxCount) {
+            if (maxCount == 0) return 0;
+            size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+            size_t claimed;
+            while (true) {
+                claimed = 0;
+                while (claimed < maxCount && claimed <= m_mask &&
+                    m_cells[(position + claimed) & m_mask].sequence.load(std::memory_order_acquire) == position + claimed + 1)
+                    ++claimed;
+                if (claimed > 0) {
+                    if (m_dequeuePosition.compare_exchange_weak(position, position + claimed, std::memory_order_relaxed)) break;
+                    continue;
+                }
+                size_t sequence = m_cells[position & m_mask].sequence.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1) < 0) return 0;
+                position = m_dequeuePosition.load(std::memory_order_relaxed);
+            }
+
+            for (size_t i = 0; i < claimed; ++i, ++output) {
+                Cell& cell = m_cells[(position + i) & m_mask];
+                *output = std::move(*cell.value());
+                cell.value()->~T();
+                cell.sequence.store(position + i + m_mask + 1, std::memory_order_release);
+            }
+            return claimed;
+        }
+
+        inline size_t capacity() const { return m_mask + 1; }
+
+        // Racy snapshot, exact only while no other thread pushes or pops
+        inline size_t sizeApprox() const {
+            size_t dequeuePosition = m_dequeuePosition.load(std::memory_order_relaxed);
+            size_t enqueuePosition = m_enqueuePosition.load(std::memory_order_relaxed);
+            return enqueuePosition > dequeuePosition ? enqueuePosition - dequeuePosition : 0;
+        }
+
+        inline bool emptyApprox() const { return sizeApprox() == 0; }
+    };
+}
@@ -0,0 +1,477 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace MultiThreading
+{
+    // Hash map split into shards, each an open-addressing table behind its own mutex and sequence counter.
+    // Writers lock the shard and keep the counter odd while they change it, readers probe without locking
+    // and retry if the counter moved, falling back to the mutex after a few tries. Entries are immutable
+    // nodes published with one pointer store, so a reader never sees a half-built key or value.
+    // A full shard grows into a new table and later writes move a few slots of the old one at a time,
+    // lookups check both tables until the move is done.
+    //
+    // Erased or replaced nodes and outgrown tables are retired instead of freed since a reader may still
+    // be looking at them. Lock-free readers mark themselves in one of a few reader slots for the length
+    // of a lookup. Every s_reclaimBatch retirements a shard notes which slots are busy and frees the batch
+    // once those readers have left, so memory stays bounded however often keys are replaced.
+    // A reference returned by the map stays valid until its key is erased or assigned, or the map is cleared.
+    template<typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+    class ConcurrentHashMap
+    {
+    private:
+        static constexpr size_t s_minTableSize = 16;
+        static constexpr size_t s_migrationStep = 64;
+        static constexpr int s_optimisticAttempts = 4;
+        static constexpr size_t s_readerSlotAttempts = 4;
+        static constexpr size_t s_reclaimBatch = 64;
+
+        struct Node {
+            uint64_t hash;
+            Key key;
+            Value value;
+
+            template<typename... Args>
+            Node(uint64_t hash, const Key& key, Args&&... args) :
+                hash(hash), key(key), value(std::forward<Args>(args)...) {}
+        };
+
+        struct Table {
+            size_t mask;
+            std::unique_ptr<std::atomic<Node*>[]> slots;
+
+            explicit Table(size_t size) : mask(size - 1), slots(std::make_unique<std::atomic<Node*>[]>(size)) {}
+            inline size_t size() const { return mask + 1; }
+        };
+
+        struct alignas(64) Shard {
+            std::mutex mutex;
+            // Odd while a writer changes the tables
+            std::atomic<uint64_t> sequence = 0;
+            std::atomic<Table*> current = nullptr;
+            // Being moved into current, slots below migrated are done
+            std::atomic<Table*> previous = nullptr;
+            size_t migrated = 0;
+            // Nodes and tombstones in current
+            size_t used = 0;
+            std::atomic<size_t> count = 0;
+            std::vector<Node*> retiredNodes;
+            std::vector<Table*> retiredTables;
+            // Retired before the last look at the reader slots, freed once the readers seen then have left
+            std::vector<Node*> pendingNodes;
+            std::vector<Table*> pendingTables;
+            std::vector<std::pair<size_t, uint64_t>> pendingReaders;
+        };
+
+        // Even while free, odd while a reader is inside
+        struct alignas(64) ReaderSlot {
+            std::atomic<uint64_t> version = 0;
+        };
+
+        // Keeps the sequence odd for its lifetime, the shard mutex must be held
+        class WriteSection {
+        private:
+            Shard& m_shard;
+
+        public:
+            explicit WriteSection(Shard& shard) : m_shard(shard) {
+                shard.sequence.store(shard.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+            }
+
+            ~WriteSection() {
+                m_shard.sequence.store(m_shard.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            WriteSection(const WriteSection&) = delete;
+            WriteSection& operator=(const WriteSection&) = delete;
+        };
+
+        // Takes a free reader slot for its lifetime. Nothing retired after that is freed until the
+        // slot is left. If the slots tried are all taken entered() is false and the reader must lock.
+        class ReadSection {
+        private:
+            ReaderSlot* m_slot = nullptr;
+            uint64_t m_version = 0;
+
+        public:
+            explicit ReadSection(const ConcurrentHashMap& map) {
+                size_t first = threadIndex();
+                for (size_t i = 0; i < s_readerSlotAttempts; ++i) {
+                    ReaderSlot& slot = map.m_readers[(first + i) & map.m_readerMask];
+                    uint64_t version = slot.version.load(std::memory_order_relaxed);
+                    if ((version & 1) || !slot.version.compare_exchange_strong(version, version + 1, std::memory_order_seq_cst,
+                        std::memory_order_relaxed)) continue;
+                    m_slot = &slot;
+                    m_version = version + 2;
+                    return;
+                }
+            }
+
+            ~ReadSection() {
+                if (m_slot) m_slot->version.store(m_version, std::memory_order_release);
+            }
+
+            inline bool entered() const { return m_slot != nullptr; }
+
+            ReadSection(const ReadSection&) = delete;
+            ReadSection& operator=(const ReadSection&) = delete;
+        };
+
+        alignas(Node) static inline char s_tombstone = 0;
+
+        Hash m_hash;
+        KeyEqual m_equal;
+        std::unique_ptr<Shard[]> m_shards;
+        size_t m_shardMask;
+        std::unique_ptr<ReaderSlot[]> m_readers;
+        size_t m_readerMask;
+
+        static inline Node* tombstone() { return reinterpret_cast<Node*>(&s_tombstone); }
+        static inline bool isNode(const Node* node) { return node && node != tombstone(); }
+
+        // The std::hash of integers is the identity, spread it before taking bits for the shard and slot
+        inline uint64_t hashOf(const Key& key) const {
+            uint64_t hash = static_cast<uint64_t>(m_hash(key));
+            hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+            hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+            return hash ^ (hash >> 31);
+        }
+
+        inline Shard& shardOf(uint64_t hash) const {
+            return m_shards[(hash >> 56) & m_shardMask];
+        }
+
+        // Where a thread starts looking for a free reader slot
+        static inline size_t threadIndex() {
+            thread_local const size_t index =
+                static_cast<size_t>((std::hash<std::thread::id>()(std::this_thread::get_id()) * 0x9E3779B97F4A7C15ull) >> 32);
+            return index;
+        }
+
+        // Slot holding key, nullptr if it is not in table
+        std::atomic<Node*>* probe(Table* table, uint64_t hash, const Key& key) const {
+            if (!table) return nullptr;
+            for (size_t i = 0, index = hash & table->mask; i < table->size(); ++i, index = (index + 1) & table->mask) {
+                Node* node = table->slots[index].load(std::memory_order_seq_cst);
+                if (!node) return nullptr;
+                if (node != tombstone() && node->hash == hash && m_equal(node->key, key)) return &table->slots[index];
+            }
+            return nullptr;
+        }
+
+        std::atomic<Node*>* lookup(Shard& shard, uint64_t hash, const Key& key) const {
+            if (std::atomic<Node*>* slot = probe(shard.current.load(std::memory_order_seq_cst), hash, key)) return slot;
+            return probe(shard.previous.load(std::memory_order_seq_cst), hash, key);
+        }
+
+        // Lock-free while no writer keeps the shard busy and a reader slot is free, locks it otherwise.
+        // Taking the reader slot and the table and slot loads are seq_cst so that a writer that finds
+        // the slot free after unlinking a node knows this lookup cannot reach it.
+        Node* findNode(Shard& shard, uint64_t hash, const Key& key) const {
+            {
+                ReadSection section(*this);
+                for (int attempt = 0; section.entered() && attempt < s_optimisticAttempts; ++attempt) {
+                    uint64_t sequence = shard.sequence.load(std::memory_order_acquire);
+                    if (sequence & 1) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    std::atomic<Node*>* slot = lookup(shard, hash, key);
+                    Node* node = slot ? slot->load(std::memory_order_seq_cst) : nullptr;
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (shard.sequence.load(std::memory_order_relaxed) == sequence) return isNode(node) ? node : nullptr;
+                }
+            }
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            std::atomic<Node*>* slot = lookup(shard, hash, key);
+            return slot ? slot->load(std::memory_order_relaxed) : nullptr;
+        }
+
+        // Puts node in the first free slot of its probe sequence, current must have one
+        static void place(Shard& shard, Node* node) {
+            Table* table = shard.current.load(std::memory_order_relaxed);
+            size_t index = node->hash & table->mask;
+            Node* occupant;
+            while (isNode(occupant = table->slots[index].load(std::memory_order_relaxed))) index = (index + 1) & table->mask;
+            if (!occupant) ++shard.used;
+            table->slots[index].store(node, std::memory_order_release);
+        }
+
+        // Moves up to slots slots of previous into current and retires previous once it is empty
+        static void migrate(Shard& shard, size_t slots) {
+            Table* previous = shard.previous.load(std::memory_order_relaxed);
+            if (!previous) return;
+            size_t end = previous->size() - shard.migrated > slots ? shard.migrated + slots : previous->size();
+            for (; shard.migrated < end; ++shard.migrated) {
+                Node* node = previous->slots[shard.migrated].load(std::memory_order_relaxed);
+                if (!isNode(node)) continue;
+                place(shard, node);
+                previous->slots[shard.migrated].store(tombstone(), std::memory_order_release);
+            }
+            if (shard.migrated < previous->size()) return;
+            shard.retiredTables.push_back(previous);
+            shard.previous.store(nullptr, std::memory_order_release);
+            shard.migrated = 0;
+        }
+
+        // Makes room for one more node in current, growing the shard if needed
+        static void prepareInsert(Shard& shard) {
+            migrate(shard, s_migrationStep);
+            Table* current = shard.current.load(std::memory_order_relaxed);
+            if (current && (shard.used + 1) * 4 <= current->size() * 3) return;
+
+            migrate(shard, SIZE_MAX);
+            size_t count = shard.count.load(std::memory_order_relaxed);
+            size_t size = std::max({ s_minTableSize, std::bit_ceil((count + 1) * 2), current ? current->size() / 2 : 0 });
+            Table* table = new Table(size);
+            if (!current) {
+                shard.current.store(table, std::memory_order_release);
+                return;
+            }
+            shard.previous.store(current, std::memory_order_release);
+            shard.current.store(table, std::memory_order_release);
+            shard.used = 0;
+            migrate(shard, s_migrationStep);
+        }
+
+        // Shard lock held and key known to be absent, takes ownership of node
+        Node* insertNode(Shard& shard, std::unique_ptr<Node> node) {
+            Node* inserted = node.release();
+            {
+                WriteSection section(shard);
+                prepareInsert(shard);
+                place(shard, inserted);
+                shard.count.fetch_add(1, std::memory_order_relaxed);
+            }
+            collect(shard);
+            return inserted;
+        }
+
+        static void freeTable(Table* table) {
+            for (size_t i = 0; i < table->size(); ++i) {
+                Node* node = table->slots[i].load(std::memory_order_relaxed);
+                if (isNode(node)) delete node;
+            }
+            delete table;
+        }
+
+        static void freePending(Shard& shard) {
+            for (Node* node : shard.pendingNodes) delete node;
+            for (Table* table : shard.pendingTables) delete table;
+            shard.pendingNodes.clear();
+            shard.pendingTables.clear();
+            shard.pendingReaders.clear();
+        }
+
+        static void freeRetired(Shard& shard) {
+            freePending(shard);
+            for (Node* node : shard.retiredNodes) delete node;
+            for (Table* table : shard.retiredTables) delete table;
+            shard.retiredNodes.clear();
+            shard.retiredTables.clear();
+        }
+
+        // Shard lock held, after something was retired. Frees the pending batch once the readers it
+        // waits for have left, then makes the retired memory pending if there is enough of it.
+        // Behind the fence a reader that takes a slot after the scan sees everything unlinked before it.
+        void collect(Shard& shard) {
+            if (!shard.pendingNodes.empty() || !shard.pendingTables.empty()) {
+                for (auto [index, version] : shard.pendingReaders)
+                    if (m_readers[index].version.load(std::memory_order_acquire) == version) return;
+                freePending(shard);
+            }
+            if (shard.retiredNodes.size() + shard.retiredTables.size() < s_reclaimBatch) return;
+
+            shard.pendingReaders.reserve(m_readerMask + 1);
+            std::swap(shard.pendingNodes, shard.retiredNodes);
+            std::swap(shard.pendingTables, shard.retiredTables);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            for (size_t i = 0; i <= m_readerMask; ++i) {
+                uint64_t version = m_readers[i].version.load(std::memory_order_acquire);
+                if (version & 1) shard.pendingReaders.emplace_back(i, version);
+            }
+            if (shard.pendingReaders.empty()) freePending(shard);
+        }
+
+        template<typename... Args>
+        const Value& emplaceIfAbsent(const Key& key, Args&&... args) {
+            uint64_t hash = hashOf(key);
+            Shard& shard = shardOf(hash);
+            if (Node* node = findNode(shard, hash, key)) return node->value;
+
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (std::atomic<Node*>* slot = lookup(shard, hash, key)) return slot->load(std::memory_order_relaxed)->value;
+            return insertNode(shard, std::make_unique<Node>(hash, key, std::forward<Args>(args)...))->value;
+        }
+
+    public:
+        ConcurrentHashMap() : ConcurrentHashMap(0) {}
+
+        explicit ConcurrentHashMap(size_t expectedSize, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual()) :
+            m_hash(hash), m_equal(equal) {
+            size_t shardCount = std::bit_ceil(std::clamp<size_t>(std::thread::hardware_concurrency() * 4, 16, 256));
+            m_shards = std::make_unique<Shard[]>(shardCount);
+            m_shardMask = shardCount - 1;
+            size_t readerCount = std::bit_ceil(std::clamp<size_t>(std::thread::hardware_concurrency() * 2, 8, 128));
+            m_readers = std::make_unique<ReaderSlot[]>(readerCount);
+            m_readerMask = readerCount - 1;
+            if (expectedSize == 0) return;
+            size_t tableSize = std::max(s_minTableSize, std::bit_ceil(expectedSize / shardCount * 2 + 1));
+            for (size_t i = 0; i < shardCount; ++i) m_shards[i].current.store(new Table(tableSize), std::memory_order_relaxed);
+        }
+
+        ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+        ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+        ~ConcurrentHashMap() {
+            for (size_t i = 0; i <= m_shardMask; ++i) {
+                Shard& shard = m_shards[i];
+                if (Table* table = shard.current.load(std::memory_order_relaxed)) freeTable(table);
+                if (Table* table = shard.previous.load(std::memory_order_relaxed)) freeTable(table);
+                freeRetired(shard);
+            }
+        }
+
+        // Lock-free unless the key's shard is being written, nullptr if key is absent
+        inline const Value* find(const Key& key) const {
+            uint64_t hash = hashOf(key);
+            Node* node = findNode(shardOf(hash), hash, key);
+            return node ? &node->value : nullptr;
+        }
+
+        inline bool contains(const Key& key) const {
+            return find(key) != nullptr;
+        }
+
+        // Value of key, constructed from args if key is absent
+        template<typename... Args>
+        inline const Value& findOrInsert(const Key& key, Args&&... args) {
+            return emplaceIfAbsent(key, std::forward<Args>(args)...);
+        }
+
+        // Value of key, made by factory() if key is absent. The factory runs under the shard lock,
+        // so it runs at most once per key but must not use this map.
+        template<typename Factory>
+        const Value& computeIfAbsent(const Key& key, Factory&& factory) {
+            uint64_t hash = hashOf(key);
+            Shard& shard = shardOf(hash);
+            if (Node* node = findNode(shard, hash, key)) return node->value;
+
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (std::atomic<Node*>* slot = lookup(shard, hash, key)) return slot->load(std::memory_order_relaxed)->value;
+            return insertNode(shard, std::make_unique<Node>(hash, key, std::invoke(std::forward<Factory>(factory))))->value;
+        }
+
+        // Inserts or replaces the value of key, true if key was absent. A replaced value is retired.
+        template<typename V>
+        bool insertOrAssign(const Key& key, V&& value) {
+            uint64_t hash = hashOf(key);
+            Shard& shard = shardOf(hash);
+            auto node = std::make_unique<Node>(hash, key, std::forward<V>(value));
+
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            std::atomic<Node*>* slot = lookup(shard, hash, key);
+            if (!slot) {
+                insertNode(shard, std::move(node));
+                return true;
+            }
+            shard.retiredNodes.push_back(slot->load(std::memory_order_relaxed));
+            {
+                WriteSection section(shard);
+                slot->store(node.release(), std::memory_order_release);
+            }
+            collect(shard);
+            return false;
+        }
+
+        // False if key was absent. The erased value is retired.
+        bool erase(const Key& key) {
+            uint64_t hash = hashOf(key);
+            Shard& shard = shardOf(hash);
+
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            std::atomic<Node*>* slot = lookup(shard, hash, key);
+            if (!slot) return false;
+            shard.retiredNodes.push_back(slot->load(std::memory_order_relaxed));
+            {
+                WriteSection section(shard);
+                slot->store(tombstone(), std::memory_order_release);
+                shard.count.fetch_sub(1, std::memory_order_relaxed);
+            }
+            collect(shard);
+            return true;
+        }
+
+        // Calls function(key, value) for every entry, locking one shard at a time
+        template<typename Function>
+        void forEach(Function&& function) const {
+            for (size_t i = 0; i <= m_shardMask; ++i) {
+                Shard& shard = m_shards[i];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                for (Table* table : { shard.current.load(std::memory_order_relaxed), shard.previous.load(std::memory_order_relaxed) }) {
+                    if (!table) continue;
+                    for (size_t slot = 0; slot < table->size(); ++slot) {
+                        Node* node = table->slots[slot].load(std::memory_order_relaxed);
+                        if (isNode(node)) function(static_cast<const Key&>(node->key), static_cast<const Value&>(node->value));
+                    }
+                }
+            }
+        }
+
+        // Sum of the shard sizes, exact only while no writer runs
+        size_t size() const {
+            size_t size = 0;
+            for (size_t i = 0; i <= m_shardMask; ++i) size += m_shards[i].count.load(std::memory_order_relaxed);
+            return size;
+        }
+
+        inline bool empty() const { return size() == 0; }
+
+        // Retires every entry, safe alongside other calls
+        void clear() {
+            for (size_t i = 0; i <= m_shardMask; ++i) {
+                Shard& shard = m_shards[i];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                Table* tables[] = { shard.current.load(std::memory_order_relaxed), shard.previous.load(std::memory_order_relaxed) };
+                shard.retiredNodes.reserve(shard.retiredNodes.size() + shard.count.load(std::memory_order_relaxed));
+                shard.retiredTables.reserve(shard.retiredTables.size() + 2);
+
+                {
+                    WriteSection section(shard);
+                    for (Table* table : tables) {
+                        if (!table) continue;
+                        for (size_t slot = 0; slot < table->size(); ++slot) {
+                            Node* node = table->slots[slot].load(std::memory_order_relaxed);
+                            if (isNode(node)) shard.retiredNodes.push_back(node);
+                        }
+                        shard.retiredTables.push_back(table);
+                    }
+                    shard.current.store(nullptr, std::memory_order_release);
+                    shard.previous.store(nullptr, std::memory_order_release);
+                    shard.migrated = 0;
+                    shard.used = 0;
+                    shard.count.store(0, std::memory_order_relaxed);
+                }
+                collect(shard);
+            }
+        }
+
+        // Frees retired nodes and tables now instead of waiting for readers to leave.
+        // No other thread may use the map during the call.
+        void reclaim() {
+            for (size_t i = 0; i <= m_shardMask; ++i) freeRetired(m_shards[i]);
+        }
+    };
+}
@@ -1,11 +1,18 @@
 #pragma once
 #include "CommonApi/Namespaces.h"
 
+#include <algorithm>
 #include <condition_variable>
+#include <cstddef>
 #include <deque>
 #include <mutex>
 #include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <ranges>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace MultiThreading
 {
@@ -17,6 +24,16 @@ namespace MultiThreading
         mutable std::mutex mutex;
         std::condition_variable_any notEmpty;
 
+        // Requires the lock
+        template<typename OutputIterator>
+        size_t takeFront(OutputIterator output, size_t maxCount) {
+            size_t count = std::min(maxCount, deque.size());
+            auto end = deque.begin() + static_cast<std::ptrdiff_t>(count);
+            std::move(deque.begin(), end, output);
+            deque.erase(deque.begin(), end);
+            return count;
+        }
+
     public:
         Deque() = default;
 
@@ -61,6 +78,23 @@ namespace MultiThreading
             notEmpty.notify_one();
         }
 
+        // Appends every element of values under one lock with a single notify
+        template<std::ranges::input_range Range>
+        void pushBackRange(Range&& values) {
+            size_t count;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                size_t oldSize = deque.size();
+                if constexpr (std::is_lvalue_reference_v<Range> || std::ranges::borrowed_range<Range>)
+                    deque.insert(deque.end(), std::ranges::begin(values), std::ranges::end(values));
+                else
+                    deque.insert(deque.end(), std::make_move_iterator(std::ranges::begin(values)), std::make_move_iterator(std::ranges::end(values)));
+                count = deque.size() - oldSize;
+            }
+            if (count == 1) notEmpty.notify_one();
+            else if (count > 1) notEmpty.notify_all();
+        }
+
         bool popBack(T& value) {
             std::lock_guard<std::mutex> lock(mutex);
             if (deque.empty()) {
@@ -84,12 +118,6 @@ namespace MultiThreading
         // Wait and pop an item from the queue
         void waitAndPopFront(T& value) {
             std::unique_lock<std::mutex> lock(mutex);
-
-            if (!deque.empty()) {
-                value = std::move(deque.front());
-                deque.pop_front();
-            }
-
             notEmpty.wait(lock, [this]() { return !deque.empty(); });
             value = std::move(deque.front());
             deque.pop_front();
@@ -97,12 +125,6 @@ namespace MultiThreading
 
         void waitAndPopBack(T& value) {
             std::unique_lock<std::mutex> lock(mutex);
-
-            if (!deque.empty()) {
-                value = std::move(deque.back());
-                deque.pop_back();
-            }
-
             notEmpty.wait(lock, [this]() { return !deque.empty(); });
             value = std::move(deque.back());
             deque.pop_back();
@@ -146,6 +168,36 @@ namespace MultiThreading
             return false;
         }
 
+        // Moves up to maxCount elements from the front to output under one lock, returns how many
+        template<typename OutputIterator>
+        size_t popFrontN(OutputIterator output, size_t maxCount) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return takeFront(output, maxCount);
+        }
+
+        // Appends up to maxCount elements from the front to the end of container under one lock, returns how many
+        template<typename Container>
+        size_t drainInto(Container& container, size_t maxCount = SIZE_MAX) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return takeFront(std::back_inserter(container), maxCount);
+        }
+
+        // Waits up to timeout for the deque to become non-empty, then drains like drainInto.
+        // Returns 0 if nothing arrived in time.
+        template<typename Container, typename Rep, typename Period>
+        size_t waitAndDrainFor(Container& container, const std::chrono::duration<Rep, Period>& timeout, size_t maxCount = SIZE_MAX) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!notEmpty.wait_for(lock, timeout, [this]() { return !deque.empty(); })) return 0;
+            return takeFront(std::back_inserter(container), maxCount);
+        }
+
+        template<typename Rep, typename Period>
+        std::vector<T> waitAndDrainFor(const std::chrono::duration<Rep, Period>& timeout, size_t maxCount = SIZE_MAX) {
+            std::vector<T> values;
+            waitAndDrainFor(values, timeout, maxCount);
+            return values;
+        }
+
         // Check if queue is empty
         bool empty() const {
             std::lock_guard<std::mutex> lock(mutex);
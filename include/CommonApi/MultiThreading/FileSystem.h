@@ -1,12 +1,14 @@
 #pragma once
 #include "CommonApi/Namespaces.h"
-#include "CommonApi/MultiThreading/Synchronized.h"
+#include "CommonApi/MultiThreading/ConcurrentHashMap.h"
 
 #include <filesystem>
 #include <fstream>
-#include <unordered_map>
+#include <memory>
+#include <shared_mutex>
 #include <string>
 #include <functional>
+#include <vector>
 
 namespace MultiThreading
 {
@@ -14,8 +16,8 @@ namespace MultiThreading
 
     class FileSystem
     {
-        using FileMutexMap = Synchronized<std::unordered_map<std::string,
-            std::shared_ptr<std::shared_mutex>>>;
+        using FileMutexMap = ConcurrentHashMap<std::string,
+            std::shared_ptr<std::shared_mutex>>;
 
         static inline FileMutexMap fileMutexes;
         static inline std::shared_mutex directoryMutex;
@@ -0,0 +1,311 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+#include "CommonApi/MultiThreading/MemoryPool.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//Handle pool
+namespace MultiThreading
+{
+	// Slot map: objects are named by generational handles instead of pointers. The objects are packed
+	// densely, erase moves the last one into the hole, so iteration touches nothing but live objects.
+	// A handle is an index into a table of entries, each holding the object's dense position and a
+	// generation that erase bumps, which makes handles to erased objects fail every lookup.
+	//
+	// The dense array grows a slab at a time like MemoryPool, so growing never moves objects and the
+	// slab options mean the same, except that slab sizes round up to a power of two. Only erase moves
+	// one object, with T's move constructor, which should not throw.
+	//
+	// Handles are 32-bit (20 index and 12 generation bits) or 64-bit (32 and 32). Generations wrap and
+	// skip zero, so with 32-bit handles a handle kept across 4095 reuses of its entry can become valid again.
+	//
+	// Not thread safe: concurrent const calls are fine, anything else needs outside synchronization.
+	template <typename T, typename Id = uint64_t>
+	class HandlePool
+	{
+		static_assert(std::is_same_v<Id, uint32_t> || std::is_same_v<Id, uint64_t>, "Handles are uint32_t or uint64_t");
+
+	private:
+		static constexpr unsigned int s_indexBits = sizeof(Id) == 4 ? 20 : 32;
+		static constexpr uint64_t s_indexMask = (uint64_t(1) << s_indexBits) - 1;
+		static constexpr uint64_t s_generationMask = (uint64_t(1) << (sizeof(Id) * 8 - s_indexBits)) - 1;
+		static constexpr uint32_t s_invalidIndex = UINT32_MAX;
+
+	public:
+		using SlabOptions = typename MemoryPool<T>::SlabOptions;
+
+		// Zero is never a valid handle, a default constructed one is null
+		class Handle
+		{
+		private:
+			Id m_value;
+
+			Handle(uint32_t index, uint32_t generation) :
+				m_value(static_cast<Id>(uint64_t(generation) << s_indexBits | index)) {};
+
+			friend class HandlePool;
+
+		public:
+			Handle() : m_value(0) {};
+
+			static Handle fromValue(Id value) {
+				Handle handle;
+				handle.m_value = value;
+				return handle;
+			}
+
+			inline Id value() const { return m_value; }
+			inline uint32_t index() const { return static_cast<uint32_t>(m_value & s_indexMask); }
+			inline uint32_t generation() const { return static_cast<uint32_t>(uint64_t(m_value) >> s_indexBits); }
+
+			explicit operator bool() const { return m_value != 0; }
+
+			bool operator==(const Handle& other) const { return m_value == other.m_value; };
+			bool operator!=(const Handle& other) const { return m_value != other.m_value; };
+		};
+
+	private:
+		struct alignas(T) Storage {
+			unsigned char bytes[sizeof(T)];
+		};
+
+		struct Entry {
+			uint32_t dense;					// position in the dense array, s_invalidIndex while free
+			uint32_t generation;			// of the live object, or of the next one while free
+			uint32_t nextFree;
+		};
+
+		std::vector<std::unique_ptr<Storage[]>> m_slabs;
+		uint32_t m_slabSize = 0;
+		unsigned int m_slabShift = 0;
+		uint32_t m_slabMask = 0;
+		size_t m_slabCount = 0;
+
+		std::vector<Entry> m_entries;
+		std::vector<uint32_t> m_denseToEntry;
+		// Erased entries are reused oldest first so their generations wrap as late as possible
+		uint32_t m_freeHead = s_invalidIndex;
+		uint32_t m_freeTail = s_invalidIndex;
+
+		inline T* element(uint32_t dense) const {
+			return std::launder(reinterpret_cast<T*>(m_slabs[dense >> m_slabShift][dense & m_slabMask].bytes));
+		}
+
+		inline const Entry* liveEntry(Handle handle) const {
+			uint32_t index = handle.index();
+			if (index >= m_entries.size()) return nullptr;
+			const Entry& entry = m_entries[index];
+			return entry.dense != s_invalidIndex && entry.generation == handle.generation() ? &entry : nullptr;
+		}
+
+		static inline uint32_t nextGeneration(uint32_t generation) {
+			uint32_t next = static_cast<uint32_t>((generation + 1) & s_generationMask);
+			return next ? next : 1;
+		}
+
+		void pushFree(uint32_t index) {
+			m_entries[index].nextFree = s_invalidIndex;
+			if (m_freeTail == s_invalidIndex) m_freeHead = index;
+			else m_entries[m_freeTail].nextFree = index;
+			m_freeTail = index;
+		}
+
+		void popFree() {
+			m_freeHead = m_entries[m_freeHead].nextFree;
+			if (m_freeHead == s_invalidIndex) m_freeTail = s_invalidIndex;
+		}
+
+		bool addSlab() {
+			if (m_slabCount == m_slabs.size()) return false;
+			m_slabs[m_slabCount] = std::make_unique_for_overwrite<Storage[]>(m_slabSize);
+			++m_slabCount;
+			return true;
+		}
+
+	public:
+		HandlePool() = default;
+		HandlePool(unsigned int size) { set(size); }
+		HandlePool(const SlabOptions& options) { set(options); }
+
+		~HandlePool()
+		{
+			clear();
+		}
+
+		HandlePool(const HandlePool&) = delete;
+		HandlePool& operator=(const HandlePool&) = delete;
+
+		HandlePool(HandlePool&&) = delete;
+		HandlePool& operator=(HandlePool&&) = delete;
+
+		// A single slab of at least size objects that never grows. Destroys the current objects.
+		void set(unsigned int size)
+		{
+			if (size == 0) {
+				throw std::invalid_argument("Pool size cannot be zero");
+			}
+			set(SlabOptions{ size, 1, 1 });
+		}
+
+		// Destroys the current objects, their handles stay stale
+		void set(const SlabOptions& options)
+		{
+			if (options.slabSize == 0 || options.maxSlabs == 0) {
+				throw std::invalid_argument("Pool slab size and slab count cannot be zero");
+			}
+			unsigned int shift = static_cast<unsigned int>(std::bit_width(options.slabSize - 1u));
+			if ((uint64_t(options.maxSlabs) << shift) > s_indexMask) {
+				throw std::invalid_argument("Pool slabs do not fit the handle index bits");
+			}
+
+			clear();
+			m_slabs.clear();
+			m_slabCount = 0;
+			m_slabSize = uint32_t(1) << shift;
+			m_slabShift = shift;
+			m_slabMask = static_cast<uint32_t>((uint64_t(1) << shift) - 1);
+			m_slabs.resize(options.maxSlabs);
+			for (unsigned int i = 0; i < std::min(options.initialSlabs, options.maxSlabs); ++i) addSlab();
+		}
+
+		// Throws std::bad_alloc once all slabs are full. If the constructor throws nothing changes.
+		template<typename... Args>
+		Handle emplace(Args&&... args)
+		{
+			if (m_slabs.empty())
+				throw std::runtime_error("Memory pool not initialized");
+
+			uint32_t dense = static_cast<uint32_t>(m_denseToEntry.size());
+			if ((dense >> m_slabShift) >= m_slabCount && !addSlab())
+				throw std::bad_alloc();
+
+			if (m_freeHead == s_invalidIndex) {
+				m_entries.push_back(Entry{ s_invalidIndex, 1, s_invalidIndex });
+				pushFree(static_cast<uint32_t>(m_entries.size() - 1));
+			}
+			uint32_t index = m_freeHead;
+			m_denseToEntry.push_back(index);
+			try {
+				new (element(dense)) T(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				m_denseToEntry.pop_back();
+				throw;
+			}
+			popFree();
+			Entry& entry = m_entries[index];
+			entry.dense = dense;
+			return Handle(index, entry.generation);
+		}
+
+		inline Handle insert(const T& value) { return emplace(value); }
+		inline Handle insert(T&& value) { return emplace(std::move(value)); }
+
+		// False for null and stale handles. Moves the last object into the hole.
+		bool erase(Handle handle)
+		{
+			const Entry* found = liveEntry(handle);
+			if (!found) return false;
+
+			uint32_t index = handle.index();
+			uint32_t hole = found->dense;
+			uint32_t last = static_cast<uint32_t>(m_denseToEntry.size() - 1);
+			T* holeElement = element(hole);
+			holeElement->~T();
+			if (hole != last) {
+				T* lastElement = element(last);
+				new (holeElement) T(std::move(*lastElement));
+				lastElement->~T();
+				m_denseToEntry[hole] = m_denseToEntry[last];
+				m_entries[m_denseToEntry[hole]].dense = hole;
+			}
+			m_denseToEntry.pop_back();
+
+			Entry& entry = m_entries[index];
+			entry.dense = s_invalidIndex;
+			entry.generation = nextGeneration(entry.generation);
+			pushFree(index);
+			return true;
+		}
+
+		// nullptr for null and stale handles, valid until the next emplace or erase
+		inline T* find(Handle handle) {
+			const Entry* entry = liveEntry(handle);
+			return entry ? element(entry->dense) : nullptr;
+		}
+
+		inline const T* find(Handle handle) const {
+			return const_cast<HandlePool*>(this)->find(handle);
+		}
+
+		inline bool contains(Handle handle) const {
+			return liveEntry(handle) != nullptr;
+		}
+
+		// Throws std::out_of_range for null and stale handles
+		inline T& at(Handle handle) {
+			if (T* value = find(handle)) return *value;
+			throw std::out_of_range("HandlePool handle is stale");
+		}
+
+		inline const T& at(Handle handle) const {
+			return const_cast<HandlePool*>(this)->at(handle);
+		}
+
+		// Calls function(T&) or function(Handle, T&) for every object in dense order.
+		// The function must not emplace or erase.
+		template<typename Function>
+		void forEach(Function&& function)
+		{
+			uint32_t dense = 0;
+			for (size_t slab = 0; dense < m_denseToEntry.size(); ++slab) {
+				T* first = std::launder(reinterpret_cast<T*>(m_slabs[slab][0].bytes));
+				uint32_t count = std::min<uint32_t>(m_slabSize, static_cast<uint32_t>(m_denseToEntry.size()) - dense);
+				for (uint32_t i = 0; i < count; ++i, ++dense) {
+					if constexpr (std::is_invocable_v<Function&, Handle, T&>) {
+						uint32_t index = m_denseToEntry[dense];
+						function(Handle(index, m_entries[index].generation), first[i]);
+					}
+					else function(first[i]);
+				}
+			}
+		}
+
+		template<typename Function>
+		void forEach(Function&& function) const
+		{
+			if constexpr (std::is_invocable_v<Function&, Handle, const T&>)
+				const_cast<HandlePool*>(this)->forEach([&](Handle handle, T& value) { function(handle, static_cast<const T&>(value)); });
+			else
+				const_cast<HandlePool*>(this)->forEach([&](T& value) { function(static_cast<const T&>(value)); });
+		}
+
+		// Destroys every object, handles issued so far stay stale
+		void clear()
+		{
+			if constexpr (!std::is_trivially_destructible_v<T>)
+				for (uint32_t dense = 0; dense < m_denseToEntry.size(); ++dense) element(dense)->~T();
+			for (uint32_t dense = 0; dense < m_denseToEntry.size(); ++dense) {
+				uint32_t index = m_denseToEntry[dense];
+				m_entries[index].dense = s_invalidIndex;
+				m_entries[index].generation = nextGeneration(m_entries[index].generation);
+				pushFree(index);
+			}
+			m_denseToEntry.clear();
+		}
+
+		inline size_t size() const { return m_denseToEntry.size(); }
+		inline bool empty() const { return m_denseToEntry.empty(); }
+		inline size_t capacity() const { return m_slabCount * m_slabSize; }
+		inline size_t getSlabCount() const { return m_slabCount; }
+		inline bool isInitialized() const { return !m_slabs.empty(); }
+	};
+}
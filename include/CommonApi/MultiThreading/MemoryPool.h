@@ -6,21 +6,110 @@
 #include "CommonApi/MultiThreading/Synchronized.h"
 #include "CommonApi/MultiThreading/PointerControlBlock.h"
 
+#include <algorithm>
+#include <bit>
 #include <type_traits>
 #include <vector>
-#include <set>
 #include <atomic>
-#include <shared_mutex>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <stdexcept>
+#include <thread>
+#include <utility>
 
 //Memory pool
 namespace MultiThreading
 {
+	// Pool of T made of slabs that never move, so pointers stay valid until their object is freed.
+	// Free slots form intrusive chains: every thread caches up to two of them in its magazine and
+	// allocates and frees there without touching shared memory. Full chains go to and come from a
+	// lock-free stack shared by all threads, one CAS per batch of slots. When that stack runs dry the
+	// pool adds a slab, up to its slab limit. A thread may run out while other threads still cache
+	// free slots, size the limit with some slack. A pool of a single slab, such as set(size) makes,
+	// caches nothing and pushes and pops single slots on the shared stack, so all of them can be used.
+	//
+	// Every slab has a bitmap of its live slots, so clear(), forEach and releaseEmptySlabs
+	// only visit one word per 64 slots plus the objects themselves.
+	//
+	// Every slot starts with the reference counts of SharedPointer and WeakPointer, so those are a
+	// single pointer to the slot and makeShared needs no allocation beyond the slot itself.
 	template <typename T>
 	class MemoryPool
 	{
+	private:
+		static constexpr uint32_t s_invalidIndex = UINT32_MAX;
+		static constexpr size_t s_maxBatchSize = 32;
+
+		// Lives in a slot while it is free
+		struct FreeLink {
+			uint32_t next;							// next free slot of the same chain
+			uint32_t count;							// slots in the chain, set in its first slot once it is shared
+
+			FreeLink(uint32_t next) : next(next), count(0) {}
+		};
+
+		struct Chain {
+			uint32_t head = s_invalidIndex;
+			uint32_t count = 0;
+		};
+
+		// Free slots cached for one thread, only that thread touches the chains
+		struct Magazine {
+			std::mutex ownerMutex;					// orders the thread's exit against the pool detaching it
+			MemoryPool* pool;
+			Chain loaded;
+			Chain previous;
+			std::atomic<size_t> freeCount = 0;		// slots in both chains, for statistics
+
+			explicit Magazine(MemoryPool* pool) : pool(pool) {}
+
+			inline void updateCount() {
+				freeCount.store(loaded.count + previous.count, std::memory_order_relaxed);
+			}
+
+			// Called on thread exit, hands the cached slots back to the pool and leaves it if it is still alive.
+			// The pool's destructor waits for our mutex before it goes away.
+			void flush() {
+				std::lock_guard<std::mutex> lock(ownerMutex);
+				if (!pool) return;
+				pool->returnChains(*this);
+				std::lock_guard<std::mutex> poolLock(pool->m_magazineMutex);
+				std::erase_if(pool->m_magazines, [this](const auto& magazine) { return magazine.get() == this; });
+			}
+		};
+
+		struct ThreadCache {
+			uint64_t lastId = 0;
+			Magazine* last = nullptr;
+			std::vector<std::pair<uint64_t, std::shared_ptr<Magazine>>> magazines;
+
+			~ThreadCache() {
+				for (auto& entry : magazines) entry.second->flush();
+			}
+		};
+
 	public:
-		using Storage = std::aligned_storage_t<sizeof(T), alignof(T)>;
+		// The header is written when the slab is made, the free link only overwrites the bytes
+		struct Storage {
+			PointerControlBlock control;
+			MemoryPool* pool;
+			uint32_t index;
+			// Next chain on the shared stack while this slot heads one. Kept out of the object bytes
+			// since racing pops read it after another thread may have reused the slot.
+			std::atomic<uint32_t> nextBatch;
+			alignas(std::max(alignof(T), alignof(FreeLink))) unsigned char bytes[std::max(sizeof(T), sizeof(FreeLink))];
+
+			inline T* object() { return std::launder(reinterpret_cast<T*>(bytes)); }
+		};
+
+		struct SlabOptions {
+			unsigned int slabSize = 4096;			// slots per slab
+			unsigned int maxSlabs = 1024;			// allocation throws std::bad_alloc once all of them are full
+			unsigned int initialSlabs = 1;
+		};
+
 		struct Iterator
 		{
 			T* ptr;
@@ -31,175 +120,531 @@ namespace MultiThreading
 		};
 
 	private:
-		std::vector<Storage> m_data;
-		std::vector<size_t> m_freeChunks;
-		std::set<size_t> m_allocatedChunks;
-		Storage* dataPtr = nullptr;
+		struct Slab {
+			std::unique_ptr<Storage[]> slots;
+			std::unique_ptr<std::atomic<uint64_t>[]> live;	// one bit per slot holding an object
+			uint32_t size;
+
+			explicit Slab(uint32_t size) : slots(std::make_unique_for_overwrite<Storage[]>(size)),
+				live(std::make_unique<std::atomic<uint64_t>[]>((size + 63) / 64)), size(size) {}
+
+			inline size_t wordCount() const { return (size + 63) / 64; }
+
+			bool isEmpty() const {
+				for (size_t word = 0; word < wordCount(); ++word)
+					if (live[word].load(std::memory_order_relaxed)) return false;
+				return true;
+			}
+
+			// Skips slots whose object is gone but that weak pointers still hold
+			template<typename Function>
+			void forEachLive(Function&& function) {
+				for (size_t word = 0; word < wordCount(); ++word)
+					for (uint64_t bits = live[word].load(std::memory_order_relaxed); bits; bits &= bits - 1) {
+						Storage& storage = slots[word * 64 + std::countr_zero(bits)];
+						if (storage.control.sharedCounter.load(std::memory_order_relaxed)) function(*storage.object());
+					}
+			}
+		};
+
+		// Sized once by set, an entry is only written while growing or under the no-concurrency rules.
+		// Slot indices hold the slab in the high bits and the slot within it in the low bits.
+		std::vector<std::unique_ptr<Slab>> m_slabs;
+		// Flat copies of the slab arrays for the allocation path
+		std::unique_ptr<Storage*[]> m_slabSlots;
+		std::unique_ptr<std::atomic<uint64_t>*[]> m_slabLive;
+		uint32_t m_slabSize = 0;
+		unsigned int m_slabShift = 0;
+		uint32_t m_slabMask = 0;
+		std::atomic<size_t> m_slabCount = 0;
+		std::mutex m_growMutex;
+		size_t m_batchSize = 1;
+		bool m_cached = false;				// magazines in use, false for a single slab
+		const uint64_t m_id;
 
 		std::atomic<bool> m_isSet = 0;
-		mutable std::shared_mutex m_poolMutex;
 
-		static size_t getIndexFromPointer(T* ptr, std::vector<Storage> pool) {
-			if (!ptr) return std::numeric_limits<std::size_t>::max();
+		// Shared stack of free chains, first slot index in the low half and an ABA tag in the high half
+		alignas(64) std::atomic<uint64_t> m_freeBatches = s_invalidIndex;
+		std::atomic<size_t> m_sharedFreeCount = 0;
+
+		mutable std::mutex m_magazineMutex;
+		std::vector<std::shared_ptr<Magazine>> m_magazines;
 
-			std::ptrdiff_t diff = reinterpret_cast<const char*>(ptr); -
-				reinterpret_cast<const char*>(dataPtr);
+		static inline uint64_t nextPoolId() {
+			static std::atomic<uint64_t> s_nextId = 1;
+			return s_nextId.fetch_add(1, std::memory_order_relaxed);
+		}
 
-			//if (diff < 0 || static_cast<size_t>(diff) >= m_data.size()) {
-			//	throw std::out_of_range("Pointer not from this pool");
-			//}
+		static inline ThreadCache& threadCache() {
+			thread_local ThreadCache cache;
+			return cache;
+		}
 
-			return static_cast<size_t>(diff) / sizeof(Storage);
+		inline Storage* slot(uint32_t index) {
+			return m_slabSlots[index >> m_slabShift] + (index & m_slabMask);
 		}
 
-		Iterator allocate()
-		{
-			std::lock_guard<std::shared_mutex> lock(m_poolMutex);
+		inline FreeLink& link(uint32_t index) {
+			return *std::launder(reinterpret_cast<FreeLink*>(slot(index)->bytes));
+		}
+
+		inline std::atomic<uint64_t>& liveWord(uint32_t index) {
+			return m_slabLive[index >> m_slabShift][(index & m_slabMask) / 64];
+		}
+
+		inline uint64_t liveBit(uint32_t index) const {
+			return uint64_t(1) << ((index & m_slabMask) % 64);
+		}
+
+		inline void markLive(uint32_t index, bool live) {
+			if (live) liveWord(index).fetch_or(liveBit(index), std::memory_order_relaxed);
+			else liveWord(index).fetch_and(~liveBit(index), std::memory_order_relaxed);
+		}
+
+		void pushChain(Chain& chain) {
+			if (chain.count == 0) return;
+			link(chain.head).count = chain.count;
+			Storage* head = slot(chain.head);
+			uint64_t top = m_freeBatches.load(std::memory_order_relaxed);
+			do {
+				head->nextBatch.store(static_cast<uint32_t>(top), std::memory_order_relaxed);
+			} while (!m_freeBatches.compare_exchange_weak(top, ((top >> 32) + 1) << 32 | chain.head,
+				std::memory_order_release, std::memory_order_relaxed));
+			m_sharedFreeCount.fetch_add(chain.count, std::memory_order_relaxed);
+			chain = Chain{};
+		}
+
+		// The first slot of the popped chain may be handed out by another thread while we read its
+		// nextBatch, the tag makes our CAS fail in that case. nextBatch lives in the slot header,
+		// so that read never overlaps the object the other thread constructs.
+		bool popChain(Chain& chain) {
+			uint64_t top = m_freeBatches.load(std::memory_order_acquire);
+			uint32_t head;
+			do {
+				head = static_cast<uint32_t>(top);
+				if (head == s_invalidIndex) return false;
+			} while (!m_freeBatches.compare_exchange_weak(top,
+				((top >> 32) + 1) << 32 | slot(head)->nextBatch.load(std::memory_order_relaxed),
+				std::memory_order_acquire, std::memory_order_acquire));
+			chain = Chain{ head, link(head).count };
+			m_sharedFreeCount.fetch_sub(chain.count, std::memory_order_relaxed);
+			return true;
+		}
+
+		void returnChains(Magazine& magazine) {
+			pushChain(magazine.loaded);
+			pushChain(magazine.previous);
+			magazine.updateCount();
+		}
 
-			if (!m_isSet) {
+		Magazine& localMagazine() {
+			ThreadCache& cache = threadCache();
+			if (cache.lastId == m_id) return *cache.last;
+
+			auto found = std::find_if(cache.magazines.begin(), cache.magazines.end(), [this](const auto& entry) { return entry.first == m_id; });
+			if (found == cache.magazines.end()) {
+				// Drop the magazines of pools that were destroyed
+				std::erase_if(cache.magazines, [](const auto& entry) {
+					std::lock_guard<std::mutex> lock(entry.second->ownerMutex);
+					return entry.second->pool == nullptr;
+				});
+				auto magazine = std::make_shared<Magazine>(this);
+				{
+					std::lock_guard<std::mutex> lock(m_magazineMutex);
+					m_magazines.push_back(magazine);
+				}
+				cache.magazines.emplace_back(m_id, std::move(magazine));
+				found = cache.magazines.end() - 1;
+			}
+			cache.lastId = m_id;
+			cache.last = found->second.get();
+			return *cache.last;
+		}
+
+		// Chains the free slots of a slab and shares them
+		void pushFreeSlots(uint32_t slabIndex) {
+			Slab& slab = *m_slabs[slabIndex];
+			uint32_t base = slabIndex << m_slabShift;
+			Chain chain;
+			for (size_t word = 0; word < slab.wordCount(); ++word) {
+				uint64_t free = ~slab.live[word].load(std::memory_order_relaxed);
+				if (word == slab.wordCount() - 1 && slab.size % 64) free &= (uint64_t(1) << (slab.size % 64)) - 1;
+				for (; free; free &= free - 1) {
+					uint32_t index = base + static_cast<uint32_t>(word * 64 + std::countr_zero(free));
+					new (slot(index)->bytes) FreeLink(chain.head);
+					chain.head = index;
+					if (++chain.count == m_batchSize) pushChain(chain);
+				}
+			}
+			pushChain(chain);
+		}
+
+		// Grow mutex held or no other call running
+		bool addSlab() {
+			auto hole = std::find(m_slabs.begin(), m_slabs.end(), nullptr);
+			if (hole == m_slabs.end()) return false;
+			size_t slabIndex = hole - m_slabs.begin();
+			*hole = std::make_unique<Slab>(m_slabSize);
+			for (uint32_t i = 0; i < m_slabSize; ++i) {
+				(*hole)->slots[i].pool = this;
+				(*hole)->slots[i].index = static_cast<uint32_t>(slabIndex << m_slabShift) + i;
+			}
+			m_slabSlots[slabIndex] = (*hole)->slots.get();
+			m_slabLive[slabIndex] = (*hole)->live.get();
+			m_slabCount.fetch_add(1, std::memory_order_relaxed);
+			pushFreeSlots(static_cast<uint32_t>(slabIndex));
+			return true;
+		}
+
+		// False once the slab limit is reached, true if this or another thread made new slots
+		bool grow() {
+			if (!m_isSet.load(std::memory_order_relaxed))
 				throw std::runtime_error("Memory pool not initialized");
+			std::lock_guard<std::mutex> lock(m_growMutex);
+			if (static_cast<uint32_t>(m_freeBatches.load(std::memory_order_acquire)) != s_invalidIndex) return true;
+			return addSlab();
+		}
+
+		// Null unless the pool caches slots
+		inline Magazine* cacheOrNull() {
+			return m_cached ? &localMagazine() : nullptr;
+		}
+
+		// Neither marks the slot live nor updates the magazine's free count. Without a magazine the
+		// shared stack holds single slots.
+		uint32_t popSlot(Magazine* magazine) {
+			if (!magazine) {
+				Chain chain;
+				while (!popChain(chain))
+					if (!grow()) throw std::bad_alloc();
+				return chain.head;
 			}
+			if (magazine->loaded.count == 0) {
+				if (magazine->previous.count > 0) std::swap(magazine->loaded, magazine->previous);
+				else while (!popChain(magazine->loaded))
+					if (!grow()) throw std::bad_alloc();
+			}
+			uint32_t index = magazine->loaded.head;
+			magazine->loaded.head = link(index).next;
+			--magazine->loaded.count;
+			return index;
+		}
+
+		uint32_t takeSlot() {
+			Magazine* magazine = cacheOrNull();
+			uint32_t index = popSlot(magazine);
+			if (magazine) magazine->updateCount();
+			markLive(index, true);
+			return index;
+		}
 
-			if (m_freeChunks.empty()) {
-				throw std::bad_alloc();
+		void putSlot(uint32_t index) {
+			if (!m_cached) {
+				markLive(index, false);
+				new (slot(index)->bytes) FreeLink(s_invalidIndex);
+				Chain chain{ index, 1 };
+				pushChain(chain);
+				return;
+			}
+			Magazine& magazine = localMagazine();
+			if (magazine.loaded.count == m_batchSize) {
+				pushChain(magazine.previous);
+				magazine.previous = magazine.loaded;
+				magazine.loaded = Chain{};
 			}
+			markLive(index, false);
+			new (slot(index)->bytes) FreeLink(magazine.loaded.head);
+			magazine.loaded.head = index;
+			++magazine.loaded.count;
+			magazine.updateCount();
+		}
 
-			unsigned int index = m_freeChunks.back();
+		// Owner mutexes are taken before the magazine mutex, so they are locked on a copy of the list
+		std::vector<std::shared_ptr<Magazine>> magazines() const {
+			std::lock_guard<std::mutex> lock(m_magazineMutex);
+			return m_magazines;
+		}
 
-			if (index >= m_data.size()) {
-				throw std::out_of_range("Invalid pool index");
+		// Forgets every free chain, cached ones included, the live bitmaps keep the truth
+		void resetFreeLists() {
+			for (auto& magazine : magazines()) {
+				std::lock_guard<std::mutex> ownerLock(magazine->ownerMutex);
+				magazine->loaded = Chain{};
+				magazine->previous = Chain{};
+				magazine->updateCount();
 			}
+			m_freeBatches.store(s_invalidIndex, std::memory_order_relaxed);
+			m_sharedFreeCount.store(0, std::memory_order_relaxed);
+		}
 
-			m_freeChunks.pop_back();
-			m_allocatedChunks.insert(index);
-			if (m_freeChunks.size() + m_allocatedChunks.size() != m_data.size())
-				__debugbreak();
-			return Iterator(new (&m_data[index]) T(), index, this);
+		template<typename... Args>
+		T* construct(uint32_t index, Args&&... args)
+		{
+			Storage* storage = slot(index);
+			storage->control.sharedCounter.store(1, std::memory_order_relaxed);
+			storage->control.weakCounter.store(1, std::memory_order_relaxed);
+			return new (storage->bytes) T(std::forward<Args>(args)...);
+		}
+
+		template<typename... Args>
+		Iterator allocate(Args&&... args)
+		{
+			uint32_t index = takeSlot();
+			try {
+				return Iterator(construct(index, std::forward<Args>(args)...), index, this);
+			}
+			catch (...) {
+				putSlot(index);
+				throw;
+			}
+		}
+
+		// Constructs count objects from copies of args and hands each to output(Iterator) as soon as it
+		// exists. Looks the magazine up once and sets the live bits a bitmap word at a time.
+		// If a constructor throws, the objects already handed out stay with output.
+		template<typename Output, typename... Args>
+		void allocateN(size_t count, Output&& output, const Args&... args)
+		{
+			Magazine* magazine = cacheOrNull();
+			std::atomic<uint64_t>* word = nullptr;
+			uint64_t bits = 0;
+			auto flush = [&]() {
+				if (bits) word->fetch_or(bits, std::memory_order_relaxed);
+				bits = 0;
+			};
+
+			try {
+				for (size_t i = 0; i < count; ++i) {
+					uint32_t index = popSlot(magazine);
+					if (&liveWord(index) != word) {
+						flush();
+						word = &liveWord(index);
+					}
+					bits |= liveBit(index);
+					T* object;
+					try {
+						object = construct(index, args...);
+					}
+					catch (...) {
+						flush();
+						putSlot(index);
+						throw;
+					}
+					// output did not take the object if it throws
+					try {
+						output(Iterator(object, index, this));
+					}
+					catch (...) {
+						object->~T();
+						flush();
+						putSlot(index);
+						throw;
+					}
+				}
+			}
+			catch (...) {
+				flush();
+				if (magazine) magazine->updateCount();
+				throw;
+			}
+			flush();
+			if (magazine) magazine->updateCount();
 		}
 
 		void deallocate(Iterator& iterator)
 		{
-			std::lock_guard<std::shared_mutex> lock(m_poolMutex);
 			if (iterator.ptr == nullptr)
-			{
-				__debugbreak();
 				return;
-			}
 
-			m_freeChunks.push_back(iterator.index);
-			m_allocatedChunks.erase(iterator.index);
 			iterator.ptr->~T();
-			if (m_freeChunks.size() + m_allocatedChunks.size() != m_data.size())
-				__debugbreak();
+			putSlot(iterator.index);
+		}
+
+		// Increments need no ordering since the caller already holds a reference. The decrements
+		// release our writes to the object and the last one acquires everybody else's before destroying it.
+		static void releaseShared(Storage* storage)
+		{
+			if (storage->control.sharedCounter.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				storage->object()->~T();
+				releaseWeak(storage);
+			}
+		}
+
+		static void releaseWeak(Storage* storage)
+		{
+			if (storage->control.weakCounter.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				storage->pool->putSlot(storage->index);
 		}
 
 	public:
 
-		MemoryPool() : m_isSet(0) {}
-		MemoryPool(unsigned int size) : m_isSet(0) { set(size); }
-		~MemoryPool() { clear(); }
+		MemoryPool() : m_id(nextPoolId()), m_isSet(0) {}
+		MemoryPool(unsigned int size) : m_id(nextPoolId()), m_isSet(0) { set(size); }
+		MemoryPool(const SlabOptions& options) : m_id(nextPoolId()), m_isSet(0) { set(options); }
+
+		~MemoryPool()
+		{
+			clear();
+			for (auto& magazine : magazines()) {
+				std::lock_guard<std::mutex> ownerLock(magazine->ownerMutex);
+				magazine->pool = nullptr;
+			}
+		}
 
 		MemoryPool(const MemoryPool&) = delete;
 		MemoryPool& operator=(const MemoryPool&) = delete;
 
-		MemoryPool(MemoryPool&&) noexcept = default;
-		MemoryPool& operator=(MemoryPool&&) noexcept = default;
+		MemoryPool(MemoryPool&&) = delete;
+		MemoryPool& operator=(MemoryPool&&) = delete;
 
 		class SharedPointer;
 		class UniquePointer;
 		class WeakPointer;
 
+		// A single slab of size slots that never grows. Not safe alongside any other call.
 		void set(unsigned int size)
 		{
 			if (size == 0) {
 				throw std::invalid_argument("Pool size cannot be zero");
 			}
+			set(SlabOptions{ size, 1, 1 });
+		}
+
+		// Not safe alongside any other call
+		void set(const SlabOptions& options)
+		{
+			if (options.slabSize == 0 || options.maxSlabs == 0) {
+				throw std::invalid_argument("Pool slab size and slab count cannot be zero");
+			}
+			unsigned int shift = static_cast<unsigned int>(std::bit_width(options.slabSize - 1u));
+			if ((uint64_t(options.maxSlabs) << shift) > s_invalidIndex) {
+				throw std::invalid_argument("Pool slabs do not fit 32-bit slot indices");
+			}
 
 			if (m_isSet.load())
 				clear();
-			std::lock_guard<std::shared_mutex> lock(m_poolMutex);
+
+			m_slabSize = options.slabSize;
+			m_slabShift = shift;
+			m_slabMask = static_cast<uint32_t>((uint64_t(1) << shift) - 1);
+
+			// Small slabs get small batches so that a few threads cannot hoard all of them
+			size_t threads = std::max(1u, std::thread::hardware_concurrency());
+			m_cached = options.maxSlabs > 1;
+			m_batchSize = m_cached ? std::clamp<size_t>(m_slabSize / (8 * threads), 1, s_maxBatchSize) : 1;
 
 			try {
-				m_data.resize(size);
-				m_freeChunks.resize(size);
-				for (unsigned int i = 0; i < size; i++) {
-					m_freeChunks[i] = i;
-				}
-				dataPtr = m_data.data();
-				m_isSet = 1;
+				m_slabs.resize(options.maxSlabs);
+				m_slabSlots = std::make_unique<Storage*[]>(options.maxSlabs);
+				m_slabLive = std::make_unique<std::atomic<uint64_t>*[]>(options.maxSlabs);
+				for (unsigned int i = 0; i < std::min(options.initialSlabs, options.maxSlabs); ++i) addSlab();
 			}
 			catch (...) {
-				m_isSet = 0;
-				m_data.clear();
-				m_freeChunks.clear();
+				resetFreeLists();
+				m_slabs.clear();
+				m_slabCount.store(0, std::memory_order_relaxed);
 				throw;
 			}
+			m_isSet = 1;
 		}
 
+		// Destroys every live object and frees all slabs, not safe alongside any other call
 		void clear()
 		{
-			std::lock_guard<std::shared_mutex> lock(m_poolMutex);
+			if (!m_isSet.load()) return;
 			m_isSet = 0;
-			for (size_t i = 0; i < m_data.size(); ++i) {
-				if (std::find(m_freeChunks.begin(), m_freeChunks.end(), i)
-					== m_freeChunks.end()) {
-					reinterpret_cast<T*>(&m_data[i])->~T();
+			resetFreeLists();
+			for (auto& slab : m_slabs) {
+				if (!slab) continue;
+				if constexpr (!std::is_trivially_destructible_v<T>) slab->forEachLive([](T& object) { object.~T(); });
+			}
+			m_slabs.clear();
+			m_slabCount.store(0, std::memory_order_relaxed);
+		}
+
+		// Gives the memory of slabs without live objects back and rebuilds the free chains of the others.
+		// Returns the number of slabs released, not safe alongside any other call.
+		size_t releaseEmptySlabs()
+		{
+			if (!m_isSet.load()) return 0;
+			resetFreeLists();
+			size_t released = 0;
+			for (uint32_t i = 0; i < m_slabs.size(); ++i) {
+				if (!m_slabs[i]) continue;
+				if (m_slabs[i]->isEmpty()) {
+					m_slabs[i].reset();
+					m_slabSlots[i] = nullptr;
+					m_slabLive[i] = nullptr;
+					m_slabCount.fetch_sub(1, std::memory_order_relaxed);
+					++released;
 				}
+				else pushFreeSlots(i);
 			}
-			m_data.clear();
-			m_freeChunks.clear();
-			dataPtr = nullptr;
+			return released;
+		}
+
+		// Calls function(T&) for every live object, not safe alongside allocation or freeing
+		template<typename Function>
+		void forEach(Function&& function)
+		{
+			for (auto& slab : m_slabs)
+				if (slab) slab->forEachLive(function);
 		}
 
+		// Exact only while no other thread allocates or frees
 		unsigned int getAllocatedSize() const
 		{
-			std::shared_lock<std::shared_mutex> lock(m_poolMutex);
-			return m_allocatedChunks.size();
+			return static_cast<unsigned int>(capacity() - getFreeSize());
 		}
 
 		unsigned int getFreeSize() const
 		{
-			std::shared_lock<std::shared_mutex> lock(m_poolMutex);
-			return m_freeChunks.size();
+			size_t free = m_sharedFreeCount.load(std::memory_order_relaxed);
+			std::lock_guard<std::mutex> lock(m_magazineMutex);
+			for (auto& magazine : m_magazines) free += magazine->freeCount.load(std::memory_order_relaxed);
+			return static_cast<unsigned int>(free);
 		}
 
 		bool isInitialized() const {
-			std::shared_lock<std::shared_mutex> lock(m_poolMutex);
 			return m_isSet.load();
 		}
 
 		size_t capacity() const {
-			std::shared_lock<std::shared_mutex> lock(m_poolMutex);
-			return m_data.size();
+			return m_slabCount.load(std::memory_order_relaxed) * m_slabSize;
+		}
+
+		size_t getSlabCount() const {
+			return m_slabCount.load(std::memory_order_relaxed);
 		}
 
 		friend class SharedPointer;
 		friend class UniquePointer;
+		friend class WeakPointer;
 
-		SharedPointer makeShared()
+		// Constructs T in place from args
+		template<typename... Args>
+		SharedPointer makeShared(Args&&... args)
 		{
-			SharedPointer ptr = allocate();
+			SharedPointer ptr = allocate(std::forward<Args>(args)...);
 			return ptr;
 		}
 
-		SharedPointer makeShared(const T& data)
+		template<typename... Args>
+		UniquePointer makeUnique(Args&&... args)
 		{
-			SharedPointer ptr = allocate();
-			*ptr = data;
+			UniquePointer ptr = allocate(std::forward<Args>(args)...);
 			return ptr;
 		}
 
-		UniquePointer makeUnique()
+		// count objects constructed from copies of args, cheaper than count makeUnique calls
+		template<typename... Args>
+		std::vector<UniquePointer> makeUniqueN(size_t count, const Args&... args)
 		{
-			UniquePointer ptr = allocate();
-			return ptr;
-		}
-
-		UniquePointer makeUnique(const T& data)
-		{
-			UniquePointer ptr = allocate();
-			*ptr = data;
-			return ptr;
+			std::vector<UniquePointer> pointers;
+			pointers.reserve(count);
+			allocateN(count, [&pointers](const Iterator& iterator) { pointers.emplace_back(iterator); }, args...);
+			return pointers;
 		}
 
 	};
@@ -209,4 +654,4 @@ namespace MultiThreading
 #include "WeakPointer.h"
 #include "UniquePointer.h"
 
-#endif //MEMORYPOOL_H
\ No newline at end of file
+#endif //MEMORYPOOL_H
@@ -1,16 +1,16 @@
 #pragma once
 #include "CommonApi/Namespaces.h"
 
+#include <atomic>
+#include <cstdint>
+
 namespace MultiThreading
 {
+	// Reference counts of a pooled object, kept in its slot. All shared owners together hold one weak
+	// reference: the object dies with the last shared owner, the slot is freed with the last weak one.
 	struct PointerControlBlock
 	{
-		size_t sharedCounter = 1;
-		size_t weakCounter = 0;
-
-		size_t objectSize = 0;			// Size of managed object
-		bool isArray = false;			// Array handling flag
-		char typeInfo;					// Type information
-		void* userData;					// User-defined data
+		std::atomic<uint32_t> sharedCounter = 1;
+		std::atomic<uint32_t> weakCounter = 1;
 	};
-}
\ No newline at end of file
+}
@@ -3,7 +3,9 @@
 
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
 #include <queue>
+#include <utility>
 
 namespace MultiThreading
 {
@@ -20,13 +22,13 @@ namespace MultiThreading
 
         Queue(Queue&& other) noexcept {
             std::lock_guard<std::mutex> lock(other.mutex);
-            deque = std::exchange(other.deque, std::queue<T>());
+            queue = std::exchange(other.queue, std::queue<T>());
         }
 
         Queue& operator=(Queue&& other) noexcept {
             if (this != &other) {
                 std::scoped_lock locks(mutex, other.mutex);
-                deque = std::exchange(other.deque, std::queue<T>());
+                queue = std::exchange(other.queue, std::queue<T>());
             }
             return *this;
         }
@@ -68,11 +70,6 @@ namespace MultiThreading
         void waitAndPop(T& value) {
             std::unique_lock<std::mutex> lock(mutex);
 
-            if (!queue.empty()) {
-                value = std::move(queue.front());
-                queue.pop();
-            }
-
             notEmpty.wait(lock, [this]() { return !queue.empty(); });
             value = std::move(queue.front());
             queue.pop();
@@ -0,0 +1,201 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace MultiThreading
+{
+    // Append-only concurrent vector made of segments of 64, 128, 256, ... elements that never move,
+    // so references and pointers to elements stay valid for the vector's lifetime. pushBack claims an
+    // index with one fetch_add, installs a missing segment with one CAS, constructs in place and marks
+    // the element ready in its segment's bitmap, so it never waits on another thread.
+    // Reads are lock-free, clear and destruction must not race with other calls.
+    template <typename T>
+    class SegmentedVector
+    {
+    private:
+        static constexpr unsigned s_firstSegmentBits = 6;
+        static constexpr size_t s_firstSegmentSize = size_t(1) << s_firstSegmentBits;
+        static constexpr size_t s_segmentCount = sizeof(size_t) * 8 - s_firstSegmentBits;
+        static constexpr size_t s_alignment = std::max(alignof(T), alignof(std::atomic<uint64_t>));
+
+        // Segment k holds s_firstSegmentSize << k elements followed by one ready bit per element
+        std::array<std::atomic<unsigned char*>, s_segmentCount> m_segments{};
+        alignas(64) std::atomic<size_t> m_size = 0;
+
+        struct Location {
+            size_t segment;
+            size_t offset;
+        };
+
+        static inline Location locate(size_t index) {
+            size_t biased = index + s_firstSegmentSize;
+            size_t segment = static_cast<size_t>(std::bit_width(biased)) - 1 - s_firstSegmentBits;
+            return Location{ segment, biased - (s_firstSegmentSize << segment) };
+        }
+
+        static inline size_t segmentSize(size_t segment) { return s_firstSegmentSize << segment; }
+
+        static inline size_t bitsOffset(size_t segment) {
+            size_t bytes = segmentSize(segment) * sizeof(T);
+            return (bytes + alignof(std::atomic<uint64_t>) - 1) / alignof(std::atomic<uint64_t>) * alignof(std::atomic<uint64_t>);
+        }
+
+        static inline size_t allocationSize(size_t segment) {
+            return bitsOffset(segment) + segmentSize(segment) / 64 * sizeof(std::atomic<uint64_t>);
+        }
+
+        static inline T* element(unsigned char* base, size_t offset) {
+            return std::launder(reinterpret_cast<T*>(base + offset * sizeof(T)));
+        }
+
+        static inline std::atomic<uint64_t>* readyBits(unsigned char* base, size_t segment) {
+            return std::launder(reinterpret_cast<std::atomic<uint64_t>*>(base + bitsOffset(segment)));
+        }
+
+        // Installs the segment if it is missing, at most one allocation per caller and no retries
+        unsigned char* segmentFor(size_t segment) {
+            unsigned char* base = m_segments[segment].load(std::memory_order_acquire);
+            if (base) return base;
+
+            unsigned char* allocated = static_cast<unsigned char*>(::operator new(allocationSize(segment), std::align_val_t(s_alignment)));
+            std::atomic<uint64_t>* bits = reinterpret_cast<std::atomic<uint64_t>*>(allocated + bitsOffset(segment));
+            for (size_t i = 0; i < segmentSize(segment) / 64; ++i) new (bits + i) std::atomic<uint64_t>(0);
+
+            if (m_segments[segment].compare_exchange_strong(base, allocated, std::memory_order_acq_rel, std::memory_order_acquire))
+                return allocated;
+            freeSegment(allocated, segment);
+            return base;
+        }
+
+        static void freeSegment(unsigned char* base, size_t segment) {
+            std::atomic<uint64_t>* bits = readyBits(base, segment);
+            for (size_t i = 0; i < segmentSize(segment) / 64; ++i) bits[i].~atomic();
+            ::operator delete(base, std::align_val_t(s_alignment));
+        }
+
+        // Destroys the ready elements and frees every segment
+        void release() {
+            for (size_t segment = 0; segment < s_segmentCount; ++segment) {
+                unsigned char* base = m_segments[segment].exchange(nullptr, std::memory_order_relaxed);
+                if (!base) continue;
+                if constexpr (!std::is_trivially_destructible_v<T>) {
+                    std::atomic<uint64_t>* bits = readyBits(base, segment);
+                    for (size_t word = 0; word < segmentSize(segment) / 64; ++word)
+                        for (uint64_t ready = bits[word].load(std::memory_order_relaxed); ready; ready &= ready - 1)
+                            element(base, word * 64 + std::countr_zero(ready))->~T();
+                }
+                freeSegment(base, segment);
+            }
+            m_size.store(0, std::memory_order_relaxed);
+        }
+
+    public:
+        SegmentedVector() = default;
+
+        SegmentedVector(const SegmentedVector&) = delete;
+        SegmentedVector& operator=(const SegmentedVector&) = delete;
+        SegmentedVector(SegmentedVector&&) = delete;
+        SegmentedVector& operator=(SegmentedVector&&) = delete;
+
+        ~SegmentedVector() {
+            release();
+        }
+
+        // Returns the element's index. If the constructor throws the index stays claimed but never becomes ready.
+        template<typename... Args>
+        size_t emplaceBack(Args&&... args) {
+            size_t index = m_size.fetch_add(1, std::memory_order_relaxed);
+            Location location = locate(index);
+            unsigned char* base = segmentFor(location.segment);
+            new (base + location.offset * sizeof(T)) T(std::forward<Args>(args)...);
+            readyBits(base, location.segment)[location.offset / 64].fetch_or(uint64_t(1) << (location.offset % 64), std::memory_order_release);
+            return index;
+        }
+
+        inline size_t pushBack(const T& value) { return emplaceBack(value); }
+        inline size_t pushBack(T&& value) { return emplaceBack(std::move(value)); }
+
+        // Element index, which must be ready for the calling thread: returned by its own pushBack,
+        // or handed over by the thread that pushed it, or seen through tryGet or forEach
+        inline T& operator[](size_t index) {
+            Location location = locate(index);
+            return *element(m_segments[location.segment].load(std::memory_order_acquire), location.offset);
+        }
+
+        inline const T& operator[](size_t index) const {
+            Location location = locate(index);
+            return *element(m_segments[location.segment].load(std::memory_order_acquire), location.offset);
+        }
+
+        // nullptr if index was not claimed yet or its element is still being constructed
+        T* tryGet(size_t index) {
+            if (index >= m_size.load(std::memory_order_acquire)) return nullptr;
+            Location location = locate(index);
+            unsigned char* base = m_segments[location.segment].load(std::memory_order_acquire);
+            if (!base) return nullptr;
+            uint64_t ready = readyBits(base, location.segment)[location.offset / 64].load(std::memory_order_acquire);
+            return ready & (uint64_t(1) << (location.offset % 64)) ? element(base, location.offset) : nullptr;
+        }
+
+        inline const T* tryGet(size_t index) const {
+            return const_cast<SegmentedVector*>(this)->tryGet(index);
+        }
+
+        // Throws std::out_of_range unless the element is ready
+        inline T& at(size_t index) {
+            if (T* value = tryGet(index)) return *value;
+            throw std::out_of_range("SegmentedVector element is not ready");
+        }
+
+        inline const T& at(size_t index) const {
+            return const_cast<SegmentedVector*>(this)->at(index);
+        }
+
+        // Calls function(index, element) for every ready element in index order
+        template<typename Function>
+        void forEach(Function&& function) {
+            size_t size = m_size.load(std::memory_order_acquire);
+            for (size_t segment = 0; segment < s_segmentCount && segmentSize(segment) - s_firstSegmentSize < size; ++segment) {
+                unsigned char* base = m_segments[segment].load(std::memory_order_acquire);
+                if (!base) continue;
+                size_t first = segmentSize(segment) - s_firstSegmentSize;
+                std::atomic<uint64_t>* bits = readyBits(base, segment);
+                for (size_t word = 0; word < segmentSize(segment) / 64 && first + word * 64 < size; ++word)
+                    for (uint64_t ready = bits[word].load(std::memory_order_acquire); ready; ready &= ready - 1) {
+                        size_t offset = word * 64 + std::countr_zero(ready);
+                        function(first + offset, *element(base, offset));
+                    }
+            }
+        }
+
+        template<typename Function>
+        void forEach(Function&& function) const {
+            const_cast<SegmentedVector*>(this)->forEach([&](size_t index, const T& value) { function(index, value); });
+        }
+
+        // Allocates the segments up to capacity elements ahead of time, safe alongside pushBack
+        void reserve(size_t capacity) {
+            if (capacity == 0) return;
+            for (size_t segment = 0; segment <= locate(capacity - 1).segment; ++segment) segmentFor(segment);
+        }
+
+        // Indices claimed so far, the elements of the most recent ones may still be under construction
+        inline size_t size() const { return m_size.load(std::memory_order_acquire); }
+        inline bool empty() const { return size() == 0; }
+
+        // Not safe alongside any other call
+        void clear() {
+            release();
+        }
+    };
+}
@@ -8,77 +8,42 @@
 //Shared pointer
 namespace MultiThreading
 {
+	// One pointer to the pooled slot, whose header holds the reference counts
 	template <typename T>
 	class MemoryPool<T>::SharedPointer
 	{
 	public:
 		static const SharedPointer nullPtr;
 	private:
-		Iterator m_iterator;
-		Synchronized<PointerControlBlock>* m_controlBlock;
+		Storage* m_storage;
 
-		//control block access is only here
 		inline void cleanup()
 		{
-			bool isLast = false;
-			if (m_controlBlock)
-			{
-				auto access = m_controlBlock->getWriteAccess();
-				if (!--access->sharedCounter)
-				{
-					m_iterator.pool->deallocate(m_iterator);
-					if (!access->weakCounter)
-						isLast = true;
-				}
-			}
-			if (isLast)
-				delete m_controlBlock;
-			nullify();
+			if (m_storage)
+				MemoryPool::releaseShared(m_storage);
+			m_storage = nullptr;
 		}
 
-		inline void nullify()
-		{
-			m_iterator = { nullptr, 0, nullptr };
-			m_controlBlock = nullptr;
-		}
-
-		SharedPointer(const Iterator& iter, Synchronized<PointerControlBlock>* controlBlock)
-		{
-			m_iterator = iter;
-			m_controlBlock = controlBlock;
-		};
+		// Adopts a shared reference the caller already counted
+		explicit SharedPointer(Storage* storage) : m_storage(storage) {};
 
 	public:
-		SharedPointer() :
-			m_iterator(Iterator{ nullptr, 0, nullptr }),
-			m_controlBlock(nullptr) {};
+		SharedPointer() : m_storage(nullptr) {};
 
-		SharedPointer(std::nullptr_t) :
-			m_iterator(Iterator{ nullptr, 0, nullptr }),
-			m_controlBlock(nullptr) {};
+		SharedPointer(std::nullptr_t) : m_storage(nullptr) {};
 
-		SharedPointer(const SharedPointer& other) :
-			m_iterator(other.m_iterator),
-			m_controlBlock(other.m_controlBlock)
+		SharedPointer(const SharedPointer& other) : m_storage(other.m_storage)
 		{
-			if (m_controlBlock)
-			{
-				auto access = m_controlBlock->getWriteAccess();
-				access->sharedCounter++;
-			}
+			if (m_storage)
+				m_storage->control.sharedCounter.fetch_add(1, std::memory_order_relaxed);
 		};
 
-		SharedPointer(const Iterator& iter)
-		{
-			m_iterator = iter;
-			m_controlBlock = new Synchronized<PointerControlBlock>;
-		};
+		SharedPointer(const Iterator& iter) :
+			m_storage(iter.ptr ? iter.pool->slot(iter.index) : nullptr) {};
 
-		SharedPointer(SharedPointer&& other) noexcept :
-			m_iterator(other.m_iterator),
-			m_controlBlock(other.m_controlBlock)
+		SharedPointer(SharedPointer&& other) noexcept : m_storage(other.m_storage)
 		{
-			other.nullify();
+			other.m_storage = nullptr;
 		}
 
 		~SharedPointer()
@@ -97,22 +62,17 @@ namespace MultiThreading
 			if (this == &other)
 				return *this;
 
+			if (other.m_storage)
+				other.m_storage->control.sharedCounter.fetch_add(1, std::memory_order_relaxed);
 			cleanup();
-			m_iterator = other.m_iterator;
-			m_controlBlock = other.m_controlBlock;
-			if (m_controlBlock)
-			{
-				auto access = m_controlBlock->getWriteAccess();
-				access->sharedCounter++;
-			}
+			m_storage = other.m_storage;
 			return *this;
 		};
 
 		SharedPointer& operator=(const Iterator& other)
 		{
 			cleanup();
-			m_iterator = other;
-			m_controlBlock = new Synchronized<PointerControlBlock>;
+			m_storage = other.ptr ? other.pool->slot(other.index) : nullptr;
 			return *this;
 		};
 
@@ -122,11 +82,8 @@ namespace MultiThreading
 				return *this;
 
 			cleanup();
-
-			m_iterator = other.m_iterator;
-			m_controlBlock = other.m_controlBlock;
-
-			other.nullify();
+			m_storage = other.m_storage;
+			other.m_storage = nullptr;
 			return *this;
 		}
 
@@ -135,12 +92,7 @@ namespace MultiThreading
 		}
 
 		size_t getCount() const {
-			if (m_controlBlock)
-			{
-				auto access = m_controlBlock->getWriteAccess();
-				return access->sharedCounter;
-			}
-			return 0;
+			return m_storage ? m_storage->control.sharedCounter.load(std::memory_order_relaxed) : 0;
 		}
 
 		WeakPointer makeWeak() const {
@@ -148,33 +100,33 @@ namespace MultiThreading
 		}
 
 		inline T& operator*() {
-			if (!m_iterator.ptr) throw std::runtime_error("Dereferencing a null pointer");
-			return *m_iterator.ptr;
+			if (!m_storage) throw std::runtime_error("Dereferencing a null pointer");
+			return *m_storage->object();
 		};
 
 		inline const T& operator*() const {
-			if (!m_iterator.ptr) throw std::runtime_error("Dereferencing a null pointer");
-			return *m_iterator.ptr;
+			if (!m_storage) throw std::runtime_error("Dereferencing a null pointer");
+			return *m_storage->object();
 		};
 
 		inline T* operator->() {
-			if (!m_iterator.ptr) throw std::runtime_error("Dereferencing a null pointer");
-			return m_iterator.ptr;
+			if (!m_storage) throw std::runtime_error("Dereferencing a null pointer");
+			return m_storage->object();
 		};
 
 		inline const T* operator->() const {
-			if (!m_iterator.ptr) throw std::runtime_error("Dereferencing a null pointer");
-			return m_iterator.ptr;
+			if (!m_storage) throw std::runtime_error("Dereferencing a null pointer");
+			return m_storage->object();
 		};
 
 		explicit operator bool() const {
-			return m_iterator.ptr != nullptr;
+			return m_storage != nullptr;
 		}
 
-		bool operator==(std::nullptr_t) const { return m_iterator.ptr == nullptr; };
-		bool operator!=(std::nullptr_t) const { return m_iterator.ptr != nullptr; };
-		bool operator==(const SharedPointer& other) const { return m_iterator.ptr == other.m_iterator.ptr; };
-		bool operator!=(const SharedPointer& other) const { return m_iterator.ptr != other.m_iterator.ptr; };
+		bool operator==(std::nullptr_t) const { return m_storage == nullptr; };
+		bool operator!=(std::nullptr_t) const { return m_storage != nullptr; };
+		bool operator==(const SharedPointer& other) const { return m_storage == other.m_storage; };
+		bool operator!=(const SharedPointer& other) const { return m_storage != other.m_storage; };
 
 		friend class WeakPointer;
 	};
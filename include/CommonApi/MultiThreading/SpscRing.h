@@ -0,0 +1,153 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace MultiThreading
+{
+    // Wait-free ring for exactly one producer thread and one consumer thread. Each side keeps a private
+    // copy of the other side's index and only reloads the shared one when the copy says the ring is
+    // full or empty, so in steady state the two cache lines are not bounced between cores.
+    // Capacity is rounded up to a power of two and fixed at construction.
+    //
+    // For trivially copyable T the ring can be written and read in place: reserve hands the producer
+    // a span of free slots that commit publishes, peek hands the consumer a span of filled slots that
+    // release frees. Spans never wrap, a second call picks up the part at the start of the buffer.
+    template <typename T>
+    class SpscRing
+    {
+    private:
+        static constexpr size_t s_cacheLine = 64;
+        static constexpr bool s_inPlace = std::is_trivially_copyable_v<T>;
+
+        struct Deleter {
+            inline void operator()(T* slots) const {
+                ::operator delete(static_cast<void*>(slots), std::align_val_t(alignof(T)));
+            }
+        };
+
+        std::unique_ptr<T, Deleter> m_slots;
+        size_t m_mask;
+
+        // Producer side
+        alignas(s_cacheLine) std::atomic<size_t> m_writePosition = 0;
+        size_t m_cachedReadPosition = 0;
+
+        // Consumer side
+        alignas(s_cacheLine) std::atomic<size_t> m_readPosition = 0;
+        size_t m_cachedWritePosition = 0;
+
+        static size_t roundCapacity(size_t capacity) {
+            size_t rounded = 2;
+            while (rounded < capacity) rounded <<= 1;
+            return rounded;
+        }
+
+        inline T* slot(size_t position) const { return m_slots.get() + (position & m_mask); }
+
+        // Producer only, free slots from position on
+        inline size_t freeCount(size_t position, size_t wanted) {
+            size_t available = capacity() - (position - m_cachedReadPosition);
+            if (available < wanted) {
+                m_cachedReadPosition = m_readPosition.load(std::memory_order_acquire);
+                available = capacity() - (position - m_cachedReadPosition);
+            }
+            return available;
+        }
+
+        // Consumer only, filled slots from position on
+        inline size_t filledCount(size_t position, size_t wanted) {
+            size_t available = m_cachedWritePosition - position;
+            if (available < wanted) {
+                m_cachedWritePosition = m_writePosition.load(std::memory_order_acquire);
+                available = m_cachedWritePosition - position;
+            }
+            return available;
+        }
+
+    public:
+        explicit SpscRing(size_t capacity) : m_mask(roundCapacity(capacity) - 1) {
+            m_slots.reset(static_cast<T*>(::operator new(sizeof(T) * (m_mask + 1), std::align_val_t(alignof(T)))));
+        }
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+        SpscRing(SpscRing&&) = delete;
+        SpscRing& operator=(SpscRing&&) = delete;
+
+        ~SpscRing() {
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                size_t end = m_writePosition.load(std::memory_order_relaxed);
+                for (size_t position = m_readPosition.load(std::memory_order_relaxed); position != end; ++position)
+                    slot(position)->~T();
+            }
+        }
+
+        // Producer only, returns false without constructing anything when the ring is full
+        template<typename... Args>
+        bool tryEmplace(Args&&... args) {
+            size_t position = m_writePosition.load(std::memory_order_relaxed);
+            if (freeCount(position, 1) == 0) return false;
+            new (slot(position)) T(std::forward<Args>(args)...);
+            m_writePosition.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        inline bool tryPush(const T& value) { return tryEmplace(value); }
+        inline bool tryPush(T&& value) { return tryEmplace(std::move(value)); }
+
+        // Consumer only, returns false when the ring is empty
+        bool tryPop(T& value) {
+            size_t position = m_readPosition.load(std::memory_order_relaxed);
+            if (filledCount(position, 1) == 0) return false;
+            T* element = slot(position);
+            value = std::move(*element);
+            element->~T();
+            m_readPosition.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Producer only, up to maxCount contiguous free slots to write in place, empty when the ring is full
+        std::span<T> reserve(size_t maxCount) requires s_inPlace {
+            size_t position = m_writePosition.load(std::memory_order_relaxed);
+            size_t toEnd = capacity() - (position & m_mask);
+            size_t count = std::min({ freeCount(position, std::min(maxCount, toEnd)), maxCount, toEnd });
+            return std::span<T>(slot(position), count);
+        }
+
+        // Producer only, publishes the first count slots of the last reserve
+        inline void commit(size_t count) requires s_inPlace {
+            m_writePosition.store(m_writePosition.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        }
+
+        // Consumer only, up to maxCount contiguous filled slots to read in place, empty when the ring is empty
+        std::span<const T> peek(size_t maxCount = SIZE_MAX) requires s_inPlace {
+            size_t position = m_readPosition.load(std::memory_order_relaxed);
+            size_t toEnd = capacity() - (position & m_mask);
+            size_t count = std::min({ filledCount(position, std::min(maxCount, toEnd)), maxCount, toEnd });
+            return std::span<const T>(slot(position), count);
+        }
+
+        // Consumer only, frees the first count slots of the last peek
+        inline void release(size_t count) requires s_inPlace {
+            m_readPosition.store(m_readPosition.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        }
+
+        inline size_t capacity() const { return m_mask + 1; }
+
+        // Racy snapshot, exact only from the producer or the consumer while the other side is idle
+        inline size_t sizeApprox() const {
+            size_t readPosition = m_readPosition.load(std::memory_order_acquire);
+            return m_writePosition.load(std::memory_order_acquire) - readPosition;
+        }
+
+        inline bool emptyApprox() const { return sizeApprox() == 0; }
+    };
+}
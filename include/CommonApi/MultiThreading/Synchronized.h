@@ -4,10 +4,26 @@
 #include <shared_mutex>
 #include <mutex>
 #include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 namespace MultiThreading
 {
-	template <typename T>
+	// Access policies for Synchronized
+	struct SharedMutexPolicy {};	// writers lock exclusively, readers share a std::shared_mutex
+	struct SeqlockPolicy {};		// trivially copyable T, readers copy the value and retry if a writer got in between
+	struct RcuPolicy {};			// readers pin an immutable snapshot, writers publish a modified copy
+
+	template <typename T, typename Policy = SharedMutexPolicy>
 	class Synchronized
 	{
 
@@ -139,25 +155,263 @@ namespace MultiThreading
 			return ReadAccess(m_data, m_mutex);
 		}
 
-		inline bool tryWriteAccess(WriteAccess access)
+		inline bool tryWriteAccess(WriteAccess& access)
 		{
 			std::unique_lock<std::shared_mutex> lock(m_mutex, std::try_to_lock);
 			if (!lock.owns_lock()) {
-				return 0;
+				return false;
 			}
 			access = WriteAccess(m_data, lock);
-			return 1;
+			return true;
 		}
 
-		inline bool tryReadAccess(ReadAccess access) const
+		inline bool tryReadAccess(ReadAccess& access) const
 		{
 			std::shared_lock<std::shared_mutex> lock(m_mutex, std::try_to_lock);
 			if (!lock.owns_lock()) {
-				return 0;
+				return false;
 			}
 			access = ReadAccess(m_data, lock);
-			return 1;
+			return true;
 		}
 	};
-}
 
+	// Readers copy the value out and retry if a writer changed it meanwhile, so they never write to shared
+	// memory. A writer owns the object while the sequence is odd, there is no mutex. Keep updates short,
+	// readers spin until they finish.
+	template <typename T>
+	class Synchronized<T, SeqlockPolicy>
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "SeqlockPolicy needs a trivially copyable T");
+
+	private:
+		using Word = uint64_t;
+		static constexpr size_t s_wordCount = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+		alignas(64) std::atomic<uint64_t> m_sequence = 0;
+		std::array<std::atomic<Word>, s_wordCount> m_words{};
+
+		// Kept in atomic words, a reader racing a writer copies a mix of old and new words that it then discards
+		inline void storeWords(const T& value) {
+			std::array<unsigned char, s_wordCount * sizeof(Word)> bytes{};
+			std::memcpy(bytes.data(), &value, sizeof(T));
+			for (size_t i = 0; i < s_wordCount; ++i) {
+				Word word;
+				std::memcpy(&word, bytes.data() + i * sizeof(Word), sizeof(Word));
+				m_words[i].store(word, std::memory_order_relaxed);
+			}
+		}
+
+		inline T loadWords() const {
+			std::array<unsigned char, s_wordCount * sizeof(Word)> bytes;
+			for (size_t i = 0; i < s_wordCount; ++i) {
+				Word word = m_words[i].load(std::memory_order_relaxed);
+				std::memcpy(bytes.data() + i * sizeof(Word), &word, sizeof(Word));
+			}
+			std::array<unsigned char, sizeof(T)> valueBytes;
+			std::memcpy(valueBytes.data(), bytes.data(), sizeof(T));
+			return std::bit_cast<T>(valueBytes);
+		}
+
+		// Makes the sequence odd, returns the odd value
+		uint64_t beginWrite() {
+			uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+			while ((sequence & 1) || !m_sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+				if (sequence & 1) {
+					std::this_thread::yield();
+					sequence = m_sequence.load(std::memory_order_relaxed);
+				}
+			}
+			std::atomic_thread_fence(std::memory_order_release);
+			return sequence + 1;
+		}
+
+		inline void endWrite(uint64_t sequence) {
+			m_sequence.store(sequence + 1, std::memory_order_release);
+		}
+
+	public:
+		Synchronized() : Synchronized(T()) {}
+
+		explicit Synchronized(const T& value) {
+			storeWords(value);
+		}
+
+		Synchronized(const Synchronized&) = delete;
+		Synchronized& operator=(const Synchronized&) = delete;
+
+		// One read attempt, false if a writer was active
+		bool tryLoad(T& value) const {
+			uint64_t sequence = m_sequence.load(std::memory_order_acquire);
+			if (sequence & 1) return false;
+			T copy = loadWords();
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (m_sequence.load(std::memory_order_relaxed) != sequence) return false;
+			value = copy;
+			return true;
+		}
+
+		T load() const {
+			while (true) {
+				uint64_t sequence = m_sequence.load(std::memory_order_acquire);
+				if (sequence & 1) {
+					std::this_thread::yield();
+					continue;
+				}
+				T value = loadWords();
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (m_sequence.load(std::memory_order_relaxed) == sequence) return value;
+			}
+		}
+
+		void store(const T& value) {
+			uint64_t sequence = beginWrite();
+			storeWords(value);
+			endWrite(sequence);
+		}
+
+		// Calls function(T&) on the current value and stores the result, the value is unchanged if it throws
+		template<typename Function>
+		void update(Function&& function) {
+			uint64_t sequence = beginWrite();
+			try {
+				T value = loadWords();
+				function(value);
+				storeWords(value);
+			}
+			catch (...) {
+				endWrite(sequence);
+				throw;
+			}
+			endWrite(sequence);
+		}
+	};
+
+	// Readers pin the current snapshot with a counter in a slot of their own and never wait on writers.
+	// Writers, one at a time, publish a modified copy and free the old one once no reader can still hold it.
+	// A thread must not write while it holds a ReadAccess of the same object, the write would wait for it.
+	template <typename T>
+	class Synchronized<T, RcuPolicy>
+	{
+	private:
+		// Readers pinned under an even and an odd epoch
+		struct alignas(64) ReaderSlot {
+			std::atomic<uint32_t> pins[2]{};
+		};
+
+	public:
+		struct ReadAccess
+		{
+			ReadAccess() : data(nullptr), pin(nullptr) {};
+
+			~ReadAccess() {
+				if (pin) pin->fetch_sub(1, std::memory_order_release);
+			}
+
+			ReadAccess(ReadAccess&& other) noexcept
+				: data(std::exchange(other.data, nullptr)), pin(std::exchange(other.pin, nullptr)) {}
+
+			ReadAccess& operator=(ReadAccess&& other) noexcept {
+				if (this != &other) {
+					if (pin) pin->fetch_sub(1, std::memory_order_release);
+					data = std::exchange(other.data, nullptr);
+					pin = std::exchange(other.pin, nullptr);
+				}
+				return *this;
+			}
+
+			ReadAccess(const ReadAccess&) = delete;
+			ReadAccess& operator=(const ReadAccess&) = delete;
+
+			inline const T& operator*() const {
+				if (!data) throw std::runtime_error("Dereferencing a null pointer");
+				return *data;
+			};
+
+			inline const T* operator->() const {
+				if (!data) throw std::runtime_error("Dereferencing a null pointer");
+				return data;
+			};
+
+		private:
+			friend class Synchronized;
+
+			ReadAccess(const T* data, std::atomic<uint32_t>* pin) : data(data), pin(pin) {}
+
+			const T* data;
+			std::atomic<uint32_t>* pin;
+		};
+
+	private:
+		std::atomic<const T*> m_current;
+		std::atomic<uint64_t> m_epoch = 0;
+		std::unique_ptr<ReaderSlot[]> m_slots;
+		size_t m_slotMask;
+		std::mutex m_writeMutex;
+
+		static inline size_t threadSlot() {
+			static std::atomic<size_t> s_nextSlot = 0;
+			thread_local size_t slot = s_nextSlot.fetch_add(1, std::memory_order_relaxed);
+			return slot;
+		}
+
+		// Write mutex held. A reader that pinned an epoch and still saw it afterwards is waited for by the
+		// first flip after that, so the old value is freed only once nobody can hold it.
+		void publish(std::unique_ptr<T> value) {
+			const T* old = m_current.exchange(value.release(), std::memory_order_seq_cst);
+			uint64_t epoch = m_epoch.fetch_add(1, std::memory_order_seq_cst);
+			for (size_t i = 0; i <= m_slotMask; ++i)
+				while (m_slots[i].pins[epoch & 1].load(std::memory_order_acquire) != 0) std::this_thread::yield();
+			delete old;
+		}
+
+	public:
+		Synchronized() : Synchronized(T()) {}
+
+		explicit Synchronized(T value) : m_current(new T(std::move(value))) {
+			size_t slotCount = std::bit_ceil(std::clamp<size_t>(std::thread::hardware_concurrency(), 4, 64));
+			m_slots = std::make_unique<ReaderSlot[]>(slotCount);
+			m_slotMask = slotCount - 1;
+		}
+
+		Synchronized(const Synchronized&) = delete;
+		Synchronized& operator=(const Synchronized&) = delete;
+
+		~Synchronized() {
+			delete m_current.load(std::memory_order_relaxed);
+		}
+
+		// Pins the current snapshot, which stays valid and unchanged until the access is destroyed
+		ReadAccess getReadAccess() const {
+			ReaderSlot& slot = m_slots[threadSlot() & m_slotMask];
+			while (true) {
+				uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+				std::atomic<uint32_t>& pin = slot.pins[epoch & 1];
+				pin.fetch_add(1, std::memory_order_seq_cst);
+				if (m_epoch.load(std::memory_order_seq_cst) == epoch)
+					return ReadAccess(m_current.load(std::memory_order_seq_cst), &pin);
+				pin.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+
+		inline T load() const {
+			return *getReadAccess();
+		}
+
+		// Replaces the value, returns once no reader can see the old one
+		void store(T value) {
+			auto next = std::make_unique<T>(std::move(value));
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			publish(std::move(next));
+		}
+
+		// Calls function(T&) on a copy of the current value and publishes the copy
+		template<typename Function>
+		void update(Function&& function) {
+			std::lock_guard<std::mutex> lock(m_writeMutex);
+			auto next = std::make_unique<T>(*m_current.load(std::memory_order_relaxed));
+			function(*next);
+			publish(std::move(next));
+		}
+	};
+}
@@ -1,45 +1,321 @@
 #pragma once
 #include "CommonApi/Namespaces.h"
+#include "CommonApi/MultiThreading/ThreadPools/MinimalThreadPool.h"
 
+#include <algorithm>
 #include <atomic>
-#include <functional>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
 namespace MultiThreading
 {
-	template<typename ThreadPoolType>
+	// Limits how many tasks a producer has in a MinimalThreadPool at once. Admission takes a slot with a
+	// compare-exchange, the slot is released when the task finished, was skipped because its stop token
+	// was triggered before it started, or was dropped by the pool without running (flush).
+	// Tasks take (), (size_t threadIndex) or (std::stop_token) like pool tasks do.
 	class TaskCoordinator
 	{
+	public:
+		// Counters since construction or the last resetStatistics, read one by one while tasks update them.
+		// Queue time is measured from admission until a worker starts the task.
+		struct Statistics {
+			size_t pendingCount = 0;
+			size_t maxPendingTasks = 0;
+			uint64_t admittedCount = 0;
+			uint64_t rejectedCount = 0;			// tryAddTask found no slot or addTask timed out
+			uint64_t completedCount = 0;
+			uint64_t failedCount = 0;			// threw, the pool reports the exception
+			uint64_t cancelledCount = 0;		// stop requested before the task started, or dropped by the pool
+			std::chrono::nanoseconds totalQueueTime{ 0 };
+			std::chrono::nanoseconds maxQueueTime{ 0 };
+			std::chrono::nanoseconds elapsed{ 0 };
+
+			inline std::chrono::nanoseconds averageQueueTime() const {
+				uint64_t started = completedCount + failedCount;
+				return started ? totalQueueTime / static_cast<int64_t>(started) : std::chrono::nanoseconds(0);
+			}
+
+			// Finished tasks per second
+			inline double throughput() const {
+				return elapsed.count() > 0 ? static_cast<double>(completedCount + failedCount) * 1e9 / elapsed.count() : 0.0;
+			}
+		};
+
 	private:
-		unsigned int m_maxPendingTasks;
-		std::atomic<unsigned int> m_pendingTasks;
-		ThreadPoolType& m_threadPoolHandle;
+		enum class Outcome {
+			Completed,
+			Failed,
+			Cancelled,
+		};
+
+		// Holds the admission slot until it is run or destroyed
+		template<typename Task>
+		class CoordinatedTask {
+		private:
+			TaskCoordinator* m_coordinator;
+			Task m_task;
+			std::stop_token m_stopToken;
+			int64_t m_admitTime;
+
+		public:
+			template<typename Callable>
+			CoordinatedTask(TaskCoordinator& coordinator, Callable&& task, std::stop_token stopToken, int64_t admitTime) :
+				m_coordinator(&coordinator), m_task(std::forward<Callable>(task)), m_stopToken(std::move(stopToken)), m_admitTime(admitTime) {}
+
+			CoordinatedTask(CoordinatedTask&& other) noexcept(std::is_nothrow_move_constructible_v<Task>) :
+				m_coordinator(std::exchange(other.m_coordinator, nullptr)), m_task(std::move(other.m_task)),
+				m_stopToken(std::move(other.m_stopToken)), m_admitTime(other.m_admitTime) {}
+
+			CoordinatedTask(const CoordinatedTask&) = delete;
+			CoordinatedTask& operator=(const CoordinatedTask&) = delete;
+			CoordinatedTask& operator=(CoordinatedTask&&) = delete;
+
+			~CoordinatedTask() {
+				if (m_coordinator) m_coordinator->release(Outcome::Cancelled);
+			}
+
+			void operator()(size_t threadIndex) {
+				TaskCoordinator* coordinator = std::exchange(m_coordinator, nullptr);
+				if (m_stopToken.stop_requested()) {
+					coordinator->release(Outcome::Cancelled);
+					return;
+				}
+
+				coordinator->recordQueueTime(timestamp() - m_admitTime);
+				try {
+					if constexpr (std::is_invocable_v<Task&, std::stop_token>) m_task(m_stopToken);
+					else if constexpr (std::is_invocable_v<Task&, size_t>) m_task(threadIndex);
+					else m_task();
+				} catch (...) {
+					coordinator->release(Outcome::Failed);
+					throw;
+				}
+				coordinator->release(Outcome::Completed);
+			}
+		};
+
+		struct WakeWaiters {
+			TaskCoordinator* coordinator;
+
+			void operator()() const noexcept {
+				std::lock_guard<std::mutex> lock(coordinator->m_waitMutex);
+				coordinator->m_slotReleased.notify_all();
+			}
+		};
+
+		MinimalThreadPool& m_threadPoolHandle;
+		std::atomic<size_t> m_maxPendingTasks;
+
+		alignas(64) std::atomic<size_t> m_pendingTasks = 0;
+		std::atomic<size_t> m_waiterCount = 0;
+		// Threads that may still touch the coordinator after their slot was released, waitIdle waits for them
+		std::atomic<size_t> m_releasingCount = 0;
+		std::mutex m_waitMutex;
+		std::condition_variable m_slotReleased;
+
+		alignas(64) std::atomic<uint64_t> m_admittedCount = 0;
+		std::atomic<uint64_t> m_rejectedCount = 0;
+		alignas(64) std::atomic<uint64_t> m_completedCount = 0;
+		std::atomic<uint64_t> m_failedCount = 0;
+		std::atomic<uint64_t> m_cancelledCount = 0;
+		std::atomic<uint64_t> m_totalQueueTime = 0;
+		std::atomic<uint64_t> m_maxQueueTime = 0;
+		std::atomic<int64_t> m_statisticsStart;
+
+		static inline int64_t timestamp() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		bool tryAcquire() {
+			size_t pending = m_pendingTasks.load(std::memory_order_relaxed);
+			while (pending < m_maxPendingTasks.load(std::memory_order_relaxed))
+				if (m_pendingTasks.compare_exchange_weak(pending, pending + 1, std::memory_order_acquire, std::memory_order_relaxed))
+					return true;
+			return false;
+		}
+
+		void release(Outcome outcome) {
+			switch (outcome) {
+			case Outcome::Completed: m_completedCount.fetch_add(1, std::memory_order_relaxed); break;
+			case Outcome::Failed: m_failedCount.fetch_add(1, std::memory_order_relaxed); break;
+			case Outcome::Cancelled: m_cancelledCount.fetch_add(1, std::memory_order_relaxed); break;
+			}
+			m_releasingCount.fetch_add(1, std::memory_order_relaxed);
+			m_pendingTasks.fetch_sub(1, std::memory_order_release);
+			notifyWaiters();
+			// Last access, the coordinator may be destroyed right after it
+			m_releasingCount.fetch_sub(1, std::memory_order_release);
+		}
+
+		// Pairs with the fence in addTask, either we see the waiter or it sees the released slot
+		void notifyWaiters() {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_waiterCount.load(std::memory_order_relaxed) == 0) return;
+			std::lock_guard<std::mutex> lock(m_waitMutex);
+			m_slotReleased.notify_all();
+		}
+
+		void recordQueueTime(int64_t queueTime) {
+			uint64_t time = static_cast<uint64_t>(std::max<int64_t>(queueTime, 0));
+			m_totalQueueTime.fetch_add(time, std::memory_order_relaxed);
+			uint64_t longest = m_maxQueueTime.load(std::memory_order_relaxed);
+			while (time > longest && !m_maxQueueTime.compare_exchange_weak(longest, time, std::memory_order_relaxed)) {}
+		}
+
+		// Requires a slot, gives it back if the push throws
+		template<typename Task>
+		void push(Task&& task, std::stop_token stopToken) {
+			// The wrapper may give the slot back while we still fix up the counters below
+			m_releasingCount.fetch_add(1, std::memory_order_relaxed);
+			bool wrapped = false;
+			try {
+				CoordinatedTask<std::decay_t<Task>> coordinated(*this, std::forward<Task>(task), std::move(stopToken), timestamp());
+				wrapped = true;
+				m_threadPoolHandle.postTask(std::move(coordinated));
+			} catch (...) {
+				// A constructed wrapper already gave the slot back as a cancellation when it was destroyed
+				if (wrapped) m_cancelledCount.fetch_sub(1, std::memory_order_relaxed);
+				else {
+					m_pendingTasks.fetch_sub(1, std::memory_order_release);
+					notifyWaiters();
+				}
+				m_releasingCount.fetch_sub(1, std::memory_order_release);
+				throw;
+			}
+			m_admittedCount.fetch_add(1, std::memory_order_relaxed);
+			m_releasingCount.fetch_sub(1, std::memory_order_release);
+		}
 
 	public:
-		TaskCoordinator(ThreadPoolType& threadPool, unsigned int maxPendingTasks) :
-			m_threadPoolHandle(threadPool), m_maxPendingTasks(maxPendingTasks), m_pendingTasks(0) {};
+		TaskCoordinator(MinimalThreadPool& threadPool, size_t maxPendingTasks) :
+			m_threadPoolHandle(threadPool), m_maxPendingTasks(maxPendingTasks), m_statisticsStart(timestamp()) {}
+
+		TaskCoordinator(const TaskCoordinator&) = delete;
+		TaskCoordinator& operator=(const TaskCoordinator&) = delete;
+
+		// Tasks refer back to the coordinator, so it waits for every admitted task to finish or be dropped
+		~TaskCoordinator() {
+			waitIdle();
+		}
+
+		// Queues task if fewer than maxPendingTasks are pending, never blocks
+		template<typename Task>
+		bool tryAddTask(Task&& task, std::stop_token stopToken = {}) {
+			if (!tryAcquire()) {
+				m_rejectedCount.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			push(std::forward<Task>(task), std::move(stopToken));
+			return true;
+		}
+
+		// Waits up to timeout for a slot. Gives up without counting a rejection once stopToken is triggered.
+		// On one of the pool's workers it runs queued tasks while waiting, so a full pool can not deadlock.
+		template<typename Task, typename Rep, typename Period>
+		bool addTask(Task&& task, std::chrono::duration<Rep, Period> timeout, std::stop_token stopToken = {}) {
+			if (!tryAcquire()) {
+				const auto deadline = std::chrono::steady_clock::now() + std::chrono::ceil<std::chrono::steady_clock::duration>(timeout);
+				const bool worker = m_threadPoolHandle.isWorkerThread();
+				bool admitted = false;
+
+				// Registered before taking the mutex, the callback takes it and runs right away if stop was already requested
+				std::stop_callback<WakeWaiters> wakeOnStop(stopToken, WakeWaiters{ this });
+				std::unique_lock<std::mutex> lock(m_waitMutex);
+				m_waiterCount.fetch_add(1, std::memory_order_relaxed);
+				while (!stopToken.stop_requested()) {
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if ((admitted = tryAcquire())) break;
+					if (std::chrono::steady_clock::now() >= deadline) break;
+					if (worker) {
+						lock.unlock();
+						bool ran = m_threadPoolHandle.tryRunPendingTask();
+						lock.lock();
+						if (ran) continue;
+						// Slots may also be freed by tasks that are not queued yet, check again shortly
+						m_slotReleased.wait_until(lock, std::min(deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(1)));
+					}
+					else m_slotReleased.wait_until(lock, deadline);
+				}
+				m_waiterCount.fetch_sub(1, std::memory_order_relaxed);
+				lock.unlock();
 
-		bool tryAddTask(std::function<void()> task)
-		{
-			if (m_pendingTasks >= m_maxPendingTasks)
-				return 0;
-			m_pendingTasks++;
-			m_threadPoolHandle.pushTask([this, f = std::move(task)] {
-				f();
-				m_pendingTasks--;
-				});
-			return 1;
+				if (!admitted) {
+					if (stopToken.stop_requested()) m_cancelledCount.fetch_add(1, std::memory_order_relaxed);
+					else m_rejectedCount.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+			}
+			push(std::forward<Task>(task), std::move(stopToken));
+			return true;
 		}
 
-		bool canAddTask()
-		{
-			if (m_pendingTasks >= m_maxPendingTasks)
-				return 0;
-			return 1;
+		inline bool canAddTask() const {
+			return m_pendingTasks.load(std::memory_order_relaxed) < m_maxPendingTasks.load(std::memory_order_relaxed);
 		}
 
-		inline ThreadPool& getPoolHandle() const {
+		// Tasks already admitted over a lowered limit still run
+		void setMaxPendingTasks(size_t maxPendingTasks) {
+			m_maxPendingTasks.store(maxPendingTasks, std::memory_order_relaxed);
+			notifyWaiters();
+		}
+
+		inline size_t getMaxPendingTasks() const {
+			return m_maxPendingTasks.load(std::memory_order_relaxed);
+		}
+
+		inline size_t getPendingTaskCount() const {
+			return m_pendingTasks.load(std::memory_order_relaxed);
+		}
+
+		// Waits until every admitted task finished or was dropped and no thread touches the coordinator
+		// on their behalf any more
+		void waitIdle() {
+			std::unique_lock<std::mutex> lock(m_waitMutex);
+			m_waiterCount.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			m_slotReleased.wait(lock, [this]() { return m_pendingTasks.load(std::memory_order_acquire) == 0; });
+			m_waiterCount.fetch_sub(1, std::memory_order_relaxed);
+			lock.unlock();
+			// Releasers are past their decrement and at most a notify away, which needs the mutex
+			while (m_releasingCount.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+		}
+
+		Statistics getStatistics() const {
+			Statistics statistics;
+			statistics.pendingCount = m_pendingTasks.load(std::memory_order_relaxed);
+			statistics.maxPendingTasks = m_maxPendingTasks.load(std::memory_order_relaxed);
+			statistics.admittedCount = m_admittedCount.load(std::memory_order_relaxed);
+			statistics.rejectedCount = m_rejectedCount.load(std::memory_order_relaxed);
+			statistics.completedCount = m_completedCount.load(std::memory_order_relaxed);
+			statistics.failedCount = m_failedCount.load(std::memory_order_relaxed);
+			statistics.cancelledCount = m_cancelledCount.load(std::memory_order_relaxed);
+			statistics.totalQueueTime = std::chrono::nanoseconds(m_totalQueueTime.load(std::memory_order_relaxed));
+			statistics.maxQueueTime = std::chrono::nanoseconds(m_maxQueueTime.load(std::memory_order_relaxed));
+			statistics.elapsed = std::chrono::nanoseconds(timestamp() - m_statisticsStart.load(std::memory_order_relaxed));
+			return statistics;
+		}
+
+		// Zeroes every counter, the pending count is left alone
+		void resetStatistics() {
+			m_admittedCount.store(0, std::memory_order_relaxed);
+			m_rejectedCount.store(0, std::memory_order_relaxed);
+			m_completedCount.store(0, std::memory_order_relaxed);
+			m_failedCount.store(0, std::memory_order_relaxed);
+			m_cancelledCount.store(0, std::memory_order_relaxed);
+			m_totalQueueTime.store(0, std::memory_order_relaxed);
+			m_maxQueueTime.store(0, std::memory_order_relaxed);
+			m_statisticsStart.store(timestamp(), std::memory_order_relaxed);
+		}
+
+		inline MinimalThreadPool& getPoolHandle() const {
 			return m_threadPoolHandle;
 		};
-
 	};
 }
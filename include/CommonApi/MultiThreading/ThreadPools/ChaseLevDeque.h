@@ -0,0 +1,127 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+namespace MultiThreading
+{
+	// Dynamic circular work-stealing deque (Chase & Lev, memory orders after Le et al. 2013).
+	// push/pop may only be called by the owning thread, steal may be called by any thread.
+	// Buffers replaced by growth are retired, not freed, until the deque is destroyed,
+	// so a concurrent thief never reads freed memory.
+	template<typename T>
+	class ChaseLevDeque
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "ChaseLevDeque elements must be trivially copyable");
+
+	private:
+		struct Buffer {
+			int64_t capacity;
+			int64_t mask;
+			std::unique_ptr<std::atomic<T>[]> slots;
+
+			explicit Buffer(int64_t capacity) :
+				capacity(capacity), mask(capacity - 1), slots(new std::atomic<T>[capacity]) {}
+
+			inline T get(int64_t index) const { return slots[index & mask].load(std::memory_order_relaxed); }
+			inline void put(int64_t index, T value) { slots[index & mask].store(value, std::memory_order_relaxed); }
+		};
+
+		static constexpr size_t s_cacheLine = 64;
+
+		alignas(s_cacheLine) std::atomic<int64_t> m_top = 0;
+		alignas(s_cacheLine) std::atomic<int64_t> m_bottom = 0;
+		std::atomic<Buffer*> m_buffer;
+		std::vector<std::unique_ptr<Buffer>> m_buffers; // owner only, last element is the live buffer
+
+	public:
+		explicit ChaseLevDeque(size_t initialCapacity = 256) {
+			int64_t capacity = 1;
+			while (capacity < static_cast<int64_t>(initialCapacity)) capacity <<= 1;
+			m_buffers.push_back(std::make_unique<Buffer>(capacity));
+			m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+		}
+
+		ChaseLevDeque(const ChaseLevDeque&) = delete;
+		ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+		ChaseLevDeque(ChaseLevDeque&&) = delete;
+		ChaseLevDeque& operator=(ChaseLevDeque&&) = delete;
+
+		// Owner only
+		void push(T value) {
+			int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+			int64_t top = m_top.load(std::memory_order_acquire);
+			Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+
+			if (bottom - top > buffer->capacity - 1) buffer = grow(buffer, top, bottom);
+
+			buffer->put(bottom, value);
+			std::atomic_thread_fence(std::memory_order_release);
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		// Owner only, takes the most recently pushed element
+		bool pop(T& result) {
+			int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+			Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+			m_bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t top = m_top.load(std::memory_order_relaxed);
+
+			if (top > bottom) {
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			result = buffer->get(bottom);
+			if (top == bottom) {
+				// Last element, race against thieves for it
+				bool won = m_top.compare_exchange_strong(top, top + 1,
+					std::memory_order_seq_cst, std::memory_order_relaxed);
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return won;
+			}
+			return true;
+		}
+
+		// Any thread, takes the oldest element. May fail spuriously when racing another thief.
+		bool steal(T& result) {
+			int64_t top = m_top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+			if (top >= bottom) return false;
+
+			Buffer* buffer = m_buffer.load(std::memory_order_acquire);
+			T value = buffer->get(top);
+			if (!m_top.compare_exchange_strong(top, top + 1,
+				std::memory_order_seq_cst, std::memory_order_relaxed))
+				return false;
+
+			result = value;
+			return true;
+		}
+
+		// Approximate when called concurrently
+		inline size_t size() const {
+			int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+			int64_t top = m_top.load(std::memory_order_relaxed);
+			return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+		}
+
+		inline bool empty() const { return size() == 0; }
+
+	private:
+		Buffer* grow(Buffer* old, int64_t top, int64_t bottom) {
+			auto buffer = std::make_unique<Buffer>(old->capacity * 2);
+			for (int64_t i = top; i < bottom; ++i) buffer->put(i, old->get(i));
+			m_buffers.push_back(std::move(buffer));
+			m_buffer.store(m_buffers.back().get(), std::memory_order_release);
+			return m_buffers.back().get();
+		}
+	};
+}
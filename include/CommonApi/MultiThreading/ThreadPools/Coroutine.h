@@ -0,0 +1,470 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+#include "CommonApi/MultiThreading/ThreadPools/MinimalThreadPool.h"
+#include "CommonApi/MultiThreading/ThreadPools/SlotPool.h"
+#include "CommonApi/MultiThreading/ThreadPools/TaskLatch.h"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace MultiThreading
+{
+	template<typename T = void>
+	class Task;
+
+	namespace detail
+	{
+		// Coroutine frames come from size classed SlotPools, so starting a coroutine does not hit the heap
+		// once the pools warmed up. Frames larger than the biggest class are allocated normally.
+		class CoroutineFrameAllocator
+		{
+		private:
+			template<size_t Size>
+			struct Block {
+				alignas(std::max_align_t) unsigned char bytes[Size];
+				Block() {}		// leaves the bytes uninitialized
+			};
+
+			template<size_t Size>
+			static SlotPool<Block<Size>>& slots() {
+				static SlotPool<Block<Size>> s_slots;
+				return s_slots;
+			}
+
+			template<size_t Size, size_t... Sizes>
+			static void* allocateFrom(size_t size) {
+				if (size <= Size) return slots<Size>().create();
+				if constexpr (sizeof...(Sizes) > 0) return allocateFrom<Sizes...>(size);
+				else return ::operator new(size);
+			}
+
+			template<size_t Size, size_t... Sizes>
+			static void deallocateFrom(void* frame, size_t size) noexcept {
+				if (size <= Size) slots<Size>().destroy(static_cast<Block<Size>*>(frame));
+				else if constexpr (sizeof...(Sizes) > 0) deallocateFrom<Sizes...>(frame, size);
+				else ::operator delete(frame);
+			}
+
+		public:
+			static inline void* allocate(size_t size) {
+				return allocateFrom<128, 256, 512, 1024, 2048>(size);
+			}
+
+			static inline void deallocate(void* frame, size_t size) noexcept {
+				deallocateFrom<128, 256, 512, 1024, 2048>(frame, size);
+			}
+		};
+
+		// Promise types derive from this to get their frames from CoroutineFrameAllocator
+		struct PooledFrame {
+			static void* operator new(size_t size) { return CoroutineFrameAllocator::allocate(size); }
+			static void operator delete(void* frame, size_t size) noexcept { CoroutineFrameAllocator::deallocate(frame, size); }
+		};
+
+		class TaskPromiseBase : public PooledFrame
+		{
+		private:
+			std::coroutine_handle<> m_continuation;
+
+			// Continues the awaiting coroutine on this thread without growing the stack
+			struct FinalAwaiter {
+				inline bool await_ready() const noexcept { return false; }
+
+				template<typename Promise>
+				inline std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+					std::coroutine_handle<> continuation = handle.promise().m_continuation;
+					return continuation ? continuation : std::noop_coroutine();
+				}
+
+				inline void await_resume() const noexcept {}
+			};
+
+		protected:
+			std::exception_ptr m_exception;
+
+			inline void rethrowIfFailed() const {
+				if (m_exception) std::rethrow_exception(m_exception);
+			}
+
+		public:
+			inline std::suspend_always initial_suspend() const noexcept { return {}; }
+			inline FinalAwaiter final_suspend() const noexcept { return {}; }
+			inline void unhandled_exception() noexcept { m_exception = std::current_exception(); }
+
+			inline void setContinuation(std::coroutine_handle<> continuation) noexcept { m_continuation = continuation; }
+		};
+
+		template<typename T>
+		class TaskPromise : public TaskPromiseBase
+		{
+		private:
+			std::optional<T> m_value;
+
+		public:
+			Task<T> get_return_object() noexcept;
+
+			template<typename Value>
+				requires std::is_convertible_v<Value&&, T>
+			inline void return_value(Value&& value) {
+				m_value.emplace(std::forward<Value>(value));
+			}
+
+			inline T takeResult() {
+				rethrowIfFailed();
+				return std::move(*m_value);
+			}
+		};
+
+		template<>
+		class TaskPromise<void> : public TaskPromiseBase
+		{
+		public:
+			Task<void> get_return_object() noexcept;
+
+			inline void return_void() const noexcept {}
+
+			inline void takeResult() const {
+				rethrowIfFailed();
+			}
+		};
+
+		struct TaskAccess;
+	}
+
+	// Lazily started coroutine producing a T. Nothing runs until the task is awaited, the awaiting
+	// coroutine then continues on whichever thread the task finishes on. A task moves onto a pool
+	// with co_await pool.schedule(), plain code runs one with syncWait or spawn.
+	template<typename T>
+	class Task
+	{
+		friend struct detail::TaskAccess;
+		static_assert(!std::is_reference_v<T>, "Task can not produce a reference");
+
+	public:
+		using promise_type = detail::TaskPromise<T>;
+
+	private:
+		std::coroutine_handle<promise_type> m_handle;
+
+		struct Awaiter {
+			std::coroutine_handle<promise_type> handle;
+
+			inline bool await_ready() const noexcept { return !handle || handle.done(); }
+
+			inline std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+				handle.promise().setContinuation(awaiting);
+				return handle;
+			}
+
+			inline T await_resume() {
+				if (!handle) throw std::logic_error("Awaiting an empty Task");
+				return handle.promise().takeResult();
+			}
+		};
+
+		// Like Awaiter but leaves the result and any exception in the task
+		struct ReadyAwaiter : Awaiter {
+			inline void await_resume() const noexcept {}
+		};
+
+	public:
+		Task() noexcept = default;
+		explicit Task(std::coroutine_handle<promise_type> handle) noexcept : m_handle(handle) {}
+
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+		Task& operator=(Task&& other) noexcept {
+			if (this != &other) {
+				if (m_handle) m_handle.destroy();
+				m_handle = std::exchange(other.m_handle, nullptr);
+			}
+			return *this;
+		}
+
+		// Destroying a task that was started but has not finished is undefined
+		~Task() {
+			if (m_handle) m_handle.destroy();
+		}
+
+		inline bool valid() const noexcept { return static_cast<bool>(m_handle); }
+		inline bool isReady() const noexcept { return m_handle && m_handle.done(); }
+
+		// Starts the task, the awaiting coroutine gets its result or its exception. Can only be awaited once.
+		inline Awaiter operator co_await() noexcept { return Awaiter{ m_handle }; }
+	};
+
+	namespace detail
+	{
+		template<typename T>
+		inline Task<T> TaskPromise<T>::get_return_object() noexcept {
+			return Task<T>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+		}
+
+		inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+			return Task<void>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+		}
+
+		template<typename T>
+		using TaskValue = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+		struct TaskAccess {
+			template<typename T>
+			static inline typename Task<T>::ReadyAwaiter whenReady(Task<T>& task) noexcept {
+				return typename Task<T>::ReadyAwaiter{ { task.m_handle } };
+			}
+
+			// The task must have finished
+			template<typename T>
+			static inline TaskValue<T> takeValue(Task<T>& task) {
+				if constexpr (std::is_void_v<T>) {
+					task.m_handle.promise().takeResult();
+					return std::monostate{};
+				}
+				else return task.m_handle.promise().takeResult();
+			}
+		};
+
+		// Eagerly started coroutine that destroys itself when done, its body must not throw
+		struct DetachedCoroutine {
+			struct promise_type : PooledFrame {
+				inline DetachedCoroutine get_return_object() const noexcept { return {}; }
+				inline std::suspend_never initial_suspend() const noexcept { return {}; }
+				inline std::suspend_never final_suspend() const noexcept { return {}; }
+				inline void return_void() const noexcept {}
+				inline void unhandled_exception() const noexcept { std::terminate(); }
+			};
+		};
+
+		// Resumes the awaiting coroutine once the expected tasks arrived. The awaiting coroutine holds
+		// one extra count while it starts the tasks, so tasks finishing right away do not resume it early.
+		class ReadyCounter
+		{
+		private:
+			std::atomic<size_t> m_pending;
+			std::coroutine_handle<> m_awaiting;
+
+		public:
+			explicit ReadyCounter(size_t expected) noexcept : m_pending(expected + 1) {}
+
+			inline void setAwaiting(std::coroutine_handle<> awaiting) noexcept { m_awaiting = awaiting; }
+
+			// True for the last arrival
+			inline bool release() noexcept {
+				return m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1;
+			}
+
+			inline void arrive() {
+				if (release()) m_awaiting.resume();
+			}
+		};
+
+		// Starts tasks through start(counter) and suspends until the counter released the awaiting coroutine
+		template<typename Start>
+		class StartAndWait
+		{
+		private:
+			ReadyCounter m_counter;
+			Start m_start;
+
+		public:
+			StartAndWait(size_t expected, Start start) : m_counter(expected), m_start(std::move(start)) {}
+
+			inline bool await_ready() const noexcept { return false; }
+
+			inline bool await_suspend(std::coroutine_handle<> awaiting) {
+				m_counter.setAwaiting(awaiting);
+				m_start(m_counter);
+				return !m_counter.release();
+			}
+
+			inline void await_resume() const noexcept {}
+		};
+
+		template<typename T>
+		DetachedCoroutine arriveWhenReady(Task<T>& task, ReadyCounter& counter) {
+			co_await TaskAccess::whenReady(task);
+			counter.arrive();
+		}
+
+		// Shared by whenAny and its tasks, the tasks that lose keep it alive until they finished
+		template<typename T>
+		struct WhenAnyState {
+			std::vector<Task<T>> tasks;
+			std::atomic<bool> decided = false;
+			size_t winner = 0;
+			ReadyCounter* counter = nullptr;
+
+			explicit WhenAnyState(std::vector<Task<T>>&& tasks) : tasks(std::move(tasks)) {}
+		};
+
+		template<typename T>
+		DetachedCoroutine arriveFirst(std::shared_ptr<WhenAnyState<T>> state, size_t index) {
+			co_await TaskAccess::whenReady(state->tasks[index]);
+			if (state->decided.exchange(true, std::memory_order_acq_rel)) co_return;
+			state->winner = index;
+			state->counter->arrive();
+		}
+
+		// Started by a task of the pool, so nothing in here can throw to the caller of spawn
+		inline DetachedCoroutine runDetached(MinimalThreadPool& pool, Task<void> task) {
+			co_await TaskAccess::whenReady(task);
+			try {
+				TaskAccess::takeValue(task);
+			}
+			catch (...) {
+				// The error is lost if it can not be queued
+				try {
+					pool.postTask([error = std::current_exception()]() { std::rethrow_exception(error); });
+				}
+				catch (...) {}
+			}
+		}
+
+		template<typename T>
+		DetachedCoroutine countDownWhenReady(Task<T>& task, TaskLatch& latch) {
+			co_await TaskAccess::whenReady(task);
+			latch.countDown();
+		}
+	}
+
+	// Runs the task to completion on the calling thread, until it first suspends, and returns its
+	// result or rethrows its exception. Called from a pool's worker it runs that pool's queued
+	// tasks while waiting instead of blocking.
+	template<typename T>
+	T syncWait(Task<T> task) {
+		TaskLatch latch(1);
+		detail::countDownWhenReady(task, latch);
+		if (MinimalThreadPool* pool = MinimalThreadPool::getCurrentPool()) latch.wait(*pool);
+		else latch.wait();
+		if constexpr (std::is_void_v<T>) detail::TaskAccess::takeValue(task);
+		else return detail::TaskAccess::takeValue(task);
+	}
+
+	// Starts the task on one of the pool's workers and lets it run on its own. An exception escaping the
+	// task is rethrown by a task of the pool, so it reaches the pool's error stream like any other.
+	// Throws like postTask if the task can not be queued, a queued task that is flushed never starts.
+	inline void spawn(MinimalThreadPool& pool, Task<void> task) {
+		pool.postTask([&pool, task = std::move(task)]() mutable { detail::runDetached(pool, std::move(task)); });
+	}
+
+	// Finishes once every task did, with their results in order, void results become std::monostate.
+	// Tasks are started one after another on the awaiting thread and only run concurrently from their
+	// first suspension on, typically a co_await pool.schedule() at their top. The first exception in
+	// argument order is rethrown once all tasks finished.
+	template<typename... Ts>
+	Task<std::tuple<detail::TaskValue<Ts>...>> whenAll(Task<Ts>... tasks) {
+		co_await detail::StartAndWait(sizeof...(Ts), [&](detail::ReadyCounter& counter) {
+			(detail::arriveWhenReady(tasks, counter), ...);
+			});
+		// Braces evaluate the results left to right, so the first exception in argument order wins
+		co_return std::tuple<detail::TaskValue<Ts>...>{ detail::TaskAccess::takeValue(tasks)... };
+	}
+
+	template<typename T>
+		requires (!std::is_void_v<T>)
+	Task<std::vector<T>> whenAll(std::vector<Task<T>> tasks) {
+		co_await detail::StartAndWait(tasks.size(), [&](detail::ReadyCounter& counter) {
+			for (Task<T>& task : tasks) detail::arriveWhenReady(task, counter);
+			});
+		std::vector<T> results;
+		results.reserve(tasks.size());
+		for (Task<T>& task : tasks) results.push_back(detail::TaskAccess::takeValue(task));
+		co_return results;
+	}
+
+	inline Task<void> whenAll(std::vector<Task<void>> tasks) {
+		co_await detail::StartAndWait(tasks.size(), [&](detail::ReadyCounter& counter) {
+			for (Task<void>& task : tasks) detail::arriveWhenReady(task, counter);
+			});
+		for (Task<void>& task : tasks) detail::TaskAccess::takeValue(task);
+	}
+
+	template<typename T>
+	struct WhenAnyResult {
+		size_t index;
+		detail::TaskValue<T> value;
+	};
+
+	// Finishes with the index and result of the first task to finish, or rethrows its exception.
+	// Tasks are started like whenAll does and can not be cancelled, the others keep running and
+	// their results are dropped.
+	template<typename T>
+	Task<WhenAnyResult<T>> whenAny(std::vector<Task<T>> tasks) {
+		if (tasks.empty()) throw std::invalid_argument("whenAny needs at least one task");
+		auto state = std::make_shared<detail::WhenAnyState<T>>(std::move(tasks));
+		co_await detail::StartAndWait(1, [&](detail::ReadyCounter& counter) {
+			state->counter = &counter;
+			for (size_t i = 0; i < state->tasks.size(); ++i) detail::arriveFirst(state, i);
+			});
+		co_return WhenAnyResult<T>{ state->winner, detail::TaskAccess::takeValue(state->tasks[state->winner]) };
+	}
+
+	// Runs callable as a task of pool, typically a pool set aside for blocking calls, and continues the
+	// awaiting coroutine with its result. A coroutine awaiting from a worker of another pool continues on
+	// that pool, otherwise, or when that pool can not take it, it continues on the worker that ran callable.
+	template<typename Callable>
+	class OffloadAwaitable
+	{
+	private:
+		using Result = std::invoke_result_t<Callable&>;
+
+		MinimalThreadPool& m_pool;
+		Callable m_callable;
+		std::optional<detail::TaskValue<Result>> m_value;
+		std::exception_ptr m_exception;
+
+	public:
+		OffloadAwaitable(MinimalThreadPool& pool, Callable callable) : m_pool(pool), m_callable(std::move(callable)) {}
+
+		inline bool await_ready() const noexcept { return false; }
+
+		void await_suspend(std::coroutine_handle<> awaiting) {
+			MinimalThreadPool* home = MinimalThreadPool::getCurrentPool();
+			m_pool.postTask([this, awaiting, home]() {
+				try {
+					if constexpr (std::is_void_v<Result>) {
+						m_callable();
+						m_value.emplace();
+					}
+					else m_value.emplace(m_callable());
+				}
+				catch (...) {
+					m_exception = std::current_exception();
+				}
+				bool resumeHere = !home || home == &m_pool;
+				if (!resumeHere) {
+					try {
+						home->postTask([awaiting]() { awaiting.resume(); });
+					}
+					catch (...) {
+						resumeHere = true;	// rather the wrong pool than a coroutine that never finishes
+					}
+				}
+				if (resumeHere) awaiting.resume();
+				});
+		}
+
+		Result await_resume() {
+			if (m_exception) std::rethrow_exception(m_exception);
+			if constexpr (!std::is_void_v<Result>) return std::move(*m_value);
+		}
+	};
+
+	template<typename Callable>
+	inline OffloadAwaitable<std::decay_t<Callable>> offload(MinimalThreadPool& pool, Callable&& callable) {
+		return OffloadAwaitable<std::decay_t<Callable>>(pool, std::forward<Callable>(callable));
+	}
+}
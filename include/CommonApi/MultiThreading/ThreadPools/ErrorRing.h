@@ -0,0 +1,102 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace MultiThreading
+{
+	// Fixed size, lock-free record of the most recent errors. Writers never block or allocate,
+	// older records are overwritten once Capacity newer ones arrived. Every entry is guarded by
+	// its own sequence number the way a seqlock is, so readers skip entries being rewritten.
+	// Messages are truncated to s_messageCapacity bytes.
+	template<size_t Capacity>
+	class ErrorRing
+	{
+	public:
+		static constexpr size_t s_messageCapacity = 120;
+
+		struct Record {
+			size_t threadIndex;
+			std::chrono::steady_clock::time_point timestamp;
+			std::string what;
+		};
+
+	private:
+		static constexpr size_t s_wordCount = s_messageCapacity / sizeof(uint64_t);
+
+		// Every field is atomic so that a reader racing a writer is not a data race, only a retry
+		struct Entry {
+			std::atomic<uint64_t> sequence = 0;		// 2 * ticket + 1 while written, 2 * ticket + 2 once complete
+			std::atomic<uint64_t> threadIndex = 0;
+			std::atomic<int64_t> timestamp = 0;
+			std::atomic<uint32_t> length = 0;
+			std::array<std::atomic<uint64_t>, s_wordCount> words{};
+		};
+
+		std::array<Entry, Capacity> m_entries;
+		std::atomic<uint64_t> m_nextTicket = 0;
+
+	public:
+		ErrorRing() = default;
+		ErrorRing(const ErrorRing&) = delete;
+		ErrorRing& operator=(const ErrorRing&) = delete;
+
+		void record(size_t threadIndex, std::string_view what) {
+			uint64_t ticket = m_nextTicket.fetch_add(1, std::memory_order_relaxed);
+			Entry& entry = m_entries[ticket % Capacity];
+
+			entry.sequence.store(2 * ticket + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			std::array<uint64_t, s_wordCount> words{};
+			size_t length = std::min(what.size(), s_messageCapacity);
+			std::memcpy(words.data(), what.data(), length);
+
+			entry.threadIndex.store(threadIndex, std::memory_order_relaxed);
+			entry.timestamp.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+			entry.length.store(static_cast<uint32_t>(length), std::memory_order_relaxed);
+			for (size_t i = 0; i < s_wordCount; ++i) entry.words[i].store(words[i], std::memory_order_relaxed);
+
+			entry.sequence.store(2 * ticket + 2, std::memory_order_release);
+		}
+
+		// Errors recorded so far, including the ones already overwritten
+		inline uint64_t recordedCount() const {
+			return m_nextTicket.load(std::memory_order_relaxed);
+		}
+
+		// Appends the records still held, oldest first
+		void snapshot(std::vector<Record>& records) const {
+			uint64_t end = m_nextTicket.load(std::memory_order_acquire);
+			uint64_t begin = end > Capacity ? end - Capacity : 0;
+
+			for (uint64_t ticket = begin; ticket < end; ++ticket) {
+				const Entry& entry = m_entries[ticket % Capacity];
+				if (entry.sequence.load(std::memory_order_acquire) != 2 * ticket + 2) continue;
+
+				std::array<uint64_t, s_wordCount> words;
+				size_t threadIndex = static_cast<size_t>(entry.threadIndex.load(std::memory_order_relaxed));
+				int64_t timestamp = entry.timestamp.load(std::memory_order_relaxed);
+				size_t length = std::min<size_t>(entry.length.load(std::memory_order_relaxed), s_messageCapacity);
+				for (size_t i = 0; i < s_wordCount; ++i) words[i] = entry.words[i].load(std::memory_order_relaxed);
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (entry.sequence.load(std::memory_order_relaxed) != 2 * ticket + 2) continue;
+
+				records.push_back(Record{
+					threadIndex,
+					std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(timestamp)),
+					std::string(reinterpret_cast<const char*>(words.data()), length)
+					});
+			}
+		}
+	};
+}
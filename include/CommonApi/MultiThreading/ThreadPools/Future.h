@@ -0,0 +1,219 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+
+#ifndef MINIMAL_THREAD_POOL_H
+#error "Do not include this file directly, use MinimalThreadPool.h instead"
+#endif
+
+#include <atomic>
+#include <exception>
+#include <future>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+//Future
+namespace MultiThreading
+{
+	// Shared state between a Future and the task fulfilling it. States come from a
+	// per result type SlotPool and are returned to it when both sides let go.
+	// A reference result is kept as a pointer, the referenced object must outlive the Future.
+	template<typename R>
+	class MinimalThreadPool::FutureState
+	{
+	private:
+		using Value = std::conditional_t<std::is_void_v<R>, std::monostate,
+			std::conditional_t<std::is_reference_v<R>, std::remove_reference_t<R>*, R>>;
+
+		enum Status : uint32_t {
+			Pending,
+			Ready,
+		};
+
+		std::atomic<uint32_t> m_status = Pending;
+		std::atomic<uint32_t> m_references = 2;		// the future and the task
+		std::optional<Value> m_value;
+		std::exception_ptr m_exception;
+
+		static SlotPool<FutureState>& slots() {
+			static SlotPool<FutureState> s_slots(64);
+			return s_slots;
+		}
+
+		inline void publish() {
+			m_status.store(Ready, std::memory_order_release);
+			m_status.notify_all();
+		}
+
+	public:
+		static FutureState* create() {
+			return slots().create();
+		}
+
+		void release() {
+			if (m_references.fetch_sub(1, std::memory_order_acq_rel) == 1) slots().destroy(this);
+		}
+
+		template<typename Callable>
+		void run(Callable& callable, size_t threadIndex) {
+			try {
+				if constexpr (std::is_void_v<R>) {
+					callInvoke(callable, threadIndex);
+					m_value.emplace();
+				}
+				else if constexpr (std::is_reference_v<R>) {
+					auto&& result = callInvoke(callable, threadIndex);
+					m_value.emplace(std::addressof(result));
+				}
+				else m_value.emplace(callInvoke(callable, threadIndex));
+			}
+			catch (...) {
+				m_exception = std::current_exception();
+			}
+			publish();
+		}
+
+		void breakPromise() {
+			m_exception = std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
+			publish();
+		}
+
+		inline bool isReady() const {
+			return m_status.load(std::memory_order_acquire) == Ready;
+		}
+
+		inline void waitReady() const {
+			while (!isReady()) m_status.wait(Pending, std::memory_order_acquire);
+		}
+
+		R take() {
+			if (m_exception) std::rethrow_exception(m_exception);
+			if constexpr (std::is_reference_v<R>) return static_cast<R>(**m_value);
+			else if constexpr (!std::is_void_v<R>) return std::move(*m_value);
+		}
+
+	private:
+		template<typename Callable>
+		static inline decltype(auto) callInvoke(Callable& callable, size_t threadIndex) {
+			if constexpr (std::is_invocable_v<Callable&, size_t>) return callable(threadIndex);
+			else return callable();
+		}
+	};
+
+	// Task side of a FutureState. Dropping a promise that never ran, for example
+	// because its task was flushed, breaks it so the waiting caller does not hang.
+	template<typename R>
+	class MinimalThreadPool::Promise
+	{
+	private:
+		FutureState<R>* m_state;
+
+	public:
+		explicit Promise(FutureState<R>* state) noexcept : m_state(state) {}
+
+		Promise(const Promise&) = delete;
+		Promise& operator=(const Promise&) = delete;
+
+		Promise(Promise&& other) noexcept : m_state(std::exchange(other.m_state, nullptr)) {}
+		Promise& operator=(Promise&& other) noexcept {
+			if (this != &other) {
+				reset();
+				m_state = std::exchange(other.m_state, nullptr);
+			}
+			return *this;
+		}
+
+		~Promise() { reset(); }
+
+		template<typename Callable>
+		void run(Callable& callable, size_t threadIndex) {
+			FutureState<R>* state = std::exchange(m_state, nullptr);
+			state->run(callable, threadIndex);
+			state->release();
+		}
+
+	private:
+		void reset() noexcept {
+			if (!m_state) return;
+			m_state->breakPromise();
+			std::exchange(m_state, nullptr)->release();
+		}
+	};
+
+	// Result of MinimalThreadPool::submit. Waiting from one of the pool's own workers
+	// runs other queued tasks in the meantime instead of tying the worker up, a worker
+	// only blocks once nothing is left to help with, which means the awaited task is running.
+	template<typename R>
+	class MinimalThreadPool::Future
+	{
+		friend class MinimalThreadPool;
+	private:
+		// Failed help attempts a worker makes before it blocks, steals may fail spuriously under contention
+		static constexpr size_t s_helpAttempts = 64;
+
+		FutureState<R>* m_state = nullptr;
+		MinimalThreadPool* m_pool = nullptr;
+
+		Future(FutureState<R>* state, MinimalThreadPool* pool) noexcept : m_state(state), m_pool(pool) {}
+
+	public:
+		Future() noexcept = default;
+
+		Future(const Future&) = delete;
+		Future& operator=(const Future&) = delete;
+
+		Future(Future&& other) noexcept :
+			m_state(std::exchange(other.m_state, nullptr)), m_pool(other.m_pool) {}
+
+		Future& operator=(Future&& other) noexcept {
+			if (this != &other) {
+				reset();
+				m_state = std::exchange(other.m_state, nullptr);
+				m_pool = other.m_pool;
+			}
+			return *this;
+		}
+
+		~Future() { reset(); }
+
+		inline bool valid() const noexcept { return m_state != nullptr; }
+
+		inline bool isReady() const {
+			if (!m_state) throw std::future_error(std::future_errc::no_state);
+			return m_state->isReady();
+		}
+
+		void wait() const {
+			if (!m_state) throw std::future_error(std::future_errc::no_state);
+			if (m_pool->isWorkerThread()) {
+				size_t failedAttempts = 0;
+				while (!m_state->isReady() && failedAttempts < s_helpAttempts) {
+					if (m_pool->tryRunPendingTask()) failedAttempts = 0;
+					else {
+						++failedAttempts;
+						std::this_thread::yield();
+					}
+				}
+			}
+			m_state->waitReady();
+		}
+
+		// Waits for the result and rethrows the task's exception, if any. Can only be called once.
+		R get() {
+			wait();
+			FutureState<R>* state = std::exchange(m_state, nullptr);
+			struct Release {
+				FutureState<R>* state;
+				~Release() { state->release(); }
+			} release{ state };
+			return state->take();
+		}
+
+		void reset() noexcept {
+			if (m_state) std::exchange(m_state, nullptr)->release();
+		}
+	};
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Inline storage reserved for a pool task's callable, callables that do not fit fall back to the heap
+#ifndef COMMON_API_TASK_INLINE_CAPACITY
+#define COMMON_API_TASK_INLINE_CAPACITY 64
+#endif
+
+namespace MultiThreading
+{
+	// Move-only type erased void(size_t threadIndex) callable with small buffer optimization.
+	// void() callables are accepted as well and simply ignore the thread index.
+	template<size_t InlineCapacity = COMMON_API_TASK_INLINE_CAPACITY>
+	class InplaceTask
+	{
+	private:
+		struct Operations {
+			void (*invoke)(void* storage, size_t threadIndex);
+			void (*move)(void* destination, void* source) noexcept;
+			void (*destroy)(void* storage) noexcept;
+		};
+
+		template<typename Callable>
+		static constexpr bool s_storedInline =
+			sizeof(Callable) <= InlineCapacity &&
+			alignof(Callable) <= alignof(std::max_align_t) &&
+			std::is_nothrow_move_constructible_v<Callable>;
+
+		template<typename Callable>
+		static inline void call(Callable& callable, size_t threadIndex) {
+			if constexpr (std::is_invocable_v<Callable&, size_t>) callable(threadIndex);
+			else callable();
+		}
+
+		template<typename Callable>
+		struct InlineOperations {
+			static void invoke(void* storage, size_t threadIndex) {
+				call(*std::launder(reinterpret_cast<Callable*>(storage)), threadIndex);
+			}
+			static void move(void* destination, void* source) noexcept {
+				Callable* callable = std::launder(reinterpret_cast<Callable*>(source));
+				new (destination) Callable(std::move(*callable));
+				callable->~Callable();
+			}
+			static void destroy(void* storage) noexcept {
+				std::launder(reinterpret_cast<Callable*>(storage))->~Callable();
+			}
+			static constexpr Operations s_operations{ &invoke, &move, &destroy };
+		};
+
+		template<typename Callable>
+		struct HeapOperations {
+			static Callable*& pointer(void* storage) { return *std::launder(reinterpret_cast<Callable**>(storage)); }
+
+			static void invoke(void* storage, size_t threadIndex) {
+				call(*pointer(storage), threadIndex);
+			}
+			static void move(void* destination, void* source) noexcept {
+				new (destination) Callable*(pointer(source));
+			}
+			static void destroy(void* storage) noexcept {
+				delete pointer(storage);
+			}
+			static constexpr Operations s_operations{ &invoke, &move, &destroy };
+		};
+
+		alignas(std::max_align_t) unsigned char m_storage[InlineCapacity < sizeof(void*) ? sizeof(void*) : InlineCapacity];
+		const Operations* m_operations = nullptr;
+
+	public:
+		static constexpr size_t s_inlineCapacity = InlineCapacity;
+
+		// True when Callable is stored without a heap allocation
+		template<typename Callable>
+		static constexpr bool fitsInline() { return s_storedInline<std::decay_t<Callable>>; }
+
+		InplaceTask() noexcept = default;
+
+		template<typename Callable, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Callable>, InplaceTask>>>
+		InplaceTask(Callable&& callable) {
+			using Stored = std::decay_t<Callable>;
+			static_assert(
+				std::is_invocable_v<Stored&> || std::is_invocable_v<Stored&, size_t>,
+				"Task must be callable as either void() or void(size_t)"
+				);
+
+			if constexpr (s_storedInline<Stored>) {
+				new (m_storage) Stored(std::forward<Callable>(callable));
+				m_operations = &InlineOperations<Stored>::s_operations;
+			}
+			else {
+				new (m_storage) Stored*(new Stored(std::forward<Callable>(callable)));
+				m_operations = &HeapOperations<Stored>::s_operations;
+			}
+		}
+
+		InplaceTask(const InplaceTask&) = delete;
+		InplaceTask& operator=(const InplaceTask&) = delete;
+
+		InplaceTask(InplaceTask&& other) noexcept : m_operations(other.m_operations) {
+			if (m_operations) {
+				m_operations->move(m_storage, other.m_storage);
+				other.m_operations = nullptr;
+			}
+		}
+
+		InplaceTask& operator=(InplaceTask&& other) noexcept {
+			if (this == &other) return *this;
+			reset();
+			if (other.m_operations) {
+				other.m_operations->move(m_storage, other.m_storage);
+				m_operations = other.m_operations;
+				other.m_operations = nullptr;
+			}
+			return *this;
+		}
+
+		~InplaceTask() { reset(); }
+
+		void reset() noexcept {
+			if (m_operations) {
+				m_operations->destroy(m_storage);
+				m_operations = nullptr;
+			}
+		}
+
+		inline void operator()(size_t threadIndex) {
+			m_operations->invoke(m_storage, threadIndex);
+		}
+
+		explicit operator bool() const noexcept { return m_operations != nullptr; }
+	};
+}
@@ -1,27 +1,119 @@
 ﻿#pragma once
+#ifndef MINIMAL_THREAD_POOL_H
+#define MINIMAL_THREAD_POOL_H
+
 #include "CommonApi/Namespaces.h"
+#include "CommonApi/MultiThreading/BoundedQueue.h"
+#include "CommonApi/MultiThreading/ThreadPools/ChaseLevDeque.h"
+#include "CommonApi/MultiThreading/ThreadPools/ErrorRing.h"
+#include "CommonApi/MultiThreading/ThreadPools/InplaceTask.h"
+#include "CommonApi/MultiThreading/ThreadPools/SlotPool.h"
+#include "CommonApi/MultiThreading/ThreadPools/TimerWheel.h"
+#include "CommonApi/Utilities/RingBuffer.h"
+#include "CommonApi/PlatformAbstractions/CpuTopology.h"
+#include "CommonApi/PlatformAbstractions/Thread.h"
 
 #include <thread>
 #include <string>
 #include <chrono>
 #include <mutex>
-#include <map>
 #include <atomic>
-#include <functional>
 #include <iostream>
 #include <utility>
 #include <type_traits>
 #include <cstdint>
-#include <deque>
 #include <condition_variable>
+#include <coroutine>
 #include <shared_mutex>
 #include <memory>
+#include <vector>
+#include <array>
+#include <exception>
+#include <algorithm>
+#include <stdexcept>
+#include <span>
+#include <ranges>
+#include <optional>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
 
 namespace MultiThreading
 {
 	class MinimalThreadPool
 	{
 	public:
+		enum class SchedulerMode {
+			GlobalQueue,	// every worker pops from one queue guarded by the submission mutex
+			WorkStealing,	// every worker owns a Chase-Lev deque and steals from random victims when it runs dry
+		};
+
+		// Which processors workers are pinned to, processors come from Platform::CpuTopology
+		enum class AffinityPolicy {
+			None,		// the OS moves workers freely
+			Compact,	// fill the hyperthreads and cores of one package before using the next
+			Scatter,	// spread workers over packages and physical cores first
+			Explicit,	// worker i runs on Options::affinityCpus[i % affinityCpus.size()]
+		};
+
+		// What a worker does once it finds no task
+		enum class WakeupPolicy {
+			Park,			// block on the condition variable right away, every push that finds a parked worker notifies it
+			SpinThenPark,	// poll for spinCount pauses and yieldCount yields first, pushes skip the notify while a worker polls
+		};
+
+		static constexpr size_t s_maxPriorityLevels = 8;
+
+		// How workers pick the priority level their next task comes from
+		enum class DispatchPolicy {
+			Weighted,	// each round a worker takes up to levelWeights[i] tasks from level i, most urgent level first
+			Aging,		// most urgent level first, unless a less urgent one has not been served for agingThreshold
+		};
+
+		struct Options {
+			SchedulerMode schedulerMode = SchedulerMode::GlobalQueue;
+			size_t taskSlotCapacity = 1024;		// task slots preallocated by init, the pool grows past it on demand
+
+			// Spinning trades idle CPU time for wake-up latency, it only pays off with spare cores
+			WakeupPolicy wakeupPolicy = WakeupPolicy::Park;
+			uint32_t spinCount = 2048;
+			uint32_t yieldCount = 64;
+
+			size_t priorityLevelCount = 3;		// level 0 is the most urgent, pushPriorityTask uses it
+			size_t defaultPriority = 1;			// level used by pushTask and postTask when no priority is given
+			DispatchPolicy dispatchPolicy = DispatchPolicy::Weighted;
+			std::array<uint32_t, s_maxPriorityLevels> levelWeights = { 16, 4, 1, 1, 1, 1, 1, 1 };
+			std::chrono::microseconds agingThreshold = std::chrono::milliseconds(4);
+
+			// Applied by every worker to itself when it starts, failures are written to the error stream
+			AffinityPolicy affinity = AffinityPolicy::None;
+			std::vector<size_t> affinityCpus = {};		// OS processor indices for AffinityPolicy::Explicit
+			bool numaLocalMemory = false;			// prefer memory of the pinned processor's NUMA node, needs an affinity
+			std::string threadName = "";			// workers are named "<threadName> <index>", left to the OS if empty
+			Platform::ThreadPriority threadPriority = Platform::ThreadPriority::Normal;
+
+			// Task timing, task and error counters and the error ring, can be switched later with setDiagnosticsEnabled
+#ifdef NODEBUG
+			bool diagnostics = false;
+#else
+			bool diagnostics = true;
+#endif
+		};
+
+		// Counters of one priority level, wait time is measured from push until a worker takes the task
+		struct PriorityLevelStatistics {
+			size_t depth = 0;
+			uint64_t pushedCount = 0;
+			uint64_t dispatchedCount = 0;
+			std::chrono::nanoseconds totalWaitTime{ 0 };
+			std::chrono::nanoseconds maxWaitTime{ 0 };
+
+			inline std::chrono::nanoseconds averageWaitTime() const {
+				return dispatchedCount ? totalWaitTime / static_cast<int64_t>(dispatchedCount) : std::chrono::nanoseconds(0);
+			}
+		};
+
 		class Lock {
 			friend class MinimalThreadPool;
 		private:
@@ -45,43 +137,228 @@ namespace MultiThreading
 			operator std::unique_lock<std::mutex>&() { return m_lock; }
 		};
 
+		enum class ThreadState : uint8_t {
+			Waiting,
+			Working,
+			Inactive,
+			CatchingError,
+			Spinning,		// polling for a task before parking, WakeupPolicy::SpinThenPark
+		};
+
+		static constexpr size_t s_errorRingCapacity = 32;
+		using ErrorRecord = ErrorRing<s_errorRingCapacity>::Record;
+
+		struct ThreadDiagnostics {
+			ThreadState state = ThreadState::Inactive;
+			uintptr_t waitingOn = 0;							// address of the mutex the thread waits for, 0 if none
+			std::chrono::nanoseconds taskRunTime{ 0 };		// how long the current task has been running, when Working
+			uint64_t completedTaskCount = 0;
+			uint64_t errorCount = 0;
+		};
+
+		// Assembled from relaxed atomic loads while the pool keeps running, so the values of
+		// different threads may be a few moments apart, which is enough for a watchdog
+		struct DiagnosticsSnapshot {
+			std::chrono::steady_clock::time_point time;
+			std::vector<ThreadDiagnostics> threads;
+			std::vector<ErrorRecord> errors;				// the most recent errors, oldest first
+			uint64_t totalErrorCount = 0;
+			size_t queuedTaskCount = 0;
+			size_t pendingTaskCount = 0;
+		};
+
+		template<typename R>
+		class Future;
+
+		// co_await pool.schedule() suspends the coroutine and continues it as a task of the pool.
+		// From one of the pool's own workers in work-stealing mode the task goes to that worker's deque.
+		// A coroutine whose task is flushed or still queued when the pool is destroyed never resumes.
+		class ScheduleAwaitable {
+		private:
+			MinimalThreadPool& m_pool;
+			size_t m_priority;
+
+		public:
+			ScheduleAwaitable(MinimalThreadPool& pool, size_t priority) noexcept : m_pool(pool), m_priority(priority) {}
+
+			inline bool await_ready() const noexcept { return false; }
+			inline void await_suspend(std::coroutine_handle<> handle) {
+				m_pool.postTask([handle]() { handle.resume(); }, m_priority);
+			}
+			inline void await_resume() const noexcept {}
+		};
+
+		// Delays and periods are rounded up to whole timer ticks
+		static constexpr std::chrono::milliseconds s_timerResolution{ 1 };
+
+		// Identifies a timer for cancelTimer, cheap to copy and safe to use after the timer fired
+		class TimerHandle {
+			friend class MinimalThreadPool;
+		private:
+			uint64_t m_id = 0;
+			explicit TimerHandle(uint64_t id) noexcept : m_id(id) {}
+
+		public:
+			TimerHandle() noexcept = default;
+			inline bool valid() const noexcept { return m_id != 0; }
+		};
+
 	private:
+		template<typename R>
+		class FutureState;
+
+		template<typename R>
+		class Promise;
+
+		template<typename Task>
+		using TaskResult = typename std::conditional_t<std::is_invocable_v<Task&>,
+			std::invoke_result<Task&>, std::invoke_result<Task&, size_t>>::type;
+
+		// Tasks are constructed in place in preallocated slots, so pushing a callable that fits
+		// COMMON_API_TASK_INLINE_CAPACITY and running it does not allocate
+		using QueuedTask = InplaceTask<>;
+
+		// The task of a periodic timer stays with the timer, every firing queues a PeriodicRun calling it.
+		// Firings that fall due while a run is queued or running are skipped, so runs never overlap.
+		struct PeriodicTimer {
+			QueuedTask task;
+			std::atomic<bool> queued = false;
+
+			template<typename Task>
+			explicit PeriodicTimer(Task&& task) : task(std::forward<Task>(task)) {}
+		};
+
+		// Clears the queued flag when run or flushed
+		struct PeriodicRun {
+			std::shared_ptr<PeriodicTimer> timer;
+
+			explicit PeriodicRun(std::shared_ptr<PeriodicTimer> timer) noexcept : timer(std::move(timer)) {}
+			PeriodicRun(PeriodicRun&&) noexcept = default;
+			~PeriodicRun() { if (timer) timer->queued.store(false, std::memory_order_release); }
+
+			inline void operator()(size_t threadIndex) { timer->task(threadIndex); }
+		};
+
+		struct TimerEntry {
+			QueuedTask* task = nullptr;		// one-shot timers
+			std::shared_ptr<PeriodicTimer> periodic;
+			uint64_t period = 0;			// in ticks
+			size_t priority = 0;
+		};
+
+		// Maximum amount of tasks a work-stealing worker moves from the global queue to its deque at once
+		static constexpr size_t s_maxInjectionBatch = 32;
+
+		// Per thread scheduling state, the deque is only used in work-stealing mode
+		struct alignas(64) Worker {
+			ChaseLevDeque<QueuedTask*> tasks;
+			uint64_t randomState;
+			std::array<uint32_t, s_maxPriorityLevels> credits{};	// tasks left this round per level, weighted dispatch
+
+			// Diagnostics, only written by the owning thread. State and waitingOn are always kept
+			// up to date, timing and counters only while diagnostics are enabled.
+			alignas(64) std::atomic<ThreadState> state = ThreadState::Inactive;
+			std::atomic<uintptr_t> waitingOn = 0;
+			std::atomic<int64_t> taskStartTime = 0;
+			std::atomic<uint64_t> completedTaskCount = 0;
+			std::atomic<uint64_t> errorCount = 0;
+
+			explicit Worker(size_t index) : randomState(0x9E3779B97F4A7C15ull * (index + 1)) {}
+
+			// xorshift64, only used to pick steal victims
+			inline uint64_t nextRandom() {
+				randomState ^= randomState << 13;
+				randomState ^= randomState >> 7;
+				randomState ^= randomState << 17;
+				return randomState;
+			}
+		};
+
+		// Tasks waiting for a worker at one priority level. Producers push and workers pop lock-free.
+		// Once the queue is full pushes spill into overflow under the submission lock, and overflow keeps
+		// taking pushes until workers have moved it back into the queue so the level stays FIFO.
+		struct alignas(64) Level {
+			struct Entry {
+				QueuedTask* task;
+				int64_t enqueueTime;
+			};
+
+			BoundedQueue<Entry> queue;
+			Utilities::RingBuffer<Entry> overflow;		// submission lock
+			std::atomic<size_t> overflowCount = 0;
+			std::atomic<size_t> depth = 0;				// incremented before the push, never below the real size
+			std::atomic<int64_t> lastDispatchTime = 0;
+			uint32_t weight;
+
+			alignas(64) std::atomic<uint64_t> pushedCount = 0;
+			alignas(64) std::atomic<uint64_t> dispatchedCount = 0;
+			std::atomic<uint64_t> totalWaitTime = 0;
+			std::atomic<uint64_t> maxWaitTime = 0;
+
+			Level(size_t capacity, uint32_t weight) : queue(capacity), weight(std::max<uint32_t>(weight, 1)) {}
+		};
+
 		std::vector<std::thread> m_threads;
-		std::deque<std::function<void(size_t)>> m_tasks;
+		SlotPool<QueuedTask> m_taskSlots;
+		std::vector<std::unique_ptr<Level>> m_levels;	// only replaced by init while no worker threads run
+		std::atomic<size_t> m_levelCount = 0;			// m_levels.size(), for checks made without the submission lock
 		mutable std::mutex m_taskMutex;
 		std::condition_variable m_threadWakeUp;
 		std::condition_variable m_taskFinished;
 		std::condition_variable m_threadExited;
 
 		std::ostream* m_errorStream = nullptr;
+		SchedulerMode m_schedulerMode = SchedulerMode::GlobalQueue;
 
-		size_t m_threadAmountToRun;
-		size_t m_workingThreadCount;
-		size_t m_activeThreadCount;
+		// Worker placement, only changed by init while no worker threads run
+		std::vector<size_t> m_workerCpus;		// worker i is pinned to m_workerCpus[i % size], unpinned if empty
+		std::vector<size_t> m_workerNumaNodes;
+		bool m_numaLocalMemory = false;
+		std::string m_threadName;
+		Platform::ThreadPriority m_threadPriority = Platform::ThreadPriority::Normal;
+		DispatchPolicy m_dispatchPolicy = DispatchPolicy::Weighted;
+		WakeupPolicy m_wakeupPolicy = WakeupPolicy::Park;
+		uint32_t m_spinCount = 0;
+		uint32_t m_yieldCount = 0;
+		size_t m_defaultPriority = 0;
+		int64_t m_agingThreshold = 0;
 
-#ifndef NODEBUG
-		enum class ThreadState {
-			Waiting,
-			Working,
-			Inactive,
-			CatchingError,
-		};
+		std::atomic<size_t> m_threadAmountToRun = 0;
+		std::atomic<size_t> m_workingThreadCount = 0;
+		size_t m_activeThreadCount = 0;
 
-		struct ErrorInfo {
-			std::string what;
-			std::chrono::steady_clock::time_point timestamp;
-		};
+		// Queued plus running tasks, waitIdle waits for this to reach zero
+		std::atomic<size_t> m_pendingTaskCount = 0;
 
-		struct ThreadInfo {
-			std::thread::id id;
-			ThreadState state;
-			uintptr_t waitingOn;  // Track locked mutex address
-			std::vector<ErrorInfo> errors;
-		};
+		// Producers inside tryEnqueueTasks, plus s_levelsLocked while configureLevels replaces the levels
+		static constexpr size_t s_levelsLocked = size_t(1) << (sizeof(size_t) * 8 - 1);
+		std::atomic<size_t> m_unlockedProducers = 0;
 
-		std::vector<ThreadInfo> m_threadStates;
-		std::vector<std::unique_ptr<std::shared_mutex>> m_stateMutexes;
-#endif
+		// m_workers is only resized while no worker threads run, since thieves index it without holding the submission mutex.
+		// Resizing also takes m_workersMutex, which lets getDiagnostics read it without the submission mutex.
+		std::vector<std::unique_ptr<Worker>> m_workers;
+		mutable std::shared_mutex m_workersMutex;
+		std::atomic<size_t> m_queuedTaskCount = 0;		// sum of every level's depth
+		std::atomic<size_t> m_sleepingThreadCount = 0;		// changed under the submission lock
+		std::atomic<size_t> m_spinningThreadCount = 0;
+
+		static inline thread_local MinimalThreadPool* t_currentPool = nullptr;
+		static inline thread_local size_t t_currentThreadIndex = 0;
+
+		std::atomic<bool> m_diagnosticsEnabled = false;
+		ErrorRing<s_errorRingCapacity> m_errors;
+
+		// Delayed and periodic tasks. The first timer starts the timer thread, which queues tasks as they
+		// fall due independently of init and destroy, only the destructor stops it.
+		TimerWheel<TimerEntry> m_timers;			// m_timerMutex
+		mutable std::mutex m_timerMutex;
+		std::condition_variable m_timerWakeUp;
+		std::thread m_timerThread;
+		std::vector<std::pair<QueuedTask*, size_t>> m_dueTimerTasks;	// timer thread only
+		std::exception_ptr m_timerError;			// timer thread only, a firing that could not be queued
+		std::chrono::steady_clock::time_point m_timerEpoch = std::chrono::steady_clock::now();
+		uint64_t m_timerWakeTick = UINT64_MAX;		// m_timerMutex, tick the sleeping timer thread waits for
+		bool m_stopTimers = false;					// m_timerMutex
 
 	public:
 		MinimalThreadPool() noexcept = default;
@@ -91,33 +368,68 @@ namespace MultiThreading
 		MinimalThreadPool& operator=(MinimalThreadPool&&) = delete;
 
 		~MinimalThreadPool() {
-			destroy();
+			stopTimers();
+			flush(destroy());
 		}
 
 		inline Lock init(size_t threadCount, std::ostream& errorStream) {
 			return init(threadCount, lock(), errorStream);
 		}
 
-		Lock init(size_t threadCount, Lock&& lock, std::ostream& errorStream) {
+		inline Lock init(size_t threadCount, std::ostream& errorStream, const Options& options) {
+			return init(threadCount, lock(), errorStream, options);
+		}
+
+		inline Lock init(size_t threadCount, Lock&& lock, std::ostream& errorStream) {
+			return init(threadCount, std::move(lock), errorStream, Options{});
+		}
+
+		Lock init(size_t threadCount, Lock&& lock, std::ostream& errorStream, const Options& options) {
+			if (options.priorityLevelCount == 0 || options.priorityLevelCount > s_maxPriorityLevels)
+				throw std::invalid_argument("priorityLevelCount must be between 1 and s_maxPriorityLevels");
+			if (options.defaultPriority >= options.priorityLevelCount)
+				throw std::invalid_argument("defaultPriority must be a valid priority level");
+			if (options.affinity == AffinityPolicy::Explicit && options.affinityCpus.empty())
+				throw std::invalid_argument("AffinityPolicy::Explicit needs at least one processor in affinityCpus");
+
+			std::vector<size_t> workerCpus, workerNumaNodes;
+			if (options.affinity != AffinityPolicy::None) {
+				Platform::CpuTopology topology = Platform::CpuTopology::query();
+				if (options.affinity == AffinityPolicy::Explicit) workerCpus = options.affinityCpus;
+				else if (options.affinity == AffinityPolicy::Compact) workerCpus = topology.compactOrder();
+				else workerCpus = topology.scatterOrder();
+				for (size_t cpu : workerCpus) workerNumaNodes.push_back(topology.numaNodeOf(cpu));
+			}
+
 			lock = destroy(std::move(lock));
+			m_workerCpus = std::move(workerCpus);
+			m_workerNumaNodes = std::move(workerNumaNodes);
+			m_numaLocalMemory = options.numaLocalMemory;
+			m_threadName = options.threadName;
+			m_threadPriority = options.threadPriority;
 			m_errorStream = &errorStream;
+			m_schedulerMode = options.schedulerMode;
+			m_dispatchPolicy = options.dispatchPolicy;
+			m_wakeupPolicy = options.wakeupPolicy;
+			// A spinning worker only keeps the producer off the single processor
+			m_spinCount = std::thread::hardware_concurrency() > 1 ? options.spinCount : 0;
+			m_yieldCount = options.yieldCount;
+			m_defaultPriority = options.defaultPriority;
+			m_agingThreshold = std::chrono::duration_cast<std::chrono::nanoseconds>(options.agingThreshold).count();
+			m_diagnosticsEnabled.store(options.diagnostics, std::memory_order_relaxed);
+			m_taskSlots.reserve(options.taskSlotCapacity);
+			configureLevels(options);
+			{
+				std::unique_lock<std::shared_mutex> workersLock(m_workersMutex);
+				m_workers.clear();
+				for (size_t i = 0; i < threadCount; ++i) m_workers.push_back(std::make_unique<Worker>(i));
+			}
 			m_threads.resize(threadCount);
 			m_threadAmountToRun = threadCount;
 			m_activeThreadCount = 0;
 			m_workingThreadCount = 0;
 
-#ifndef NODEBUG
-			m_threadStates.resize(threadCount);
-			m_stateMutexes.resize(threadCount);
-#endif
-			for(size_t i = 0; i < m_threads.size(); ++i) {
-#ifndef NODEBUG
-				m_threadStates[i].id = m_threads[i].get_id();
-				m_threadStates[i].state = ThreadState::Inactive;
-				m_stateMutexes[i] = std::make_unique<std::shared_mutex>();
-#endif
-				m_threads[i] = std::thread([this, i](){ threadLoop(i); });
-			}
+			for(size_t i = 0; i < m_threads.size(); ++i) m_threads[i] = startThread(i);
 			
 			return lock;
 		}
@@ -127,6 +439,7 @@ namespace MultiThreading
 		}
 
 		Lock destroy(Lock&& lock) {
+			ownLock(lock);
 			if(m_errorStream == nullptr) return std::move(lock);
 			m_threadAmountToRun = 0;
 			m_threadWakeUp.notify_all();
@@ -134,12 +447,20 @@ namespace MultiThreading
 
 			for(size_t i = 0; i < m_threads.size(); ++i) m_threads[i].join();
 			m_threads.clear();
+			{
+				std::unique_lock<std::shared_mutex> workersLock(m_workersMutex);
+				m_workers.clear();
+			}
 			m_errorStream = nullptr;
 
 			return lock;
 		}
 
-		// Locks task submission
+		// Locks task submission through pushTask and pushTasks and every call that manages the pool.
+		// postTask, postTasks and what is built on them, such as submit, schedule, parallel loops, task
+		// graphs and the coordinators, only take it to spill into a full level, so holding it does not
+		// stop them.
+		// Every call returning a Lock returns it owned, every call taking one accepts an unowned one.
 		inline Lock lock() const {
 			Lock lock(m_taskMutex);
 			return lock;
@@ -162,96 +483,160 @@ namespace MultiThreading
 
 		// Locks task submission and waits until threads finish current tasks they are performing
 		inline Lock wait(Lock&& lock) {
+			ownLock(lock);
 			m_taskFinished.wait(lock, [this](){ return m_workingThreadCount == 0; });
 			return lock;
 		}
 
 		// Wait until all tasks in the queue are complete
 		inline Lock waitIdle(Lock&& lock) {
-			m_taskFinished.wait(lock, [this](){ return m_tasks.empty() && m_workingThreadCount == 0; });
+			ownLock(lock);
+			m_taskFinished.wait(lock, [this](){ return m_pendingTaskCount.load() == 0; });
 			return lock;
 		}
 
-		//flushes the task queue
+		// Flushes the task queue, in work-stealing mode tasks already moved to worker deques are kept.
+		// Tasks posted while it runs may be kept as well.
 		inline Lock flush(Lock&& lock) {
-			m_tasks.clear();
+			ownLock(lock);
+			for (auto& level : m_levels) {
+				size_t count = 0;
+				Level::Entry entry;
+				while (level->queue.tryPop(entry)) {
+					m_taskSlots.destroy(entry.task);
+					++count;
+				}
+				while (!level->overflow.empty()) {
+					m_taskSlots.destroy(level->overflow.popFront().task);
+					++count;
+				}
+				level->overflowCount.store(0, std::memory_order_relaxed);
+				level->depth.fetch_sub(count, std::memory_order_relaxed);
+				m_queuedTaskCount.fetch_sub(count, std::memory_order_relaxed);
+				m_pendingTaskCount -= count;
+			}
+			m_taskFinished.notify_all();
 			return lock;
 		}
 
+		// Queues task at the default priority level under the submission lock and returns it, so holding
+		// lock() holds back pushTask. In work-stealing mode a task pushed from one of this pool's workers
+		// goes to that worker's deque.
 		template<typename Task>
 		inline Lock pushTask(Task&& task) {
-			return pushTask(std::forward<Task>(task), lock());
+			return pushTask(std::forward<Task>(task), m_defaultPriority, lock());
 		}
 
 		template<typename Task>
 		inline Lock pushTask(Task&& task, Lock&& lock) {
-			if constexpr (std::is_invocable_v<Task>) {
-				m_tasks.push_back([task = std::forward<Task>(task), this](size_t threadIndex) {
-					(void)threadIndex;
-					task();
-					});
-				m_threadWakeUp.notify_one();
-			}
-			else if constexpr (std::is_invocable_v<Task, size_t>) {
-				m_tasks.push_back(std::forward<Task>(task));
-				m_threadWakeUp.notify_one();
-			}
-			else {
-				static_assert(
-					std::is_invocable_v<Task> || std::is_invocable_v<Task, size_t>,
-					"Task must be callable as either void() or void(size_t)"
-					);
-			}
-			return lock;
+			return pushTask(std::forward<Task>(task), m_defaultPriority, std::move(lock));
+		}
+
+		// Queues task at the given priority level, 0 being the most urgent.
+		// Tasks of one level start in the order they were pushed.
+		template<typename Task>
+		inline Lock pushTask(Task&& task, size_t priority) {
+			return pushTask(std::forward<Task>(task), priority, lock());
 		}
 
+		template<typename Task>
+		Lock pushTask(Task&& task, size_t priority, Lock&& lock) {
+			ownLock(lock);
+			queueTask(std::forward<Task>(task), priority, lock);
+			return std::move(lock);
+		}
+
+		// Queues task like pushTask but without the submission lock: the task goes into the level's
+		// lock-free queue, or into the worker's deque, and only a push into a full level takes the lock
+		// for the spill. Holding lock() does not hold postTask back.
+		template<typename Task>
+		inline void postTask(Task&& task) {
+			postTask(std::forward<Task>(task), m_defaultPriority);
+		}
+
+		template<typename Task>
+		inline void postTask(Task&& task, size_t priority) {
+			Lock lock;
+			queueTask(std::forward<Task>(task), priority, lock);
+		}
+
+		// Queues task at priority level 0
 		template<typename Task>
 		inline Lock pushPriorityTask(Task&& task) {
-			return pushPriorityTask(std::forward<Task>(task), lock());
+			return pushTask(std::forward<Task>(task), 0);
 		}
 
 		template<typename Task>
 		inline Lock pushPriorityTask(Task&& task, Lock&& lock) {
-			if constexpr (std::is_invocable_v<Task>) {
-				m_tasks.push_front([task = std::forward<Task>(task), this](size_t threadIndex) {
-					(void)threadIndex;
-					task();
-					});
-				m_threadWakeUp.notify_one();
-			}
-			else if constexpr (std::is_invocable_v<Task, size_t>) {
-				m_tasks.push_front(std::forward<Task>(task));
-				m_threadWakeUp.notify_one();
-			}
-			else {
-				static_assert(
-					std::is_invocable_v<Task> || std::is_invocable_v<Task, size_t>,
-					"Task must be callable as either void() or void(size_t)"
-					);
-			}
-			return lock;
+			return pushTask(std::forward<Task>(task), 0, std::move(lock));
 		}
 
-		template<typename TaskContainer>
-		inline Lock pushTasks(const TaskContainer& tasks) {		
-			return pushTasks(tasks, lock());
+		// Queues task with postTask and returns a Future for its result. Exceptions thrown by the task
+		// are rethrown by Future::get instead of being written to the error stream.
+		template<typename Task>
+		inline auto submit(Task&& task) -> Future<TaskResult<std::decay_t<Task>>> {
+			return submit(std::forward<Task>(task), m_defaultPriority);
 		}
 
-		template<typename TaskContainer>
-		inline Lock pushTasks(const TaskContainer& tasks, Lock&& lock) {
-			for(size_t i = 0; i < tasks.size(); ++i) lock = pushTask(tasks[i], std::move(lock));			
-			return lock;
+		template<typename Task>
+		auto submit(Task&& task, size_t priority) -> Future<TaskResult<std::decay_t<Task>>> {
+			using Result = TaskResult<std::decay_t<Task>>;
+			FutureState<Result>* state = FutureState<Result>::create();
+			Future<Result> future(state, this);
+			postTask([promise = Promise<Result>(state), task = std::forward<Task>(task)](size_t threadIndex) mutable {
+				promise.run(task, threadIndex);
+				}, priority);
+			return future;
 		}
 
-		template<typename TaskContainer>
-		inline Lock pushPriorityTasks(const TaskContainer& tasks) {		
-			return pushPriorityTasks(tasks, lock());
+		// Queues every task of the range in order under the submission lock, reserving task slots once,
+		// claiming queue space a batch at a time and waking min(task count, parked workers) workers once
+		// at the end. Tasks are moved out of an owning container passed as an rvalue and out of ranges
+		// of rvalues, such as a subrange of move iterators over a span, and copied otherwise.
+		template<std::ranges::input_range TaskRange>
+		inline Lock pushTasks(TaskRange&& tasks) {
+			return pushTasks(std::forward<TaskRange>(tasks), m_defaultPriority, lock());
 		}
 
-		template<typename TaskContainer>
-		inline Lock pushPriorityTasks(const TaskContainer& tasks, Lock&& lock) {
-			for(size_t i = 0; i < tasks.size(); ++i) lock = pushPriorityTask(tasks[i], std::move(lock));			
-			return lock;
+		template<std::ranges::input_range TaskRange>
+		inline Lock pushTasks(TaskRange&& tasks, Lock&& lock) {
+			return pushTasks(std::forward<TaskRange>(tasks), m_defaultPriority, std::move(lock));
+		}
+
+		template<std::ranges::input_range TaskRange>
+		inline Lock pushTasks(TaskRange&& tasks, size_t priority) {
+			return pushTasks(std::forward<TaskRange>(tasks), priority, lock());
+		}
+
+		template<std::ranges::input_range TaskRange>
+		Lock pushTasks(TaskRange&& tasks, size_t priority, Lock&& lock) {
+			ownLock(lock);
+			queueTasks(std::forward<TaskRange>(tasks), priority, lock);
+			return std::move(lock);
+		}
+
+		// Queues the range like pushTasks but, like postTask, only takes the submission lock for
+		// tasks that spill into a full level
+		template<std::ranges::input_range TaskRange>
+		inline void postTasks(TaskRange&& tasks) {
+			postTasks(std::forward<TaskRange>(tasks), m_defaultPriority);
+		}
+
+		template<std::ranges::input_range TaskRange>
+		inline void postTasks(TaskRange&& tasks, size_t priority) {
+			Lock lock;
+			queueTasks(std::forward<TaskRange>(tasks), priority, lock);
+		}
+
+		// Queued at level 0 in range order
+		template<std::ranges::input_range TaskRange>
+		inline Lock pushPriorityTasks(TaskRange&& tasks) {
+			return pushTasks(std::forward<TaskRange>(tasks), 0, lock());
+		}
+
+		template<std::ranges::input_range TaskRange>
+		inline Lock pushPriorityTasks(TaskRange&& tasks, Lock&& lock) {
+			return pushTasks(std::forward<TaskRange>(tasks), 0, std::move(lock));
 		}
 
 		inline Lock resize(size_t newSize) {
@@ -271,25 +656,37 @@ namespace MultiThreading
 		}
 
 		inline Lock size(size_t& result, Lock&& lock) const {
+			ownLock(lock);
 			result = m_threads.size();
 			return lock;
 		}
 
 		inline Lock resize(size_t newSize, Lock&& lock) {
+			ownLock(lock);
 			if(newSize > m_threads.size()) return grow(newSize, std::move(lock));
 			else if(newSize < m_threads.size()) return shrink(newSize, std::move(lock));
 			return lock;
 		}
 
 		Lock grow(size_t newSize, Lock&& lock) {
+			ownLock(lock);
 			size_t oldSize = m_threads.size();
+			if (newSize > m_workers.size()) {
+				// Thieves read m_workers without the lock, so stop every worker before reallocating it.
+				// Their deques are drained back into the default priority level on exit.
+				lock = shrink(0, std::move(lock));
+				oldSize = 0;
+				std::unique_lock<std::shared_mutex> workersLock(m_workersMutex);
+				while (m_workers.size() < newSize) m_workers.push_back(std::make_unique<Worker>(m_workers.size()));
+			}
 			m_threads.resize(newSize);
 			m_threadAmountToRun = newSize;
-			for(size_t i = oldSize; i < m_threads.size(); ++i) m_threads[i] = std::thread([this, i](){ threadLoop(i); });
+			for(size_t i = oldSize; i < m_threads.size(); ++i) m_threads[i] = startThread(i);
 			return lock;
 		}
 
 		Lock shrink(size_t newSize, Lock&& lock) {
+			ownLock(lock);
 			m_threadAmountToRun = newSize;
 			m_threadWakeUp.notify_all();
 			m_threadExited.wait(lock, [&](){ return m_activeThreadCount == newSize; });
@@ -310,70 +707,816 @@ namespace MultiThreading
 
 		inline size_t getThreadCount() const {
 			auto lock = this->lock();
-			return m_workingThreadCount;
+			return m_threads.size();
 		}
 
-	private:
+		inline SchedulerMode getSchedulerMode() const {
+			auto lock = this->lock();
+			return m_schedulerMode;
+		}
 
-		void threadLoop(size_t threadIndex) {
+		inline size_t getPriorityLevelCount() const {
 			auto lock = this->lock();
-#ifndef NODEBUG
-			auto& threadInfo = m_threadStates[threadIndex];
-			auto& threadInfoMutex = *m_stateMutexes[threadIndex];
-			threadInfoMutex.lock();
-			threadInfo.waitingOn = reinterpret_cast<uintptr_t>(&m_taskMutex);
-			threadInfo.state = ThreadState::Inactive;
-			threadInfoMutex.unlock();
-#endif
+			return m_levels.size();
+		}
+
+		// Counters are read one by one while workers keep updating them, so they are not an atomic snapshot
+		PriorityLevelStatistics getPriorityLevelStatistics(size_t priority) const {
+			auto lock = this->lock();
+			const Level& level = *m_levels.at(priority);
+			PriorityLevelStatistics statistics;
+			statistics.depth = level.depth.load(std::memory_order_relaxed);
+			statistics.pushedCount = level.pushedCount.load(std::memory_order_relaxed);
+			statistics.dispatchedCount = level.dispatchedCount.load(std::memory_order_relaxed);
+			statistics.totalWaitTime = std::chrono::nanoseconds(level.totalWaitTime.load(std::memory_order_relaxed));
+			statistics.maxWaitTime = std::chrono::nanoseconds(level.maxWaitTime.load(std::memory_order_relaxed));
+			return statistics;
+		}
+
+		// Zeroes the push, dispatch and wait time counters of every level, depth is left alone
+		void resetPriorityLevelStatistics() {
+			auto lock = this->lock();
+			for (auto& level : m_levels) {
+				level->pushedCount.store(0, std::memory_order_relaxed);
+				level->dispatchedCount.store(0, std::memory_order_relaxed);
+				level->totalWaitTime.store(0, std::memory_order_relaxed);
+				level->maxWaitTime.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		// Task timing, task and error counters and error recording cost a clock read and a few
+		// relaxed atomic operations per task, so they can be switched off in hot builds
+		inline void setDiagnosticsEnabled(bool enabled) {
+			m_diagnosticsEnabled.store(enabled, std::memory_order_relaxed);
+		}
+
+		inline bool isDiagnosticsEnabled() const {
+			return m_diagnosticsEnabled.load(std::memory_order_relaxed);
+		}
+
+		// Does not take the submission mutex, so a watchdog can call it while the pool is stuck
+		DiagnosticsSnapshot getDiagnostics() const {
+			DiagnosticsSnapshot snapshot;
+			snapshot.time = std::chrono::steady_clock::now();
+			int64_t now = snapshot.time.time_since_epoch().count();
+			{
+				std::shared_lock<std::shared_mutex> workersLock(m_workersMutex);
+				snapshot.threads.reserve(m_workers.size());
+				for (const auto& worker : m_workers) {
+					ThreadDiagnostics& thread = snapshot.threads.emplace_back();
+					thread.state = worker->state.load(std::memory_order_relaxed);
+					thread.waitingOn = worker->waitingOn.load(std::memory_order_relaxed);
+					thread.completedTaskCount = worker->completedTaskCount.load(std::memory_order_relaxed);
+					thread.errorCount = worker->errorCount.load(std::memory_order_relaxed);
+					int64_t taskStartTime = worker->taskStartTime.load(std::memory_order_relaxed);
+					if (thread.state == ThreadState::Working && taskStartTime != 0)
+						thread.taskRunTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+							std::chrono::steady_clock::duration(std::max<int64_t>(now - taskStartTime, 0)));
+				}
+			}
+			m_errors.snapshot(snapshot.errors);
+			snapshot.totalErrorCount = m_errors.recordedCount();
+			snapshot.queuedTaskCount = m_queuedTaskCount.load(std::memory_order_relaxed);
+			snapshot.pendingTaskCount = m_pendingTaskCount.load(std::memory_order_relaxed);
+			return snapshot;
+		}
+
+		inline ScheduleAwaitable schedule() {
+			return ScheduleAwaitable(*this, m_defaultPriority);
+		}
+
+		inline ScheduleAwaitable schedule(size_t priority) {
+			if (m_levelCount.load(std::memory_order_relaxed) == 0) throw std::runtime_error("Thread pool not initialized");
+			if (priority >= m_levelCount.load(std::memory_order_relaxed)) throw std::out_of_range("Priority level does not exist");
+			return ScheduleAwaitable(*this, priority);
+		}
+
+		// Queues task once delay has passed. A timer falling due while the pool has no workers,
+		// after destroy, queues its task for the next init.
+		template<typename Rep, typename Period, typename Task>
+		inline TimerHandle scheduleAfter(std::chrono::duration<Rep, Period> delay, Task&& task) {
+			return scheduleAfter(delay, std::forward<Task>(task), m_defaultPriority);
+		}
+
+		template<typename Rep, typename Period, typename Task>
+		inline TimerHandle scheduleAfter(std::chrono::duration<Rep, Period> delay, Task&& task, size_t priority) {
+			return scheduleAt(std::chrono::steady_clock::now() + std::chrono::ceil<std::chrono::steady_clock::duration>(delay),
+				std::forward<Task>(task), priority);
+		}
+
+		template<typename Task>
+		inline TimerHandle scheduleAt(std::chrono::steady_clock::time_point time, Task&& task) {
+			return scheduleAt(time, std::forward<Task>(task), m_defaultPriority);
+		}
+
+		template<typename Task>
+		TimerHandle scheduleAt(std::chrono::steady_clock::time_point time, Task&& task, size_t priority) {
+			if (m_levelCount.load(std::memory_order_relaxed) == 0) throw std::runtime_error("Thread pool not initialized");
+			if (priority >= m_levelCount.load(std::memory_order_relaxed)) throw std::out_of_range("Priority level does not exist");
+			QueuedTask* queuedTask = m_taskSlots.create(std::forward<Task>(task));
+			try {
+				return addTimer(toTimerTick(time), TimerEntry{ queuedTask, nullptr, 0, priority });
+			} catch (...) {
+				m_taskSlots.destroy(queuedTask);
+				throw;
+			}
+		}
+
+		// Queues task every period, first one period from now. Firings keep to that schedule and the ones
+		// falling due while the previous run is still queued or running are skipped.
+		template<typename Rep, typename Period, typename Task>
+		inline TimerHandle scheduleEvery(std::chrono::duration<Rep, Period> period, Task&& task) {
+			return scheduleEvery(period, std::forward<Task>(task), m_defaultPriority);
+		}
+
+		template<typename Rep, typename Period, typename Task>
+		TimerHandle scheduleEvery(std::chrono::duration<Rep, Period> period, Task&& task, size_t priority) {
+			if (m_levelCount.load(std::memory_order_relaxed) == 0) throw std::runtime_error("Thread pool not initialized");
+			if (priority >= m_levelCount.load(std::memory_order_relaxed)) throw std::out_of_range("Priority level does not exist");
+			auto ticks = std::chrono::ceil<std::chrono::milliseconds>(period) / s_timerResolution;
+			auto periodic = std::make_shared<PeriodicTimer>(std::forward<Task>(task));
+			uint64_t periodTicks = static_cast<uint64_t>(std::max<decltype(ticks)>(ticks, 1));
+			return addTimer(toTimerTick(std::chrono::steady_clock::now()) + periodTicks,
+				TimerEntry{ nullptr, std::move(periodic), periodTicks, priority });
+		}
+
+		// Stops the timer, false if it already fired or was cancelled.
+		// A run of a periodic timer that is already queued still goes ahead.
+		bool cancelTimer(TimerHandle handle) {
+			std::optional<TimerEntry> entry;
+			{
+				std::lock_guard<std::mutex> lock(m_timerMutex);
+				entry = m_timers.cancel(handle.m_id);
+			}
+			if (!entry) return false;
+			if (entry->task) m_taskSlots.destroy(entry->task);
+			return true;
+		}
+
+		inline size_t getPendingTimerCount() const {
+			std::lock_guard<std::mutex> lock(m_timerMutex);
+			return m_timers.size();
+		}
+
+		// True when called from one of this pool's worker threads
+		inline bool isWorkerThread() const {
+			return t_currentPool == this;
+		}
+
+		// Pool whose worker thread is calling, nullptr on any other thread
+		static inline MinimalThreadPool* getCurrentPool() {
+			return t_currentPool;
+		}
+
+		// Index of the calling worker thread, only meaningful when isWorkerThread() is true
+		inline size_t getCurrentThreadIndex() const {
+			return t_currentThreadIndex;
+		}
+
+		// Cheap, racy hint that pushing another task would put an idle worker to use.
+		// In work-stealing mode a worker asks whether its own deque has run dry, which means
+		// thieves took everything it offered, otherwise whether fewer tasks are queued than threads exist.
+		inline bool hasSpareCapacity() const {
+			if (isLocalWorker()) return m_workers[t_currentThreadIndex]->tasks.empty();
+			return m_queuedTaskCount.load(std::memory_order_relaxed) < m_threadAmountToRun.load(std::memory_order_relaxed);
+		}
+
+		// Runs one queued task on the calling worker thread, so a worker waiting on another
+		// task's result keeps the pool busy instead of blocking. Returns false when called
+		// from a thread that is not one of this pool's workers or when nothing is queued.
+		bool tryRunPendingTask() {
+			if (!isWorkerThread()) return false;
+			size_t threadIndex = t_currentThreadIndex;
+			QueuedTask* task = nullptr;
+
+			if (m_schedulerMode == SchedulerMode::WorkStealing) {
+				if (!findTask(threadIndex, task)) return false;
+			}
+			else if (!dispatchTasks(*m_workers[threadIndex], &task, 1)) return false;
+			runTask(threadIndex, task);
+			return true;
+		}
+
+	private:
+
+		// Requires the submission lock. The thread counts as active from here on, so shrink
+		// can not stop waiting and join it before it got to take the lock itself.
+		std::thread startThread(size_t threadIndex) {
 			++m_activeThreadCount;
-			while(true) {
-#ifndef NODEBUG
-				threadInfoMutex.lock();
-				threadInfo.state = ThreadState::Waiting;
-				threadInfoMutex.unlock();
-#endif
-				m_threadWakeUp.wait(lock, [&](){ return !m_tasks.empty() || m_threadAmountToRun <= threadIndex; });
-				if(m_threadAmountToRun <= threadIndex) break;
-				std::function task = m_tasks.front();
-				m_tasks.pop_front();
-				++m_workingThreadCount;
-				lock.unlock();
-#ifndef NODEBUG
-				threadInfoMutex.lock();
-				threadInfo.state = ThreadState::Working;
-				threadInfo.waitingOn = 0;
-				threadInfoMutex.unlock();
-#endif
+			if (m_schedulerMode == SchedulerMode::WorkStealing)
+				return std::thread([this, threadIndex](){ stealingThreadLoop(threadIndex); });
+			return std::thread([this, threadIndex](){ threadLoop(threadIndex); });
+		}
+
+		inline bool isLocalWorker() const {
+			return t_currentPool == this && m_schedulerMode == SchedulerMode::WorkStealing;
+		}
+
+		static inline int64_t timestamp() {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		// Requires the submission lock and no running worker threads, queued tasks move to the
+		// new level of the same priority or to the least urgent one if there are fewer levels now
+		void configureLevels(const Options& options) {
+			// Producers that see the flag fall back to the submission lock, the ones already inside are waited for
+			m_unlockedProducers.fetch_or(s_levelsLocked, std::memory_order_relaxed);
+			while ((m_unlockedProducers.load(std::memory_order_acquire) & ~s_levelsLocked) != 0) std::this_thread::yield();
+			struct Unlock {
+				std::atomic<size_t>& producers;
+				~Unlock() { producers.fetch_and(~s_levelsLocked, std::memory_order_release); }
+			} unlock{ m_unlockedProducers };
+
+			std::vector<std::vector<QueuedTask*>> queued(m_levels.size());
+			for (size_t i = 0; i < m_levels.size(); ++i) {
+				Level::Entry entry;
+				while (m_levels[i]->queue.tryPop(entry)) queued[i].push_back(entry.task);
+				while (!m_levels[i]->overflow.empty()) queued[i].push_back(m_levels[i]->overflow.popFront().task);
+			}
+
+			m_levels.clear();
+			m_queuedTaskCount.store(0, std::memory_order_relaxed);
+			for (size_t i = 0; i < options.priorityLevelCount; ++i)
+				m_levels.push_back(std::make_unique<Level>(options.taskSlotCapacity, options.levelWeights[i]));
+			m_levelCount.store(m_levels.size(), std::memory_order_relaxed);
+
+			for (size_t i = 0; i < queued.size(); ++i)
+				for (QueuedTask* task : queued[i]) enqueueTask(std::min(i, m_levels.size() - 1), task);
+		}
+
+		// Calls taking a Lock take the submission lock themselves if the one passed is not owned
+		inline void ownLock(Lock& lock) const {
+			if (!lock.isLocked()) lock = this->lock();
+		}
+
+		// Queues task without taking the submission lock unless lock is owned already or the level is
+		// full, in which case lock ends up owned
+		template<typename Task>
+		void queueTask(Task&& task, size_t priority, Lock& lock) {
+			if (m_levelCount.load(std::memory_order_relaxed) == 0) throw std::runtime_error("Thread pool not initialized");
+			if (priority >= m_levelCount.load(std::memory_order_relaxed)) throw std::out_of_range("Priority level does not exist");
+			QueuedTask* queuedTask = m_taskSlots.create(std::forward<Task>(task));
+			try {
+				if (isLocalWorker() && priority == m_defaultPriority) pushLocalTask(queuedTask);
+				else {
+					++m_pendingTaskCount;
+					if (tryEnqueueTasks(priority, &queuedTask, 1) == 0) {
+						if (!lock.isLocked()) lock = this->lock();
+						enqueueTask(priority, queuedTask);
+					}
+				}
+			} catch (...) {
+				discardTasks(&queuedTask, 1, lock);
+				throw;
+			}
+			wakeWorkers(1, lock);
+		}
+
+		// Queues the range like queueTask does a single task
+		template<std::ranges::input_range TaskRange>
+		void queueTasks(TaskRange&& tasks, size_t priority, Lock& lock) {
+			if (m_levelCount.load(std::memory_order_relaxed) == 0) throw std::runtime_error("Thread pool not initialized");
+			if (priority >= m_levelCount.load(std::memory_order_relaxed)) throw std::out_of_range("Priority level does not exist");
+			const bool local = isLocalWorker() && priority == m_defaultPriority;
+			if constexpr (std::ranges::sized_range<TaskRange>) {
+				size_t needed = m_pendingTaskCount.load(std::memory_order_relaxed) + std::ranges::size(tasks);
+				if (m_taskSlots.capacity() < needed) m_taskSlots.reserve(needed);
+			}
+
+			std::array<QueuedTask*, s_maxInjectionBatch> batch;
+			size_t batched = 0, pushed = 0;
+			auto flushBatch = [&]() {
+				m_pendingTaskCount.fetch_add(batched);
+				size_t queued = 0;
 				try {
-					task(threadIndex);
-					lock.lock();
-#ifndef NODEBUG
-					threadInfoMutex.lock();
-					threadInfo.waitingOn = reinterpret_cast<uintptr_t>(&m_taskMutex);
-					threadInfoMutex.unlock();
-#endif
-				} catch(const std::exception& e) {
-					lock.lock();
-#ifndef NODEBUG
-					threadInfoMutex.lock();
-					threadInfo.state = ThreadState::CatchingError;
-					threadInfo.waitingOn = reinterpret_cast<uintptr_t>(&m_taskMutex);
-					threadInfo.errors.push_back(ErrorInfo{.what = e.what(), .timestamp = std::chrono::steady_clock::now()});
-					threadInfoMutex.unlock();
+					if (local) for (; queued < batched; ++queued) m_workers[t_currentThreadIndex]->tasks.push(batch[queued]);
+					else {
+						queued = tryEnqueueTasks(priority, batch.data(), batched);
+						if (queued < batched) {
+							if (!lock.isLocked()) lock = this->lock();
+							enqueueTasks(priority, batch.data() + queued, batched - queued);
+							queued = batched;
+						}
+					}
+				} catch (...) {
+					discardTasks(batch.data() + queued, batched - queued, lock);
+					pushed += queued;
+					batched = 0;
+					throw;
+				}
+				pushed += batched;
+				batched = 0;
+			};
+			try {
+				for (auto&& task : tasks) {
+					if constexpr (std::is_lvalue_reference_v<TaskRange> || std::ranges::borrowed_range<TaskRange>)
+						batch[batched] = m_taskSlots.create(std::forward<decltype(task)>(task));
+					else batch[batched] = m_taskSlots.create(std::move(task));
+					if (++batched == batch.size()) flushBatch();
+				}
+				flushBatch();
+			} catch (...) {
+				// Queues what was created before the failure, a failed flush left nothing to queue
+				try {
+					flushBatch();
+				} catch (...) {}
+				wakeWorkers(pushed, lock);
+				throw;
+			}
+			wakeWorkers(pushed, lock);
+		}
+
+		// Pushes the first tasks into the level's queue without the submission lock and returns how many,
+		// at most s_maxInjectionBatch. Pushes nothing while the level has overflowed, the caller then
+		// queues the rest with enqueueTasks so that it stays behind the overflow. The caller accounts
+		// for the pending tasks.
+		size_t tryEnqueueTasks(size_t priority, QueuedTask* const* tasks, size_t count) {
+			if (m_unlockedProducers.fetch_add(1, std::memory_order_acquire) & s_levelsLocked) {
+				m_unlockedProducers.fetch_sub(1, std::memory_order_release);
+				return 0;
+			}
+			size_t queued = 0;
+			// init may have dropped the level since the caller checked, enqueueTasks then reports it
+			Level* level = priority < m_levels.size() ? m_levels[priority].get() : nullptr;
+			if (level && level->overflowCount.load(std::memory_order_relaxed) == 0) {
+				int64_t now = timestamp();
+				// Counted before publishing like in enqueueTasks, what did not fit is uncounted again
+				m_queuedTaskCount.fetch_add(count, std::memory_order_relaxed);
+				if (level->depth.fetch_add(count, std::memory_order_relaxed) == 0)
+					level->lastDispatchTime.store(now, std::memory_order_relaxed);
+
+				if (count == 1) queued = level->queue.tryPush(Level::Entry{ tasks[0], now }) ? 1 : 0;
+				else {
+					std::array<Level::Entry, s_maxInjectionBatch> entries;
+					for (size_t i = 0; i < count; ++i) entries[i] = Level::Entry{ tasks[i], now };
+					queued = level->queue.pushN(entries.data(), count);
+				}
+				level->pushedCount.fetch_add(queued, std::memory_order_relaxed);
+				if (queued < count) {
+					level->depth.fetch_sub(count - queued, std::memory_order_relaxed);
+					m_queuedTaskCount.fetch_sub(count - queued, std::memory_order_relaxed);
+				}
+			}
+			m_unlockedProducers.fetch_sub(1, std::memory_order_release);
+			return queued;
+		}
+
+		// Requires the submission lock, the caller accounts for the pending task
+		inline void enqueueTask(size_t priority, QueuedTask* task) {
+			enqueueTasks(priority, &task, 1);
+		}
+
+		// Requires the submission lock, the caller accounts for the pending tasks.
+		// Room for a spill is reserved first, so if this throws nothing was queued.
+		void enqueueTasks(size_t priority, QueuedTask* const* tasks, size_t count) {
+			if (count == 0) return;
+			if (priority >= m_levels.size()) throw std::out_of_range("Priority level does not exist");
+			Level& level = *m_levels[priority];
+			level.overflow.reserve(level.overflow.size() + count);
+			int64_t now = timestamp();
+
+			// Counted before publishing so that consumers never decrement below zero
+			m_queuedTaskCount.fetch_add(count, std::memory_order_relaxed);
+			if (level.depth.fetch_add(count, std::memory_order_relaxed) == 0)
+				level.lastDispatchTime.store(now, std::memory_order_relaxed);
+			level.pushedCount.fetch_add(count, std::memory_order_relaxed);
+
+			size_t queued = 0;
+			if (level.overflowCount.load(std::memory_order_relaxed) == 0)
+				while (queued < count && level.queue.tryPush(Level::Entry{ tasks[queued], now })) ++queued;
+			if (queued == count) return;
+
+			for (; queued < count; ++queued) level.overflow.pushBack(Level::Entry{ tasks[queued], now });
+			level.overflowCount.store(level.overflow.size(), std::memory_order_relaxed);
+		}
+
+		// Lock-free unless the level overflowed, then the overflow is moved back into the queue first
+		bool popEntry(Level& level, Level::Entry& entry) {
+			if (level.queue.tryPop(entry)) return true;
+			if (level.overflowCount.load(std::memory_order_relaxed) == 0) return false;
+
+			auto lock = this->lock();
+			while (!level.overflow.empty() && level.queue.tryPush(level.overflow.front())) level.overflow.popFront();
+			level.overflowCount.store(level.overflow.size(), std::memory_order_relaxed);
+			return level.queue.tryPop(entry);
+		}
+
+		// Level the worker should serve next according to the dispatch policy, m_levels.size() if all look empty
+		size_t selectLevel(Worker& worker) {
+			const size_t levelCount = m_levels.size();
+			if (m_dispatchPolicy == DispatchPolicy::Aging) {
+				int64_t now = timestamp();
+				int64_t longestWait = m_agingThreshold;
+				size_t selected = levelCount;
+				for (size_t i = 1; i < levelCount; ++i) {
+					if (m_levels[i]->depth.load(std::memory_order_relaxed) == 0) continue;
+					int64_t waited = now - m_levels[i]->lastDispatchTime.load(std::memory_order_relaxed);
+					if (waited >= longestWait) {
+						longestWait = waited;
+						selected = i;
+					}
+				}
+				if (selected < levelCount) return selected;
+				for (size_t i = 0; i < levelCount; ++i)
+					if (m_levels[i]->depth.load(std::memory_order_relaxed) > 0) return i;
+				return levelCount;
+			}
+
+			for (int round = 0; round < 2; ++round) {
+				for (size_t i = 0; i < levelCount; ++i)
+					if (worker.credits[i] > 0 && m_levels[i]->depth.load(std::memory_order_relaxed) > 0) return i;
+				// Every waiting level used up its share of this round
+				for (size_t i = 0; i < levelCount; ++i) worker.credits[i] = m_levels[i]->weight;
+			}
+			return levelCount;
+		}
+
+		// Pops up to maxCount tasks, all from one level, limited to the calling worker's fair share of that level
+		size_t popLevel(size_t priority, Worker& worker, QueuedTask** tasks, size_t maxCount) {
+			Level& level = *m_levels[priority];
+			size_t depth = level.depth.load(std::memory_order_relaxed);
+			if (depth == 0) return 0;
+
+			size_t threadCount = std::max<size_t>(m_threadAmountToRun.load(std::memory_order_relaxed), 1);
+			size_t limit = std::min(maxCount, (depth + threadCount - 1) / threadCount);
+			if (m_dispatchPolicy == DispatchPolicy::Weighted && worker.credits[priority] > 0)
+				limit = std::min<size_t>(limit, worker.credits[priority]);
+
+			size_t count = 0;
+			int64_t now = 0;
+			Level::Entry entry;
+			while (count < limit && popEntry(level, entry)) {
+				if (count == 0) now = timestamp();
+				uint64_t waited = static_cast<uint64_t>(std::max<int64_t>(now - entry.enqueueTime, 0));
+				level.totalWaitTime.fetch_add(waited, std::memory_order_relaxed);
+				uint64_t maxWait = level.maxWaitTime.load(std::memory_order_relaxed);
+				while (waited > maxWait && !level.maxWaitTime.compare_exchange_weak(maxWait, waited, std::memory_order_relaxed)) {}
+				tasks[count++] = entry.task;
+			}
+			if (count == 0) return 0;
+
+			level.depth.fetch_sub(count, std::memory_order_relaxed);
+			m_queuedTaskCount.fetch_sub(count, std::memory_order_relaxed);
+			level.dispatchedCount.fetch_add(count, std::memory_order_relaxed);
+			level.lastDispatchTime.store(now, std::memory_order_relaxed);
+			worker.credits[priority] -= static_cast<uint32_t>(std::min<size_t>(worker.credits[priority], count));
+			return count;
+		}
+
+		// Takes up to maxCount queued tasks from the level chosen by the dispatch policy
+		size_t dispatchTasks(Worker& worker, QueuedTask** tasks, size_t maxCount) {
+			if (m_queuedTaskCount.load(std::memory_order_relaxed) == 0) return 0;
+			size_t selected = selectLevel(worker);
+			if (selected < m_levels.size()) {
+				if (size_t count = popLevel(selected, worker, tasks, maxCount)) return count;
+			}
+			// The chosen level was emptied by someone else meanwhile, take the most urgent task there is
+			for (size_t i = 0; i < m_levels.size(); ++i)
+				if (size_t count = popLevel(i, worker, tasks, maxCount)) return count;
+			return 0;
+		}
+
+		// Destroys tasks that were counted as pending but could not be queued
+		void discardTasks(QueuedTask* const* tasks, size_t count, Lock& lock) {
+			if (count == 0) return;
+			for (size_t i = 0; i < count; ++i) m_taskSlots.destroy(tasks[i]);
+			if (m_pendingTaskCount.fetch_sub(count) != count) return;
+			Lock notifyLock;
+			if (!lock.isLocked()) notifyLock = this->lock();
+			m_taskFinished.notify_all();
+		}
+
+		// Called by a work-stealing worker for tasks it submits itself, the caller wakes workers
+		void pushLocalTask(QueuedTask* task) {
+			++m_pendingTaskCount;
+			m_workers[t_currentThreadIndex]->tasks.push(task);
+		}
+
+		// Wakes up to count parked workers for tasks that were just queued. Spinning workers find
+		// them without a notify, so they are subtracted first. The lock may or may not be owned.
+		void wakeWorkers(size_t count, Lock& lock) {
+			// Pairs with the fence in hasQueuedWork, either we see the worker or it sees the tasks
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			size_t spinning = m_spinningThreadCount.load(std::memory_order_relaxed);
+			if (count <= spinning) return;
+			count -= spinning;
+
+			size_t sleeping = m_sleepingThreadCount.load(std::memory_order_relaxed);
+			if (sleeping == 0) return;
+			Lock wakeLock;
+			if (!lock.isLocked()) wakeLock = this->lock();
+			if (count >= sleeping) m_threadWakeUp.notify_all();
+			else for (size_t i = 0; i < count; ++i) m_threadWakeUp.notify_one();
+		}
+
+		static inline void cpuRelax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+			_mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#elif defined(__aarch64__)
+			asm volatile("yield");
 #endif
-					*m_errorStream << e.what() << std::endl;
+		}
+
+		// WakeupPolicy::SpinThenPark, polls for a task before the worker parks. A push that saw this
+		// worker spinning did not notify anyone, so if work is left once a task was found the next
+		// parked worker is woken, the last spinner passes the wake-up on.
+		template<typename FindTask>
+		bool spinForTask(size_t threadIndex, Worker& worker, FindTask&& findTask) {
+			if (m_wakeupPolicy != WakeupPolicy::SpinThenPark) return false;
+			setThreadState(worker, ThreadState::Spinning, 0);
+			m_spinningThreadCount.fetch_add(1);
+
+			bool found = false;
+			for (uint32_t i = 0; i < m_spinCount + m_yieldCount; ++i) {
+				if (m_threadAmountToRun.load(std::memory_order_relaxed) <= threadIndex) break;
+				if ((found = findTask())) break;
+				if (i < m_spinCount) cpuRelax();
+				else std::this_thread::yield();
+			}
+
+			if (m_spinningThreadCount.fetch_sub(1) == 1 && found && hasQueuedWork()) {
+				Lock lock;
+				wakeWorkers(1, lock);
+			}
+			return found;
+		}
+
+		// Lock-free, m_workers is only resized while no worker threads run
+		bool hasQueuedWork() const {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_queuedTaskCount.load(std::memory_order_relaxed) > 0) return true;
+			for (const auto& worker : m_workers)
+				if (!worker->tasks.empty()) return true;
+			return false;
+		}
+
+		bool findTask(size_t threadIndex, QueuedTask*& task) {
+			Worker& worker = *m_workers[threadIndex];
+			if (worker.tasks.pop(task)) return true;
+			if (m_queuedTaskCount.load(std::memory_order_relaxed) > 0 && takeQueuedTasks(threadIndex, task)) return true;
+			return stealTask(threadIndex, task);
+		}
+
+		// Moves a fair share of one priority level into the worker's deque, where other workers can steal it
+		bool takeQueuedTasks(size_t threadIndex, QueuedTask*& task) {
+			Worker& worker = *m_workers[threadIndex];
+			std::array<QueuedTask*, s_maxInjectionBatch> batch;
+			size_t count = dispatchTasks(worker, batch.data(), batch.size());
+			if (count == 0) return false;
+
+			// Pushed in reverse so the owner pops them in submission order
+			for (size_t i = count - 1; i > 0; --i) worker.tasks.push(batch[i]);
+			task = batch[0];
+			if (count == 1) return true;
+
+			// Someone else can steal the rest
+			Lock lock;
+			wakeWorkers(1, lock);
+			return true;
+		}
+
+		bool stealTask(size_t threadIndex, QueuedTask*& task) {
+			size_t workerCount = m_workers.size();
+			if (workerCount < 2) return false;
+
+			size_t start = static_cast<size_t>(m_workers[threadIndex]->nextRandom() % workerCount);
+			for (size_t i = 0; i < workerCount; ++i) {
+				size_t victim = (start + i) % workerCount;
+				if (victim == threadIndex) continue;
+				if (m_workers[victim]->tasks.steal(task)) return true;
+			}
+			return false;
+		}
+
+		void runTask(size_t threadIndex, QueuedTask* task) {
+			Worker& worker = *m_workers[threadIndex];
+			const bool diagnostics = m_diagnosticsEnabled.load(std::memory_order_relaxed);
+			++m_workingThreadCount;
+			if (diagnostics) worker.taskStartTime.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+			setThreadState(worker, ThreadState::Working, 0);
+			try {
+				(*task)(threadIndex);
+			} catch(const std::exception& e) {
+				setThreadState(worker, ThreadState::CatchingError, reinterpret_cast<uintptr_t>(&m_taskMutex));
+				if (diagnostics) {
+					m_errors.record(threadIndex, e.what());
+					worker.errorCount.fetch_add(1, std::memory_order_relaxed);
 				}
-				--m_workingThreadCount;
+				auto lock = this->lock();
+				*m_errorStream << e.what() << std::endl;
+			}
+			m_taskSlots.destroy(task);
+			if (diagnostics) worker.completedTaskCount.fetch_add(1, std::memory_order_relaxed);
+
+			bool notify = m_workingThreadCount.fetch_sub(1) == 1;
+			notify = m_pendingTaskCount.fetch_sub(1) == 1 || notify;
+			if (notify) {
+				auto lock = this->lock();
 				m_taskFinished.notify_all();
 			}
+		}
+
+		inline uint64_t toTimerTick(std::chrono::steady_clock::time_point time) const {
+			if (time <= m_timerEpoch) return 0;
+			return static_cast<uint64_t>(std::chrono::ceil<std::chrono::milliseconds>(time - m_timerEpoch) / s_timerResolution);
+		}
+
+		inline std::chrono::steady_clock::time_point toTimerTime(uint64_t tick) const {
+			return m_timerEpoch + s_timerResolution * static_cast<int64_t>(std::min<uint64_t>(tick, INT64_MAX / 1000000));
+		}
+
+		TimerHandle addTimer(uint64_t deadline, TimerEntry&& entry) {
+			std::lock_guard<std::mutex> lock(m_timerMutex);
+			if (!m_timerThread.joinable()) m_timerThread = std::thread([this]() { timerLoop(); });
+			TimerHandle handle(m_timers.insert(deadline, std::move(entry)));
+			if (deadline < m_timerWakeTick) m_timerWakeUp.notify_one();
+			return handle;
+		}
+
+		void stopTimers() {
+			{
+				std::lock_guard<std::mutex> lock(m_timerMutex);
+				if (!m_timerThread.joinable()) return;
+				m_stopTimers = true;
+			}
+			m_timerWakeUp.notify_one();
+			m_timerThread.join();
+			m_timers.clear([this](TimerEntry&& entry) {
+				if (entry.task) m_taskSlots.destroy(entry.task);
+				});
+		}
+
+		// Requires m_timerMutex, collects the task into m_dueTimerTasks and returns the next deadline of periodic timers.
+		// Never throws, a failure is kept in m_timerError: a one-shot timer tries again on the next tick,
+		// a periodic one skips this firing.
+		std::optional<uint64_t> fireTimer(TimerEntry& entry) {
+			if (entry.task) {
+				try {
+					m_dueTimerTasks.emplace_back(entry.task, entry.priority);
+				} catch (...) {
+					m_timerError = std::current_exception();
+					return m_timers.now() + 1;
+				}
+				entry.task = nullptr;
+				return std::nullopt;
+			}
+			if (!entry.periodic->queued.exchange(true, std::memory_order_acquire)) {
+				QueuedTask* task = nullptr;
+				try {
+					task = m_taskSlots.create(PeriodicRun(entry.periodic));
+					m_dueTimerTasks.emplace_back(task, entry.priority);
+				} catch (...) {
+					// Whichever PeriodicRun still holds the timer clears its queued flag
+					m_taskSlots.destroy(task);
+					m_timerError = std::current_exception();
+				}
+			}
+			return m_timers.now() + entry.period;
+		}
+
+		// Reported without m_timerMutex, which is never held while taking the submission lock.
+		// Timers keep firing after destroy, the error then has no stream to go to.
+		void reportTimerError(std::unique_lock<std::mutex>& timerLock) {
+			std::exception_ptr error = std::exchange(m_timerError, nullptr);
+			timerLock.unlock();
+			try {
+				std::rethrow_exception(error);
+			} catch (const std::exception& e) {
+				auto lock = this->lock();
+				if (m_errorStream) *m_errorStream << "Timer: " << e.what() << std::endl;
+			} catch (...) {
+				auto lock = this->lock();
+				if (m_errorStream) *m_errorStream << "Timer: unknown error" << std::endl;
+			}
+			timerLock.lock();
+		}
+
+		void timerLoop() {
+			std::unique_lock<std::mutex> timerLock(m_timerMutex);
+			while (!m_stopTimers) {
+				uint64_t now = static_cast<uint64_t>((std::chrono::steady_clock::now() - m_timerEpoch) / s_timerResolution);
+				m_timers.advance(now, [this](TimerEntry& entry) { return fireTimer(entry); });
+				if (m_timerError) reportTimerError(timerLock);
+
+				if (!m_dueTimerTasks.empty()) {
+					// Queued without m_timerMutex, so cancelTimer and scheduling never wait for the submission lock
+					timerLock.unlock();
+					{
+						auto lock = this->lock();
+						m_pendingTaskCount += m_dueTimerTasks.size();
+						for (auto [task, priority] : m_dueTimerTasks) enqueueTask(std::min(priority, m_levels.size() - 1), task);
+						wakeWorkers(m_dueTimerTasks.size(), lock);
+					}
+					m_dueTimerTasks.clear();
+					timerLock.lock();
+					continue;
+				}
+
+				std::optional<uint64_t> next = m_timers.nextEventTick();
+				m_timerWakeTick = next ? *next : UINT64_MAX;
+				if (next) m_timerWakeUp.wait_until(timerLock, toTimerTime(*next));
+				else m_timerWakeUp.wait(timerLock);
+				m_timerWakeTick = UINT64_MAX;
+			}
+		}
+
+		// Called by every worker on itself before it runs tasks
+		void applyThreadOptions(size_t threadIndex) {
+			try {
+				if (!m_threadName.empty()) Platform::Thread::setCurrentName(m_threadName + " " + std::to_string(threadIndex));
+				if (!m_workerCpus.empty()) {
+					size_t slot = threadIndex % m_workerCpus.size();
+					Platform::Thread::setCurrentAffinity(std::span<const size_t>(&m_workerCpus[slot], 1));
+					if (m_numaLocalMemory) Platform::Thread::setCurrentPreferredNumaNode(m_workerNumaNodes[slot]);
+				}
+				if (m_threadPriority != Platform::ThreadPriority::Normal) Platform::Thread::setCurrentPriority(m_threadPriority);
+			} catch (const std::exception& e) {
+				auto lock = this->lock();
+				*m_errorStream << "Worker " << threadIndex << " placement: " << e.what() << std::endl;
+			}
+		}
+
+		// Owning thread only
+		static inline void setThreadState(Worker& worker, ThreadState state, uintptr_t waitingOn) {
+			worker.waitingOn.store(waitingOn, std::memory_order_relaxed);
+			worker.state.store(state, std::memory_order_relaxed);
+		}
+
+		void stealingThreadLoop(size_t threadIndex) {
+			t_currentPool = this;
+			t_currentThreadIndex = threadIndex;
+			applyThreadOptions(threadIndex);
+
+			Worker& worker = *m_workers[threadIndex];
+			while (m_threadAmountToRun.load(std::memory_order_relaxed) > threadIndex) {
+				QueuedTask* task = nullptr;
+				if (findTask(threadIndex, task) ||
+					spinForTask(threadIndex, worker, [&](){ return findTask(threadIndex, task); })) {
+					runTask(threadIndex, task);
+					continue;
+				}
+
+				setThreadState(worker, ThreadState::Waiting, reinterpret_cast<uintptr_t>(&m_taskMutex));
+				auto lock = this->lock();
+				m_sleepingThreadCount.fetch_add(1);
+				m_threadWakeUp.wait(lock, [&](){ return hasQueuedWork() || m_threadAmountToRun <= threadIndex; });
+				m_sleepingThreadCount.fetch_sub(1);
+			}
+
+			auto lock = this->lock();
+			// Hand whatever is left in this worker's deque back to the default priority level
+			QueuedTask* task = nullptr;
+			bool handedBack = false;
+			while (worker.tasks.steal(task)) {
+				enqueueTask(m_defaultPriority, task);
+				handedBack = true;
+			}
+			if (handedBack) m_threadWakeUp.notify_all();
+
 			--m_activeThreadCount;
-#ifndef NODEBUG
-			threadInfoMutex.lock();
-			threadInfo.state = ThreadState::Inactive;
-			threadInfoMutex.unlock();
-#endif
+			setThreadState(worker, ThreadState::Inactive, 0);
+			t_currentPool = nullptr;
+			m_threadExited.notify_all();
+		}
+
+		// Global queue mode, workers pop from the priority levels lock-free and only take
+		// the submission lock to go to sleep
+		void threadLoop(size_t threadIndex) {
+			t_currentPool = this;
+			t_currentThreadIndex = threadIndex;
+			applyThreadOptions(threadIndex);
+
+			Worker& worker = *m_workers[threadIndex];
+			while (m_threadAmountToRun.load(std::memory_order_relaxed) > threadIndex) {
+				QueuedTask* task = nullptr;
+				if (dispatchTasks(worker, &task, 1) ||
+					spinForTask(threadIndex, worker, [&](){ return dispatchTasks(worker, &task, 1) > 0; })) {
+					runTask(threadIndex, task);
+					continue;
+				}
+
+				setThreadState(worker, ThreadState::Waiting, reinterpret_cast<uintptr_t>(&m_taskMutex));
+				auto lock = this->lock();
+				m_sleepingThreadCount.fetch_add(1);
+				m_threadWakeUp.wait(lock, [&](){
+					return hasQueuedWork() || m_threadAmountToRun <= threadIndex;
+					});
+				m_sleepingThreadCount.fetch_sub(1);
+			}
+
+			auto lock = this->lock();
+			--m_activeThreadCount;
+			setThreadState(worker, ThreadState::Inactive, 0);
+			t_currentPool = nullptr;
 			m_threadExited.notify_all();
 		}
 	};
 }
 
+#include "Future.h"
+
+#endif //MINIMAL_THREAD_POOL_H
+
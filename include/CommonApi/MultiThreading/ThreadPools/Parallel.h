@@ -0,0 +1,197 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+#include "CommonApi/MultiThreading/ThreadPools/MinimalThreadPool.h"
+#include "CommonApi/MultiThreading/ThreadPools/TaskLatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fork-join loops on top of MinimalThreadPool.
+// Ranges are split lazily: a task keeps halving its remaining range and handing the upper half
+// to the pool only while the pool has spare capacity (MinimalThreadPool::hasSpareCapacity),
+// so splits follow actual demand from idle workers and the grain size rarely needs tuning.
+// The first exception thrown by the loop body is rethrown to the caller once every task finished.
+// Called from outside the pool the loop runs on the workers only, so threadIndex is always a worker index.
+namespace MultiThreading
+{
+	namespace detail
+	{
+		// Shared by every task of one loop, lives on the calling thread's stack
+		template<typename Body>
+		struct ParallelLoop
+		{
+			MinimalThreadPool& pool;
+			Body& body;
+			size_t grain;
+			TaskLatch latch{ 1 };
+			std::atomic<bool> failed = false;
+			std::exception_ptr exception;
+
+			ParallelLoop(MinimalThreadPool& pool, Body& body, size_t grain) :
+				pool(pool), body(body), grain(grain) {}
+
+			// Never throws, if handing a half to the pool fails this task keeps the whole range
+			void run(size_t begin, size_t end, size_t threadIndex) {
+				bool split = true;
+				while (begin < end) {
+					while (split && end - begin > grain && pool.hasSpareCapacity()) {
+						size_t middle = begin + (end - begin) / 2;
+						latch.countUp();
+						try {
+							pool.postTask([this, middle, end](size_t threadIndex) { run(middle, end, threadIndex); });
+							end = middle;
+						}
+						catch (...) {
+							latch.countDown();
+							split = false;
+						}
+					}
+
+					size_t chunkEnd = std::min(end, begin + grain);
+					if (!failed.load(std::memory_order_relaxed)) {
+						try {
+							body(begin, chunkEnd, threadIndex);
+						}
+						catch (...) {
+							if (!failed.exchange(true)) exception = std::current_exception();
+						}
+					}
+					begin = chunkEnd;
+				}
+				latch.countDown();
+			}
+		};
+
+		// body(chunkBegin, chunkEnd, threadIndex) processes a contiguous part of [begin, end)
+		template<typename Body>
+		void runParallelLoop(MinimalThreadPool& pool, size_t begin, size_t end, size_t grain, Body& body) {
+			if (begin >= end) return;
+			// Without workers nothing would ever count the latch down
+			if (!pool.isWorkerThread() && pool.getThreadCount() == 0) throw std::runtime_error("Thread pool not initialized");
+			ParallelLoop<Body> loop(pool, body, std::max<size_t>(grain, 1));
+
+			if (pool.isWorkerThread()) loop.run(begin, end, pool.getCurrentThreadIndex());
+			else {
+				// Nothing was queued if this throws, so nothing refers to loop any more
+				try {
+					pool.postTask([&loop, begin, end](size_t threadIndex) { loop.run(begin, end, threadIndex); });
+				}
+				catch (...) {
+					loop.latch.countDown();
+					throw;
+				}
+			}
+
+			loop.latch.wait(pool);
+			if (loop.exception) std::rethrow_exception(loop.exception);
+		}
+
+		// Small enough for lazy splitting to balance uneven work, large enough to amortize the split checks
+		inline size_t defaultGrain(const MinimalThreadPool& pool, size_t count) {
+			size_t threads = std::max<size_t>(pool.getThreadCount(), 1);
+			return std::max<size_t>(count / (threads * 64), 1);
+		}
+	}
+
+	// Calls function(i, threadIndex) for every i in [begin, end)
+	template<typename Function>
+	void parallelFor(MinimalThreadPool& pool, size_t begin, size_t end, size_t grain, Function&& function) {
+		auto body = [&function](size_t chunkBegin, size_t chunkEnd, size_t threadIndex) {
+			for (size_t i = chunkBegin; i < chunkEnd; ++i) function(i, threadIndex);
+		};
+		detail::runParallelLoop(pool, begin, end, grain, body);
+	}
+
+	template<typename Function>
+	void parallelFor(MinimalThreadPool& pool, size_t begin, size_t end, Function&& function) {
+		parallelFor(pool, begin, end, detail::defaultGrain(pool, end > begin ? end - begin : 0), std::forward<Function>(function));
+	}
+
+	// Calls function(x, y, threadIndex) for every cell of a sizeX * sizeY grid.
+	// y is the fastest moving coordinate, chunks are contiguous in row-major storage.
+	template<typename Function>
+	void parallelFor2d(MinimalThreadPool& pool, size_t sizeX, size_t sizeY, size_t grain, Function&& function) {
+		if (sizeY == 0) return;
+		auto body = [&function, sizeY](size_t chunkBegin, size_t chunkEnd, size_t threadIndex) {
+			size_t x = chunkBegin / sizeY;
+			size_t y = chunkBegin % sizeY;
+			for (size_t i = chunkBegin; i < chunkEnd; ++i) {
+				function(x, y, threadIndex);
+				if (++y == sizeY) {
+					y = 0;
+					++x;
+				}
+			}
+		};
+		detail::runParallelLoop(pool, 0, sizeX * sizeY, grain, body);
+	}
+
+	template<typename Function>
+	void parallelFor2d(MinimalThreadPool& pool, size_t sizeX, size_t sizeY, Function&& function) {
+		parallelFor2d(pool, sizeX, sizeY, detail::defaultGrain(pool, sizeX * sizeY), std::forward<Function>(function));
+	}
+
+	// Calls function(x, y, z, threadIndex) for every cell of a sizeX * sizeY * sizeZ volume.
+	// z is the fastest moving coordinate, matching Utilities::Vector3d's layout; for
+	// Utilities::ArrayNd, whose first index moves fastest, pass the dimensions reversed.
+	template<typename Function>
+	void parallelFor3d(MinimalThreadPool& pool, size_t sizeX, size_t sizeY, size_t sizeZ, size_t grain, Function&& function) {
+		if (sizeY == 0 || sizeZ == 0) return;
+		auto body = [&function, sizeY, sizeZ](size_t chunkBegin, size_t chunkEnd, size_t threadIndex) {
+			size_t z = chunkBegin % sizeZ;
+			size_t y = (chunkBegin / sizeZ) % sizeY;
+			size_t x = chunkBegin / (sizeY * sizeZ);
+			for (size_t i = chunkBegin; i < chunkEnd; ++i) {
+				function(x, y, z, threadIndex);
+				if (++z == sizeZ) {
+					z = 0;
+					if (++y == sizeY) {
+						y = 0;
+						++x;
+					}
+				}
+			}
+		};
+		detail::runParallelLoop(pool, 0, sizeX * sizeY * sizeZ, grain, body);
+	}
+
+	template<typename Function>
+	void parallelFor3d(MinimalThreadPool& pool, size_t sizeX, size_t sizeY, size_t sizeZ, Function&& function) {
+		parallelFor3d(pool, sizeX, sizeY, sizeZ, detail::defaultGrain(pool, sizeX * sizeY * sizeZ), std::forward<Function>(function));
+	}
+
+	// Combines transform(i, threadIndex) for every i in [begin, end) into one value.
+	// Partial results are kept per worker thread, so combine must be associative and commutative
+	// and identity must be its neutral element.
+	template<typename T, typename Transform, typename Combine>
+	T parallelReduce(MinimalThreadPool& pool, size_t begin, size_t end, size_t grain,
+		T identity, Transform&& transform, Combine&& combine) {
+		struct alignas(64) Partial {
+			T value;
+		};
+		std::vector<Partial> partials(std::max<size_t>(pool.getThreadCount(), 1), Partial{ identity });
+
+		auto body = [&](size_t chunkBegin, size_t chunkEnd, size_t threadIndex) {
+			T value = identity;
+			for (size_t i = chunkBegin; i < chunkEnd; ++i) value = combine(std::move(value), transform(i, threadIndex));
+			partials[threadIndex].value = combine(std::move(partials[threadIndex].value), std::move(value));
+		};
+		detail::runParallelLoop(pool, begin, end, grain, body);
+
+		T result = std::move(identity);
+		for (auto& partial : partials) result = combine(std::move(result), std::move(partial.value));
+		return result;
+	}
+
+	template<typename T, typename Transform, typename Combine>
+	T parallelReduce(MinimalThreadPool& pool, size_t begin, size_t end,
+		T identity, Transform&& transform, Combine&& combine) {
+		return parallelReduce(pool, begin, end, detail::defaultGrain(pool, end > begin ? end - begin : 0),
+			std::move(identity), std::forward<Transform>(transform), std::forward<Combine>(combine));
+	}
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace MultiThreading
+{
+	// Thread-safe pool of preallocated object slots with stable addresses.
+	// Free slots form a Treiber stack of 32 bit slot indices tagged with a 32 bit
+	// version to rule out ABA, so create/destroy are lock-free and never allocate
+	// unless every slot is in use. Slots live in geometrically growing blocks
+	// (block k holds s_baseBlockSize << k slots) that are only freed by the destructor.
+	template<typename T>
+	class SlotPool
+	{
+	private:
+		static constexpr size_t s_baseBlockSize = 64;
+		static constexpr size_t s_maxBlocks = 26;		// just below 2^32 slots in total
+		static constexpr uint32_t s_nullIndex = UINT32_MAX;
+
+		struct Slot {
+			alignas(T) unsigned char storage[sizeof(T)];
+			std::atomic<uint32_t> next;
+			uint32_t index;
+		};
+
+		std::array<std::atomic<Slot*>, s_maxBlocks> m_blocks{};
+		std::atomic<uint64_t> m_freeHead = pack(s_nullIndex, 0);
+		std::atomic<size_t> m_capacity = 0;
+		std::mutex m_growMutex;
+
+		static constexpr uint64_t pack(uint32_t index, uint32_t tag) { return (static_cast<uint64_t>(tag) << 32) | index; }
+		static constexpr uint32_t indexOf(uint64_t head) { return static_cast<uint32_t>(head); }
+		static constexpr uint32_t tagOf(uint64_t head) { return static_cast<uint32_t>(head >> 32); }
+
+		static constexpr size_t blockSize(size_t block) { return s_baseBlockSize << block; }
+		static constexpr size_t blockStart(size_t block) { return s_baseBlockSize * ((size_t(1) << block) - 1); }
+
+		inline Slot& slotAt(uint32_t index) const {
+			size_t block = std::bit_width(index / s_baseBlockSize + 1) - 1;
+			return m_blocks[block].load(std::memory_order_acquire)[index - blockStart(block)];
+		}
+
+		static inline Slot* slotOf(T* object) {
+			return reinterpret_cast<Slot*>(reinterpret_cast<unsigned char*>(object) - offsetof(Slot, storage));
+		}
+
+		// Pushes the chain first..last, already linked through next, in one CAS
+		void pushChain(Slot& first, Slot& last) {
+			uint64_t head = m_freeHead.load(std::memory_order_relaxed);
+			do {
+				last.next.store(indexOf(head), std::memory_order_relaxed);
+			} while (!m_freeHead.compare_exchange_weak(head, pack(first.index, tagOf(head) + 1),
+				std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		Slot* popSlot() {
+			uint64_t head = m_freeHead.load(std::memory_order_acquire);
+			while (indexOf(head) != s_nullIndex) {
+				Slot& slot = slotAt(indexOf(head));
+				uint32_t next = slot.next.load(std::memory_order_relaxed);
+				if (m_freeHead.compare_exchange_weak(head, pack(next, tagOf(head) + 1),
+					std::memory_order_acquire, std::memory_order_acquire))
+					return &slot;
+			}
+			return nullptr;
+		}
+
+		// Requires m_growMutex, the new slots come back linked in index order
+		Slot* addBlock(size_t& size) {
+			size_t block = 0;
+			while (block < s_maxBlocks && m_blocks[block].load(std::memory_order_relaxed)) ++block;
+			if (block == s_maxBlocks) throw std::bad_alloc();
+
+			size = blockSize(block);
+			Slot* slots = static_cast<Slot*>(::operator new(sizeof(Slot) * size, std::align_val_t(alignof(Slot))));
+			uint32_t start = static_cast<uint32_t>(blockStart(block));
+			for (size_t i = 0; i < size; ++i) {
+				Slot* slot = new (&slots[i]) Slot;
+				slot->next.store(i + 1 < size ? static_cast<uint32_t>(start + i + 1) : s_nullIndex, std::memory_order_relaxed);
+				slot->index = static_cast<uint32_t>(start + i);
+			}
+			m_blocks[block].store(slots, std::memory_order_release);
+			m_capacity.fetch_add(size, std::memory_order_relaxed);
+			return slots;
+		}
+
+		// Adds one block and returns one of its slots, the rest go to the free list
+		Slot* grow() {
+			std::lock_guard<std::mutex> lock(m_growMutex);
+			if (Slot* slot = popSlot()) return slot;	// someone else grew the pool meanwhile
+
+			size_t size = 0;
+			Slot* slots = addBlock(size);
+			if (size > 1) pushChain(slots[1], slots[size - 1]);
+			return &slots[0];
+		}
+
+		inline Slot* acquireSlot() {
+			Slot* slot = popSlot();
+			return slot ? slot : grow();
+		}
+
+		inline void releaseSlot(Slot* slot) {
+			pushChain(*slot, *slot);
+		}
+
+	public:
+		SlotPool() = default;
+		explicit SlotPool(size_t capacity) { reserve(capacity); }
+
+		SlotPool(const SlotPool&) = delete;
+		SlotPool& operator=(const SlotPool&) = delete;
+		SlotPool(SlotPool&&) = delete;
+		SlotPool& operator=(SlotPool&&) = delete;
+
+		// Every object must have been destroyed by now
+		~SlotPool() {
+			for (auto& block : m_blocks) {
+				Slot* slots = block.load(std::memory_order_relaxed);
+				if (slots) ::operator delete(slots, std::align_val_t(alignof(Slot)));
+			}
+		}
+
+		// Preallocates slots so that at least capacity objects can live at once without allocating
+		void reserve(size_t capacity) {
+			std::lock_guard<std::mutex> lock(m_growMutex);
+			while (m_capacity.load(std::memory_order_relaxed) < capacity) {
+				size_t size = 0;
+				Slot* slots = addBlock(size);
+				pushChain(slots[0], slots[size - 1]);
+			}
+		}
+
+		template<typename... Args>
+		T* create(Args&&... args) {
+			Slot* slot = acquireSlot();
+			try {
+				return new (slot->storage) T(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				releaseSlot(slot);
+				throw;
+			}
+		}
+
+		void destroy(T* object) noexcept {
+			if (!object) return;
+			object->~T();
+			releaseSlot(slotOf(object));
+		}
+
+		size_t capacity() const { return m_capacity.load(std::memory_order_relaxed); }
+	};
+}
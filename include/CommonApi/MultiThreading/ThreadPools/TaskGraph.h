@@ -0,0 +1,171 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+#include "CommonApi/MultiThreading/ThreadPools/MinimalThreadPool.h"
+#include "CommonApi/MultiThreading/ThreadPools/TaskLatch.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace MultiThreading
+{
+	// Dependency graph of tasks run on a MinimalThreadPool.
+	// Every node counts its unfinished predecessors, the node finishing last pushes it to the pool,
+	// so independent branches overlap instead of meeting at pool-wide waitIdle barriers.
+	// The graph is built once and can be run any number of times, for example once per frame,
+	// without allocating: node tasks, edges and counters are reused and the pool's task slots are pooled.
+	// A graph must not be run again or modified while a run is in progress.
+	class TaskGraph
+	{
+	public:
+		using NodeId = uint32_t;
+
+	private:
+		struct Node {
+			InplaceTask<> task;
+			std::vector<NodeId> successors;
+			uint32_t predecessorCount = 0;
+			std::atomic<uint32_t> pendingPredecessors = 0;
+
+			template<typename Task>
+			explicit Node(Task&& task) : task(std::forward<Task>(task)) {}
+		};
+
+		std::deque<Node> m_nodes;		// stable addresses, Node holds an atomic
+		std::vector<NodeId> m_roots;
+		bool m_isValidated = false;
+
+		MinimalThreadPool* m_pool = nullptr;
+		TaskLatch m_latch;
+		std::atomic<bool> m_failed = false;
+		std::exception_ptr m_exception;
+
+	public:
+		TaskGraph() = default;
+
+		TaskGraph(const TaskGraph&) = delete;
+		TaskGraph& operator=(const TaskGraph&) = delete;
+		TaskGraph(TaskGraph&&) = delete;
+		TaskGraph& operator=(TaskGraph&&) = delete;
+
+		// task is callable as void() or void(size_t threadIndex) and is invoked once per run
+		template<typename Task>
+		NodeId addNode(Task&& task) {
+			if (m_nodes.size() >= UINT32_MAX) throw std::length_error("Too many task graph nodes");
+			m_nodes.emplace_back(std::forward<Task>(task));
+			m_isValidated = false;
+			return static_cast<NodeId>(m_nodes.size() - 1);
+		}
+
+		// after starts only once before has finished
+		void addDependency(NodeId before, NodeId after) {
+			if (before >= m_nodes.size() || after >= m_nodes.size())
+				throw std::out_of_range("Task graph node does not exist");
+			m_nodes[before].successors.push_back(after);
+			++m_nodes[after].predecessorCount;
+			m_isValidated = false;
+		}
+
+		void clear() {
+			m_nodes.clear();
+			m_roots.clear();
+			m_isValidated = false;
+		}
+
+		inline size_t size() const { return m_nodes.size(); }
+
+		// Runs every node and returns when all have finished. The first exception thrown by a node,
+		// or by the pool when it cannot take one, is rethrown here and the nodes not started yet are
+		// skipped. Called from a worker of pool, the calling thread runs ready nodes while it waits.
+		void run(MinimalThreadPool& pool) {
+			if (m_nodes.empty()) return;
+			if (!pool.isWorkerThread() && pool.getThreadCount() == 0) throw std::runtime_error("Thread pool not initialized");
+			if (!m_isValidated) validate();
+
+			m_pool = &pool;
+			m_failed.store(false, std::memory_order_relaxed);
+			m_exception = nullptr;
+			for (auto& node : m_nodes)
+				node.pendingPredecessors.store(node.predecessorCount, std::memory_order_relaxed);
+			m_latch.reset(m_nodes.size());
+
+			size_t threadIndex = pool.isWorkerThread() ? pool.getCurrentThreadIndex() : 0;
+			for (NodeId root : m_roots) pushNode(root, threadIndex);
+
+			m_latch.wait(pool);
+			if (m_exception) std::rethrow_exception(m_exception);
+		}
+
+	private:
+		// Never throws. If the pool cannot take the node the run fails and the node is finished on this
+		// thread with its task skipped, so its own and its successors' latch counts are still released.
+		void pushNode(NodeId id, size_t threadIndex) {
+			try {
+				m_pool->postTask([this, id](size_t threadIndex) { runNode(id, threadIndex); });
+			}
+			catch (...) {
+				if (!m_failed.exchange(true)) m_exception = std::current_exception();
+				runNode(id, threadIndex);
+			}
+		}
+
+		// Runs id and then keeps going with one of the successors it made ready, pushing the others,
+		// so a chain of nodes stays on one thread without a round trip through the pool
+		void runNode(NodeId id, size_t threadIndex) {
+			while (true) {
+				Node& node = m_nodes[id];
+				if (!m_failed.load(std::memory_order_relaxed)) {
+					try {
+						node.task(threadIndex);
+					}
+					catch (...) {
+						if (!m_failed.exchange(true)) m_exception = std::current_exception();
+					}
+				}
+
+				NodeId next = UINT32_MAX;
+				for (NodeId successor : node.successors) {
+					if (m_nodes[successor].pendingPredecessors.fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+					if (next != UINT32_MAX) pushNode(next, threadIndex);
+					next = successor;
+				}
+
+				m_latch.countDown();
+				if (next == UINT32_MAX) return;
+				id = next;
+			}
+		}
+
+		// Collects the roots and rejects cycles, which would leave run waiting forever
+		void validate() {
+			m_roots.clear();
+			std::vector<uint32_t> remaining(m_nodes.size());
+			std::vector<NodeId> ready;
+			ready.reserve(m_nodes.size());
+
+			for (NodeId id = 0; id < m_nodes.size(); ++id) {
+				remaining[id] = m_nodes[id].predecessorCount;
+				if (remaining[id] == 0) {
+					m_roots.push_back(id);
+					ready.push_back(id);
+				}
+			}
+
+			size_t visited = 0;
+			while (!ready.empty()) {
+				NodeId id = ready.back();
+				ready.pop_back();
+				++visited;
+				for (NodeId successor : m_nodes[id].successors)
+					if (--remaining[successor] == 0) ready.push_back(successor);
+			}
+
+			if (visited != m_nodes.size()) throw std::logic_error("Task graph contains a cycle");
+			m_isValidated = true;
+		}
+	};
+}
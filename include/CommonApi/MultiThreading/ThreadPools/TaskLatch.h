@@ -0,0 +1,68 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+#include "CommonApi/MultiThreading/ThreadPools/MinimalThreadPool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace MultiThreading
+{
+	// Countdown latch for fork-join helpers built on MinimalThreadPool.
+	// Unlike std::latch it may be destroyed as soon as wait returns, even while the
+	// thread that released it is still inside countDown, and it can be counted up again.
+	// Waiting from one of the pool's workers runs queued tasks instead of blocking.
+	class TaskLatch
+	{
+	private:
+		std::atomic<size_t> m_count;
+		std::mutex m_mutex;
+		std::condition_variable m_releasedCondition;
+		bool m_isReleased;
+
+	public:
+		explicit TaskLatch(size_t count = 0) : m_count(count), m_isReleased(count == 0) {}
+
+		TaskLatch(const TaskLatch&) = delete;
+		TaskLatch& operator=(const TaskLatch&) = delete;
+		TaskLatch(TaskLatch&&) = delete;
+		TaskLatch& operator=(TaskLatch&&) = delete;
+
+		// Only while nobody waits on or counts down the latch
+		void reset(size_t count) {
+			m_count.store(count, std::memory_order_relaxed);
+			m_isReleased = count == 0;
+		}
+
+		// Only while the count is known to be above zero, e.g. from a task that has not counted down yet
+		inline void countUp(size_t count = 1) {
+			m_count.fetch_add(count, std::memory_order_relaxed);
+		}
+
+		inline void countDown(size_t count = 1) {
+			if (m_count.fetch_sub(count, std::memory_order_acq_rel) != count) return;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isReleased = true;
+			m_releasedCondition.notify_all();
+		}
+
+		inline bool isReleased() const {
+			return m_count.load(std::memory_order_acquire) == 0;
+		}
+
+		// Blocks without helping, for threads that are not workers of the pool running the tasks
+		void wait() {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_releasedCondition.wait(lock, [this]() { return m_isReleased; });
+		}
+
+		void wait(MinimalThreadPool& pool) {
+			if (pool.isWorkerThread()) {
+				while (!isReleased())
+					if (!pool.tryRunPendingTask()) std::this_thread::yield();
+			}
+			wait();
+		}
+	};
+}
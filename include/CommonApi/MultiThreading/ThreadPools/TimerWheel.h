@@ -0,0 +1,227 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace MultiThreading
+{
+	// Hierarchical timer wheel over integer ticks, not thread-safe. Level l has 256 slots of 256^l ticks,
+	// a timer sits in the lowest level whose range still contains both the current tick and its deadline
+	// and moves down a level whenever the wheel reaches its slot, so insert and cancel are O(1) list
+	// operations. Timers live in a node vector with a free list, handles carry a generation so a
+	// stale handle never cancels a reused node. Deadlines are tracked up to 2^48 ticks ahead.
+	template<typename Payload>
+	class TimerWheel
+	{
+	public:
+		using Handle = uint64_t;
+		static constexpr Handle s_invalidHandle = 0;
+
+	private:
+		static constexpr unsigned s_slotBits = 8;
+		static constexpr unsigned s_levelCount = 6;
+		static constexpr uint32_t s_slotCount = 1u << s_slotBits;
+		static constexpr uint32_t s_slotMask = s_slotCount - 1;
+		static constexpr uint64_t s_horizon = uint64_t(1) << (s_slotBits * s_levelCount);
+		static constexpr uint32_t s_null = UINT32_MAX;
+
+		struct Node {
+			uint64_t deadline = 0;
+			uint32_t previous = s_null;
+			uint32_t next = s_null;			// also links the free list
+			uint32_t bucket = s_null;		// level * s_slotCount + slot while linked
+			uint32_t generation = 1;
+			std::optional<Payload> payload;
+		};
+
+		std::vector<Node> m_nodes;
+		uint32_t m_freeHead = s_null;
+		std::array<uint32_t, s_levelCount * s_slotCount> m_buckets;
+		std::array<std::array<uint64_t, s_slotCount / 64>, s_levelCount> m_occupied{};
+		uint64_t m_now;
+		size_t m_size = 0;
+
+		static inline Handle makeHandle(uint32_t index, uint32_t generation) {
+			return (static_cast<uint64_t>(generation) << 32) | (index + 1);
+		}
+
+		// First occupied slot after the given one, s_slotCount if there is none
+		static uint32_t findOccupied(const std::array<uint64_t, s_slotCount / 64>& occupied, uint32_t after) {
+			uint32_t start = after + 1;
+			if (start >= s_slotCount) return s_slotCount;
+			size_t word = start / 64;
+			uint64_t bits = occupied[word] & (~uint64_t(0) << (start % 64));
+			while (true) {
+				if (bits) return static_cast<uint32_t>(word * 64 + std::countr_zero(bits));
+				if (++word == occupied.size()) return s_slotCount;
+				bits = occupied[word];
+			}
+		}
+
+		void link(uint32_t index) {
+			Node& node = m_nodes[index];
+			// Deadlines past the current top level block wait in its last slot and are placed again from there
+			uint64_t deadline = std::min(node.deadline, m_now | (s_horizon - 1));
+			uint64_t difference = deadline ^ m_now;
+			unsigned level = 0;
+			while (level + 1 < s_levelCount && (difference >> (s_slotBits * (level + 1))) != 0) ++level;
+			uint32_t slot = static_cast<uint32_t>(deadline >> (s_slotBits * level)) & s_slotMask;
+
+			node.bucket = level * s_slotCount + slot;
+			node.previous = s_null;
+			node.next = m_buckets[node.bucket];
+			if (node.next != s_null) m_nodes[node.next].previous = index;
+			m_buckets[node.bucket] = index;
+			m_occupied[level][slot / 64] |= uint64_t(1) << (slot % 64);
+		}
+
+		void unlink(uint32_t index) {
+			Node& node = m_nodes[index];
+			if (node.previous != s_null) m_nodes[node.previous].next = node.next;
+			else m_buckets[node.bucket] = node.next;
+			if (node.next != s_null) m_nodes[node.next].previous = node.previous;
+			if (m_buckets[node.bucket] == s_null) clearOccupied(node.bucket);
+			node.bucket = s_null;
+		}
+
+		inline void clearOccupied(uint32_t bucket) {
+			uint32_t slot = bucket % s_slotCount;
+			m_occupied[bucket / s_slotCount][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+		}
+
+		// Empties the bucket and returns its list
+		inline uint32_t detach(uint32_t bucket) {
+			uint32_t head = std::exchange(m_buckets[bucket], s_null);
+			if (head != s_null) clearOccupied(bucket);
+			return head;
+		}
+
+		Payload release(uint32_t index) {
+			Node& node = m_nodes[index];
+			Payload payload = std::move(*node.payload);
+			node.payload.reset();
+			++node.generation;
+			node.next = m_freeHead;
+			m_freeHead = index;
+			--m_size;
+			return payload;
+		}
+
+		// Requires m_now == tick
+		template<typename Fire>
+		void step(uint64_t tick, Fire& fire) {
+			for (unsigned level = s_levelCount - 1; level > 0; --level) {
+				if ((tick & ((uint64_t(1) << (s_slotBits * level)) - 1)) != 0) continue;
+				uint32_t bucket = level * s_slotCount + (static_cast<uint32_t>(tick >> (s_slotBits * level)) & s_slotMask);
+				for (uint32_t index = detach(bucket); index != s_null;) {
+					uint32_t next = m_nodes[index].next;
+					link(index);
+					index = next;
+				}
+			}
+
+			for (uint32_t index = detach(static_cast<uint32_t>(tick) & s_slotMask); index != s_null;) {
+				Node& node = m_nodes[index];
+				uint32_t next = node.next;
+				node.bucket = s_null;
+				if (node.deadline > tick) link(index);
+				else if (std::optional<uint64_t> rearm = fire(*node.payload)) {
+					node.deadline = std::max(*rearm, tick + 1);
+					link(index);
+				}
+				else release(index);
+				index = next;
+			}
+		}
+
+	public:
+		explicit TimerWheel(uint64_t now = 0) : m_now(now) {
+			m_buckets.fill(s_null);
+		}
+
+		TimerWheel(const TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+
+		inline uint64_t now() const { return m_now; }
+		inline size_t size() const { return m_size; }
+		inline bool empty() const { return m_size == 0; }
+
+		// Deadlines that already passed fire on the next tick
+		Handle insert(uint64_t deadline, Payload payload) {
+			uint32_t index;
+			if (m_freeHead != s_null) {
+				index = m_freeHead;
+				m_freeHead = m_nodes[index].next;
+			}
+			else {
+				index = static_cast<uint32_t>(m_nodes.size());
+				m_nodes.emplace_back();
+			}
+
+			Node& node = m_nodes[index];
+			node.deadline = std::max(deadline, m_now + 1);
+			node.payload.emplace(std::move(payload));
+			link(index);
+			++m_size;
+			return makeHandle(index, node.generation);
+		}
+
+		// Returns the payload of a pending timer, nothing if the handle fired, was cancelled or is invalid
+		std::optional<Payload> cancel(Handle handle) {
+			uint32_t index = static_cast<uint32_t>(handle) - 1;
+			if (handle == s_invalidHandle || index >= m_nodes.size()) return std::nullopt;
+			Node& node = m_nodes[index];
+			if (node.generation != static_cast<uint32_t>(handle >> 32) || node.bucket == s_null) return std::nullopt;
+			unlink(index);
+			return release(index);
+		}
+
+		// Earliest tick at which advance has something to do, a timer firing or moving down a level
+		std::optional<uint64_t> nextEventTick() const {
+			if (m_size == 0) return std::nullopt;
+			uint64_t earliest = UINT64_MAX;
+			for (unsigned level = 0; level < s_levelCount; ++level) {
+				const unsigned shift = s_slotBits * level;
+				uint32_t current = static_cast<uint32_t>(m_now >> shift) & s_slotMask;
+				uint32_t slot = findOccupied(m_occupied[level], current);
+				if (slot == s_slotCount) continue;
+				uint64_t block = m_now & ~((uint64_t(1) << (shift + s_slotBits)) - 1);
+				earliest = std::min(earliest, block | (static_cast<uint64_t>(slot) << shift));
+			}
+			return earliest;
+		}
+
+		// Moves the wheel to tick and calls fire(Payload&) for every timer due by then, in deadline order.
+		// fire returns the next deadline to keep the timer, with the same handle, or nothing to drop it.
+		// fire must not insert into or cancel from the wheel.
+		template<typename Fire>
+		void advance(uint64_t tick, Fire&& fire) {
+			while (m_now < tick) {
+				std::optional<uint64_t> next = nextEventTick();
+				if (!next || *next > tick) {
+					m_now = tick;
+					break;
+				}
+				m_now = *next;
+				step(m_now, fire);
+			}
+		}
+
+		// Drops every timer, dispose(Payload&&) gets each payload
+		template<typename Dispose>
+		void clear(Dispose&& dispose) {
+			for (uint32_t index = 0; index < m_nodes.size(); ++index) {
+				if (m_nodes[index].bucket == s_null) continue;
+				unlink(index);
+				dispose(release(index));
+			}
+		}
+	};
+}
@@ -1,63 +1,250 @@
 #pragma once
 #include "CommonApi/Namespaces.h"
-#include "CommonApi/MultiThreading/ThreadPool.h"
-#include "CommonApi/MultiThreading/Synchronized.h"
+#include "CommonApi/MultiThreading/ThreadPools/MinimalThreadPool.h"
 
-#include <set>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace MultiThreading
 {
-	template <typename T, typename Hash = std::less<T>>
+	// Runs at most one task per identifier at a time in a MinimalThreadPool, with at most maxPendingTasks
+	// identifiers in flight. In-flight identifiers live in a hash set split into shards with their own mutex,
+	// so adds and completions of different identifiers rarely contend. A filter of per-hash counters next to
+	// it answers canAddTask without locking. Tasks take () or (size_t threadIndex) like pool tasks do.
+	template<typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>>
 	class UniqueTaskCoordinator
 	{
-	private:
-		unsigned int m_maxPendingTasks;
-		ThreadPool& m_threadPoolHandle;
-		Synchronized<std::set<T, Hash>> m_pendingTasks;
 	public:
-		UniqueTaskCoordinator(ThreadPool& threadPool, unsigned int maxPendingTasks) :
-			m_threadPoolHandle(threadPool),
-			m_maxPendingTasks(maxPendingTasks),
-			m_pendingTasks(Synchronized<std::vector<T>>()) {
-			m_pendingTasks.getWriteAccess()->reserve(maxPendingTasks);
+		// Called once the task of the identifier finished, with false if it threw or was dropped by the pool
+		using CompletionCallback = std::function<void(bool completed)>;
+
+		enum class AddResult {
+			Added,
+			Coalesced,		// the identifier was in flight, the callback waits for that task instead
+			Rejected,		// the identifier was in flight without a callback to coalesce, or the limit was reached
+		};
+
+	private:
+		using Callbacks = std::vector<CompletionCallback>;
+
+		struct alignas(64) Shard {
+			std::mutex mutex;
+			std::unordered_map<T, Callbacks, Hash, KeyEqual> inFlight;
+		};
+
+		// Holds the identifier until it is run or destroyed
+		template<typename Task>
+		class UniqueTask {
+		private:
+			UniqueTaskCoordinator* m_coordinator;
+			Task m_task;
+			T m_identifier;
+
+		public:
+			template<typename Callable>
+			UniqueTask(UniqueTaskCoordinator& coordinator, Callable&& task, const T& identifier) :
+				m_coordinator(&coordinator), m_task(std::forward<Callable>(task)), m_identifier(identifier) {}
+
+			UniqueTask(UniqueTask&& other) noexcept(std::is_nothrow_move_constructible_v<Task> && std::is_nothrow_move_constructible_v<T>) :
+				m_coordinator(std::exchange(other.m_coordinator, nullptr)), m_task(std::move(other.m_task)),
+				m_identifier(std::move(other.m_identifier)) {}
+
+			UniqueTask(const UniqueTask&) = delete;
+			UniqueTask& operator=(const UniqueTask&) = delete;
+			UniqueTask& operator=(UniqueTask&&) = delete;
+
+			~UniqueTask() {
+				if (m_coordinator) m_coordinator->finish(m_identifier, false);
+			}
+
+			void operator()(size_t threadIndex) {
+				UniqueTaskCoordinator* coordinator = std::exchange(m_coordinator, nullptr);
+				try {
+					if constexpr (std::is_invocable_v<Task&, size_t>) m_task(threadIndex);
+					else m_task();
+				} catch (...) {
+					coordinator->finish(m_identifier, false);
+					throw;
+				}
+				coordinator->finish(m_identifier, true);
+			}
+		};
+
+		MinimalThreadPool& m_threadPoolHandle;
+		size_t m_maxPendingTasks;
+		Hash m_hash;
+		KeyEqual m_equal;
+
+		std::unique_ptr<Shard[]> m_shards;
+		size_t m_shardMask;
+		// In-flight identifiers per hash bucket, a zero means none of them is in flight
+		std::unique_ptr<std::atomic<uint32_t>[]> m_filter;
+		size_t m_filterMask;
+
+		alignas(64) std::atomic<size_t> m_pendingTasks = 0;
+		// Threads between releasing their identifier and their last access, waitIdle waits for them
+		std::atomic<size_t> m_finishingCount = 0;
+
+		// The std::hash of integers is the identity, spread it before taking bits for the shard and filter
+		inline uint64_t hashOf(const T& identifier) const {
+			uint64_t hash = static_cast<uint64_t>(m_hash(identifier));
+			hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+			hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+			return hash ^ (hash >> 31);
+		}
+
+		inline Shard& shardOf(uint64_t hash) {
+			return m_shards[(hash >> 32) & m_shardMask];
+		}
+
+		inline std::atomic<uint32_t>& filterOf(uint64_t hash) const {
+			return m_filter[hash & m_filterMask];
+		}
+
+		bool tryAcquire() {
+			size_t pending = m_pendingTasks.load(std::memory_order_relaxed);
+			while (pending < m_maxPendingTasks)
+				if (m_pendingTasks.compare_exchange_weak(pending, pending + 1, std::memory_order_acquire, std::memory_order_relaxed))
+					return true;
+			return false;
 		}
 
-		bool tryAddTask(std::function<void()> task, T identifier)
-		{
+		void finish(const T& identifier, bool completed) {
+			uint64_t hash = hashOf(identifier);
+			Shard& shard = shardOf(hash);
+			Callbacks callbacks;
+			m_finishingCount.fetch_add(1, std::memory_order_relaxed);
 			{
-				auto access = m_pendingTasks.getWriteAccess();
-				if (access->size() >= m_maxPendingTasks ||
-					access->find(identifier) != access->end())
-					return 0;
-				access->insert(identifier);
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				auto it = shard.inFlight.find(identifier);
+				callbacks = std::move(it->second);
+				shard.inFlight.erase(it);
+				filterOf(hash).fetch_sub(1, std::memory_order_release);
 			}
+			if (m_pendingTasks.fetch_sub(1, std::memory_order_release) == 1) m_pendingTasks.notify_all();
+			// Last access, the coordinator may be destroyed right after it
+			m_finishingCount.fetch_sub(1, std::memory_order_release);
+			for (auto& callback : callbacks) callback(completed);
+		}
+
+		template<typename Task>
+		AddResult add(Task&& task, const T& identifier, CompletionCallback* onComplete) {
+			uint64_t hash = hashOf(identifier);
+			Shard& shard = shardOf(hash);
+			{
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				auto it = shard.inFlight.find(identifier);
+				if (it != shard.inFlight.end()) {
+					if (!onComplete) return AddResult::Rejected;
+					it->second.push_back(std::move(*onComplete));
+					return AddResult::Coalesced;
+				}
+				if (!tryAcquire()) return AddResult::Rejected;
+
+				try {
+					Callbacks& callbacks = shard.inFlight.try_emplace(identifier).first->second;
+					if (onComplete) callbacks.push_back(std::move(*onComplete));
+				} catch (...) {
+					shard.inFlight.erase(identifier);
+					m_pendingTasks.fetch_sub(1, std::memory_order_release);
+					throw;
+				}
+				filterOf(hash).fetch_add(1, std::memory_order_relaxed);
+			}
+
+			// Pushed outside the shard lock, the task may finish before postTask returns. If pushing fails
+			// the constructed wrapper already released the identifier, reporting failure to the callbacks.
+			bool wrapped = false;
+			try {
+				UniqueTask<std::decay_t<Task>> unique(*this, std::forward<Task>(task), identifier);
+				wrapped = true;
+				m_threadPoolHandle.postTask(std::move(unique));
+			} catch (...) {
+				if (!wrapped) finish(identifier, false);
+				throw;
+			}
+			return AddResult::Added;
+		}
+
+	public:
+		UniqueTaskCoordinator(MinimalThreadPool& threadPool, size_t maxPendingTasks, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual()) :
+			m_threadPoolHandle(threadPool), m_maxPendingTasks(maxPendingTasks), m_hash(hash), m_equal(equal) {
+			size_t shardCount = std::bit_ceil(std::clamp<size_t>(std::thread::hardware_concurrency() * 4, 16, 256));
+			m_shards = std::make_unique<Shard[]>(shardCount);
+			m_shardMask = shardCount - 1;
+			for (size_t i = 0; i < shardCount; ++i)
+				m_shards[i].inFlight = std::unordered_map<T, Callbacks, Hash, KeyEqual>(maxPendingTasks / shardCount + 1, m_hash, m_equal);
+
+			// Sixteen counters per allowed identifier keep false positives of canAddTask(id) rare
+			size_t filterSize = std::bit_ceil(std::max<size_t>(maxPendingTasks * 16, 1024));
+			m_filter = std::make_unique<std::atomic<uint32_t>[]>(filterSize);
+			m_filterMask = filterSize - 1;
+		}
+
+		UniqueTaskCoordinator(const UniqueTaskCoordinator&) = delete;
+		UniqueTaskCoordinator& operator=(const UniqueTaskCoordinator&) = delete;
+
+		// Tasks refer back to the coordinator, so it waits for every one of them to finish or be dropped
+		~UniqueTaskCoordinator() {
+			waitIdle();
+		}
+
+		// Queues task unless identifier is in flight or the limit is reached
+		template<typename Task>
+		bool tryAddTask(Task&& task, const T& identifier) {
+			return add(std::forward<Task>(task), identifier, nullptr) == AddResult::Added;
+		}
+
+		// Like tryAddTask, but if identifier is in flight onComplete is attached to that task instead.
+		// onComplete runs on the thread that finished the task, or inside this call if pushing fails.
+		template<typename Task>
+		AddResult tryAddTask(Task&& task, const T& identifier, CompletionCallback onComplete) {
+			return add(std::forward<Task>(task), identifier, &onComplete);
+		}
+
+		// Wait-free: two atomic loads. It may see the identifier as in flight when another one with
+		// a colliding hash is, but never misses one that was in flight before the call.
+		inline bool canAddTask(const T& identifier) const {
+			return canAddTask() && !isInFlight(identifier);
+		}
+
+		inline bool canAddTask() const {
+			return m_pendingTasks.load(std::memory_order_relaxed) < m_maxPendingTasks;
+		}
+
+		// Wait-free, with the same false positives as canAddTask(identifier)
+		inline bool isInFlight(const T& identifier) const {
+			return filterOf(hashOf(identifier)).load(std::memory_order_acquire) != 0;
+		}
 
-			m_threadPoolHandle.pushTask([this, f = std::move(task), identifier] {
-				f();
-				auto access = m_pendingTasks.getWriteAccess();
-				access->erase(identifier);
-				});
-			return 1;
+		inline size_t getPendingTaskCount() const {
+			return m_pendingTasks.load(std::memory_order_relaxed);
 		}
 
-		bool canAddTask(T identifier)
-		{
-			auto access = m_pendingTasks.getWriteAccess();
-			if (access->size() >= m_maxPendingTasks ||
-				access->find(identifier) != access->end())
-				return 0;
-			return 1;
+		inline size_t getMaxPendingTasks() const {
+			return m_maxPendingTasks;
 		}
 
-		bool canAddTask()
-		{
-			auto access = m_pendingTasks.getWriteAccess();
-			if (access->size())
-				return 0;
-			return 1;
+		// Waits until every queued identifier finished or was dropped and no thread touches the
+		// coordinator on their behalf any more, completion callbacks may still be running
+		void waitIdle() const {
+			size_t pending;
+			while ((pending = m_pendingTasks.load(std::memory_order_acquire)) != 0) m_pendingTasks.wait(pending, std::memory_order_acquire);
+			// The last finisher is at most a notify away
+			while (m_finishingCount.load(std::memory_order_acquire) != 0) std::this_thread::yield();
 		}
 
-		inline ThreadPool& getPoolHandle() const {
+		inline MinimalThreadPool& getPoolHandle() const {
 			return m_threadPoolHandle;
 		};
 	};
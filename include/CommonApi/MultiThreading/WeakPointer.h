@@ -8,71 +8,46 @@
 //Weak pointer
 namespace MultiThreading
 {
+	// Keeps the slot, not the object, alive
 	template <typename T>
 	class MemoryPool<T>::WeakPointer
 	{
 	public:
 		static const WeakPointer nullPtr;
 	private:
-		Iterator m_iterator;
-		Synchronized<PointerControlBlock>* m_controlBlock;
+		Storage* m_storage;
 
-		//control block access is only here
 		inline void cleanup()
 		{
-			bool isLast = false;
-			if (m_controlBlock)
-			{
-				auto access = m_controlBlock->getWriteAccess();
-				if (!--access->weakCounter && !access->sharedCounter)
-					isLast = true;
-			}
-			if (isLast)
-				delete m_controlBlock;
-			nullify();
+			if (m_storage)
+				MemoryPool::releaseWeak(m_storage);
+			m_storage = nullptr;
 		}
 
-		inline void nullify()
+		inline void acquire()
 		{
-			m_iterator = { nullptr, 0, nullptr };
-			m_controlBlock = nullptr;
+			if (m_storage)
+				m_storage->control.weakCounter.fetch_add(1, std::memory_order_relaxed);
 		}
 
 	public:
-		WeakPointer() :
-			m_iterator(Iterator{ nullptr, 0, nullptr }),
-			m_controlBlock(nullptr) {};
-
-		WeakPointer(std::nullptr_t) :
-			m_iterator(Iterator{ nullptr, 0, nullptr }),
-			m_controlBlock(nullptr) {};
-
-		WeakPointer(MemoryPool<T>::SharedPointer ptr) :
-			m_iterator(ptr.m_iterator),
-			m_controlBlock(ptr.m_controlBlock) {
-			if (m_controlBlock)
-			{
-				auto access = m_controlBlock->getWriteAccess();
-				access->weakCounter++;
-			}
+		WeakPointer() : m_storage(nullptr) {};
+
+		WeakPointer(std::nullptr_t) : m_storage(nullptr) {};
+
+		WeakPointer(const MemoryPool<T>::SharedPointer& ptr) : m_storage(ptr.m_storage)
+		{
+			acquire();
 		};
 
-		WeakPointer(const WeakPointer& other) :
-			m_iterator(other.m_iterator),
-			m_controlBlock(other.m_controlBlock)
+		WeakPointer(const WeakPointer& other) : m_storage(other.m_storage)
 		{
-			if (m_controlBlock)
-			{
-				auto access = m_controlBlock->getWriteAccess();
-				access->weakCounter++;
-			}
+			acquire();
 		};
 
-		WeakPointer(WeakPointer&& other) noexcept :
-			m_iterator(other.m_iterator),
-			m_controlBlock(other.m_controlBlock)
+		WeakPointer(WeakPointer&& other) noexcept : m_storage(other.m_storage)
 		{
-			other.nullify();
+			other.m_storage = nullptr;
 		}
 
 		~WeakPointer()
@@ -91,14 +66,11 @@ namespace MultiThreading
 			if (this == &other)
 				return *this;
 
+			Storage* storage = other.m_storage;
+			if (storage)
+				storage->control.weakCounter.fetch_add(1, std::memory_order_relaxed);
 			cleanup();
-			m_iterator = other.m_iterator;
-			m_controlBlock = other.m_controlBlock;
-			if (m_controlBlock)
-			{
-				auto access = m_controlBlock->getWriteAccess();
-				access->weakCounter++;
-			}
+			m_storage = storage;
 			return *this;
 		};
 
@@ -108,11 +80,8 @@ namespace MultiThreading
 				return *this;
 
 			cleanup();
-
-			m_iterator = other.m_iterator;
-			m_controlBlock = other.m_controlBlock;
-
-			other.nullify();
+			m_storage = other.m_storage;
+			other.m_storage = nullptr;
 			return *this;
 		}
 
@@ -120,64 +89,61 @@ namespace MultiThreading
 			cleanup();
 		}
 
+		// Never revives an object whose shared count already reached zero
 		SharedPointer lock() const
 		{
-			if (m_controlBlock != nullptr) {
-				auto access = m_controlBlock->getWriteAccess();
-
-				// Check if shared count is still valid
-				if (access->sharedCounter) {
-					access->sharedCounter++;
-					return SharedPointer(m_iterator, m_controlBlock);
-				}
-			}
+			if (!m_storage)
+				return SharedPointer();
+
+			uint32_t count = m_storage->control.sharedCounter.load(std::memory_order_relaxed);
+			while (count != 0)
+				if (m_storage->control.sharedCounter.compare_exchange_weak(count, count + 1,
+					std::memory_order_acq_rel, std::memory_order_relaxed))
+					return SharedPointer(m_storage);
 			return SharedPointer();
 		}
 
 		bool expired() const noexcept
 		{
-			if (!m_controlBlock)
-				return true;
-			return !m_controlBlock->getReadAccess()->sharedCounter;
+			return !m_storage || m_storage->control.sharedCounter.load(std::memory_order_acquire) == 0;
 		}
 
+		// Weak pointers only, the reference the shared owners hold together is not counted
 		size_t getCount() const {
-			if (m_controlBlock)
-			{
-				auto access = m_controlBlock->getWriteAccess();
-				return access->weakCounter;
-			}
-			return 0;
+			if (!m_storage)
+				return 0;
+			uint32_t shared = m_storage->control.sharedCounter.load(std::memory_order_relaxed);
+			return m_storage->control.weakCounter.load(std::memory_order_relaxed) - (shared ? 1 : 0);
 		}
 
 		inline T& operator*() {
-			if (!m_iterator.ptr) throw std::runtime_error("Dereferencing a null pointer");
-			return *m_iterator.ptr;
+			if (!m_storage) throw std::runtime_error("Dereferencing a null pointer");
+			return *m_storage->object();
 		};
 
 		inline const T& operator*() const {
-			if (!m_iterator.ptr) throw std::runtime_error("Dereferencing a null pointer");
-			return *m_iterator.ptr;
+			if (!m_storage) throw std::runtime_error("Dereferencing a null pointer");
+			return *m_storage->object();
 		};
 
 		inline T* operator->() {
-			if (!m_iterator.ptr) throw std::runtime_error("Dereferencing a null pointer");
-			return m_iterator.ptr;
+			if (!m_storage) throw std::runtime_error("Dereferencing a null pointer");
+			return m_storage->object();
 		};
 
 		inline const T* operator->() const {
-			if (!m_iterator.ptr) throw std::runtime_error("Dereferencing a null pointer");
-			return m_iterator.ptr;
+			if (!m_storage) throw std::runtime_error("Dereferencing a null pointer");
+			return m_storage->object();
 		};
 
 		explicit operator bool() const {
-			return m_iterator.ptr != nullptr;
+			return m_storage != nullptr;
 		}
 
-		bool operator==(std::nullptr_t) const { return m_iterator.ptr == nullptr; };
-		bool operator!=(std::nullptr_t) const { return m_iterator.ptr != nullptr; };
-		bool operator==(const WeakPointer& other) const { return m_iterator.ptr == other.m_iterator.ptr; };
-		bool operator!=(const WeakPointer& other) const { return m_iterator.ptr != other.m_iterator.ptr; };
+		bool operator==(std::nullptr_t) const { return m_storage == nullptr; };
+		bool operator!=(std::nullptr_t) const { return m_storage != nullptr; };
+		bool operator==(const WeakPointer& other) const { return m_storage == other.m_storage; };
+		bool operator!=(const WeakPointer& other) const { return m_storage != other.m_storage; };
 	};
 
 	template <typename T>
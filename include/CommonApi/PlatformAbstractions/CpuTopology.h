@@ -0,0 +1,45 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+#include "CommonApi/PlatformAbstractions/ErrorMapper.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace Platform
+{
+    struct LogicalCpu {
+        size_t index;       // OS processor number, as used by Thread::setCurrentAffinity
+        size_t core;        // physical core, unique across packages
+        size_t package;     // socket
+        size_t numaNode;
+    };
+
+    // Logical processors the process is allowed to run on, with the core, package and NUMA node
+    // they belong to. When the OS does not report a level, every processor is put in node or package 0.
+    class CpuTopology
+    {
+    private:
+        std::vector<LogicalCpu> m_cpus;
+        size_t m_packageCount = 1;
+        size_t m_numaNodeCount = 1;
+
+    public:
+        static CpuTopology query();
+
+        inline const std::vector<LogicalCpu>& getCpus() const { return m_cpus; }
+        inline size_t getCpuCount() const { return m_cpus.size(); }
+        inline size_t getPackageCount() const { return m_packageCount; }
+        inline size_t getNumaNodeCount() const { return m_numaNodeCount; }
+
+        // NUMA node of the processor with the given OS index, 0 if unknown
+        size_t numaNodeOf(size_t cpuIndex) const;
+
+        // Processor indices ordered so that consecutive threads share as much as possible:
+        // the hyperthreads of one core, then the cores of one package, then the next package
+        std::vector<size_t> compactOrder() const;
+
+        // Processor indices ordered so that consecutive threads share as little as possible:
+        // one core per package in turn, hyperthread siblings only once every core has a thread
+        std::vector<size_t> scatterOrder() const;
+    };
+}
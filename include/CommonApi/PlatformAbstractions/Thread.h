@@ -5,9 +5,21 @@
 #include <functional>
 #include <stdexcept>
 #include <memory>
+#include <span>
+#include <string_view>
 
 namespace Platform
 {
+    // Mapped to thread priorities on Windows and to nice values on Linux,
+    // raising the priority above Normal usually needs elevated rights there
+    enum class ThreadPriority {
+        Lowest,
+        BelowNormal,
+        Normal,
+        AboveNormal,
+        Highest,
+    };
+
     class Thread {
     private:
 #ifdef _WIN32
@@ -66,6 +78,23 @@ namespace Platform
         void join();
         void detach();
 
+        // Restricts the started thread to the given OS processor indices, see CpuTopology
+        void setAffinity(std::span<const size_t> cpus);
+
+        // Names show up in debuggers and profilers, Linux truncates them to 15 characters
+        void setName(std::string_view name);
+
+        // The same controls for the calling thread, which also covers threads started
+        // through std::thread. Failures throw Platform::Exception.
+        static void setCurrentAffinity(std::span<const size_t> cpus);
+        static void setCurrentName(std::string_view name);
+        static void setCurrentPriority(ThreadPriority priority);
+
+        // Asks the OS to place memory the calling thread allocates from now on, on the given NUMA node.
+        // Only a hint: on Linux it sets a preferred memory policy, on Windows it moves the
+        // thread's ideal processor to that node, whose memory Windows then prefers.
+        static void setCurrentPreferredNumaNode(size_t node);
+
     private:
         void startInternal(std::unique_ptr<std::function<void()>> callable);
     };
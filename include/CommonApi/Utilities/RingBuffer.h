@@ -0,0 +1,86 @@
+#pragma once
+#include "CommonApi/Namespaces.h"
+
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+namespace Utilities
+{
+	// Growable double-ended circular buffer. Unlike std::deque it never allocates
+	// once it has reached its peak size, which makes it suitable for hot queues.
+	template<typename T>
+	class RingBuffer
+	{
+	private:
+		std::vector<T> m_data;
+		size_t m_head = 0;
+		size_t m_size = 0;
+
+		inline size_t wrap(size_t index) const { return index & (m_data.size() - 1); }
+
+		void grow() {
+			reserve(m_data.empty() ? 16 : m_data.size() * 2);
+		}
+
+	public:
+		RingBuffer() = default;
+		explicit RingBuffer(size_t capacity) { reserve(capacity); }
+
+		void reserve(size_t capacity) {
+			if (capacity <= m_data.size()) return;
+			size_t newCapacity = m_data.empty() ? 16 : m_data.size();
+			while (newCapacity < capacity) newCapacity *= 2;
+			std::vector<T> data(newCapacity);
+			for (size_t i = 0; i < m_size; ++i) data[i] = std::move(m_data[wrap(m_head + i)]);
+			m_data = std::move(data);
+			m_head = 0;
+		}
+
+		void pushBack(T value) {
+			if (m_size == m_data.size()) grow();
+			m_data[wrap(m_head + m_size)] = std::move(value);
+			++m_size;
+		}
+
+		void pushFront(T value) {
+			if (m_size == m_data.size()) grow();
+			m_head = wrap(m_head + m_data.size() - 1);
+			m_data[m_head] = std::move(value);
+			++m_size;
+		}
+
+		T popFront() {
+			if (empty()) throw std::runtime_error("RingBuffer is empty");
+			T value = std::move(m_data[m_head]);
+			m_head = wrap(m_head + 1);
+			--m_size;
+			return value;
+		}
+
+		T popBack() {
+			if (empty()) throw std::runtime_error("RingBuffer is empty");
+			--m_size;
+			return std::move(m_data[wrap(m_head + m_size)]);
+		}
+
+		T& front() { return m_data[m_head]; }
+		const T& front() const { return m_data[m_head]; }
+		T& back() { return m_data[wrap(m_head + m_size - 1)]; }
+		const T& back() const { return m_data[wrap(m_head + m_size - 1)]; }
+
+		T& operator[](size_t index) { return m_data[wrap(m_head + index)]; }
+		const T& operator[](size_t index) const { return m_data[wrap(m_head + index)]; }
+
+		bool empty() const { return m_size == 0; }
+		size_t size() const { return m_size; }
+		size_t capacity() const { return m_data.size(); }
+
+		// Keeps the capacity
+		void clear() {
+			for (size_t i = 0; i < m_size; ++i) m_data[wrap(m_head + i)] = T();
+			m_head = 0;
+			m_size = 0;
+		}
+	};
+}
@@ -5,15 +5,9 @@ namespace MultiThreading
 {
     std::shared_ptr<std::shared_mutex> FileSystem::getFileMutex(const std::string& path)
     {
-        auto access = fileMutexes.getWriteAccess();
-        auto it = access->find(path);
-        if (it == access->end())
-        {
-            auto [iter, inserted] =
-            access->emplace(path, std::make_shared<std::shared_mutex>());
-            return iter->second;
-        }
-        return it->second;
+        return fileMutexes.computeIfAbsent(path, []() {
+            return std::make_shared<std::shared_mutex>();
+        });
     }
 
     bool FileSystem::exists(const std::string& path)
@@ -0,0 +1,181 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+#include "CommonApi/PlatformAbstractions/CpuTopology.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace Platform
+{
+    namespace
+    {
+        // Rank of every cpu among the hyperthreads of its core and of its core among the cores of its package
+        struct CpuRanks {
+            size_t siblingRank;
+            size_t coreRank;
+        };
+
+        std::vector<CpuRanks> computeRanks(const std::vector<LogicalCpu>& cpus) {
+            std::vector<CpuRanks> ranks(cpus.size());
+            std::map<size_t, size_t> siblingsSeen;                      // core -> hyperthreads seen so far
+            std::map<size_t, std::map<size_t, size_t>> coreRanks;       // package -> core -> rank
+            for (size_t i = 0; i < cpus.size(); ++i) {
+                ranks[i].siblingRank = siblingsSeen[cpus[i].core]++;
+                auto& packageCores = coreRanks[cpus[i].package];
+                auto it = packageCores.try_emplace(cpus[i].core, packageCores.size()).first;
+                ranks[i].coreRank = it->second;
+            }
+            return ranks;
+        }
+
+        template<typename Key>
+        std::vector<size_t> orderBy(const std::vector<LogicalCpu>& cpus, Key key) {
+            std::vector<CpuRanks> ranks = computeRanks(cpus);
+            std::vector<size_t> positions(cpus.size());
+            for (size_t i = 0; i < positions.size(); ++i) positions[i] = i;
+            std::stable_sort(positions.begin(), positions.end(), [&](size_t a, size_t b) {
+                return key(cpus[a], ranks[a]) < key(cpus[b], ranks[b]);
+            });
+
+            std::vector<size_t> order;
+            order.reserve(positions.size());
+            for (size_t position : positions) order.push_back(cpus[position].index);
+            return order;
+        }
+
+#ifndef _WIN32
+        size_t readNumber(const std::filesystem::path& path, size_t fallback) {
+            std::ifstream file(path);
+            long long value = 0;
+            if (!(file >> value) || value < 0) return fallback;
+            return static_cast<size_t>(value);
+        }
+
+        size_t findNumaNode(const std::filesystem::path& cpuDirectory) {
+            std::error_code error;
+            for (const auto& entry : std::filesystem::directory_iterator(cpuDirectory, error)) {
+                std::string name = entry.path().filename().string();
+                if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+                    std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; }))
+                    return std::stoul(name.substr(4));
+            }
+            return 0;
+        }
+#endif
+    }
+
+    CpuTopology CpuTopology::query() {
+        CpuTopology topology;
+
+#ifdef _WIN32
+        DWORD length = 0;
+        GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+        if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) throw Exception(ErrorMapper::fromSystem());
+
+        std::unique_ptr<char[]> buffer(new char[length]);
+        if (!GetLogicalProcessorInformationEx(RelationAll,
+            reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.get()), &length))
+            throw Exception(ErrorMapper::fromSystem());
+
+        std::map<size_t, LogicalCpu> cpus;
+        auto forEachCpu = [](const GROUP_AFFINITY& affinity, auto&& function) {
+            for (size_t bit = 0; bit < sizeof(KAFFINITY) * 8; ++bit)
+                if (affinity.Mask & (KAFFINITY(1) << bit)) function(size_t(affinity.Group) * 64 + bit);
+        };
+
+        size_t coreCount = 0, packageCount = 0;
+        for (DWORD offset = 0; offset < length;) {
+            auto* info = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.get() + offset);
+            switch (info->Relationship) {
+            case RelationProcessorCore: {
+                size_t core = coreCount++;
+                for (WORD g = 0; g < info->Processor.GroupCount; ++g)
+                    forEachCpu(info->Processor.GroupMask[g], [&](size_t cpu) {
+                        cpus.try_emplace(cpu, LogicalCpu{ cpu, 0, 0, 0 }).first->second.core = core;
+                    });
+                break;
+            }
+            case RelationProcessorPackage: {
+                size_t package = packageCount++;
+                for (WORD g = 0; g < info->Processor.GroupCount; ++g)
+                    forEachCpu(info->Processor.GroupMask[g], [&](size_t cpu) {
+                        cpus.try_emplace(cpu, LogicalCpu{ cpu, 0, 0, 0 }).first->second.package = package;
+                    });
+                break;
+            }
+            case RelationNumaNode:
+                forEachCpu(info->NumaNode.GroupMask, [&](size_t cpu) {
+                    cpus.try_emplace(cpu, LogicalCpu{ cpu, 0, 0, 0 }).first->second.numaNode = info->NumaNode.NodeNumber;
+                });
+                break;
+            default:
+                break;
+            }
+            offset += info->Size;
+        }
+
+        // Only the processors of the current group are available to the process by default
+        DWORD_PTR processMask = 0, systemMask = 0;
+        GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+        PROCESSOR_NUMBER processor;
+        GetCurrentProcessorNumberEx(&processor);
+        const size_t group = processor.Group;
+
+        for (auto& [index, cpu] : cpus) {
+            if (index / 64 != group || !(processMask & (DWORD_PTR(1) << (index % 64)))) continue;
+            topology.m_cpus.push_back(cpu);
+        }
+#else
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) throw Exception(ErrorMapper::fromSystem());
+
+        const std::filesystem::path root = "/sys/devices/system/cpu";
+        for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &allowed)) continue;
+            std::filesystem::path directory = root / ("cpu" + std::to_string(cpu));
+            size_t package = readNumber(directory / "topology" / "physical_package_id", 0);
+            size_t core = readNumber(directory / "topology" / "core_id", cpu);
+            // core_id is only unique within a package
+            topology.m_cpus.push_back(LogicalCpu{ cpu, package * CPU_SETSIZE + core, package, findNumaNode(directory) });
+        }
+#endif
+
+        size_t maxPackage = 0, maxNode = 0;
+        for (const auto& cpu : topology.m_cpus) {
+            maxPackage = std::max(maxPackage, cpu.package);
+            maxNode = std::max(maxNode, cpu.numaNode);
+        }
+        topology.m_packageCount = maxPackage + 1;
+        topology.m_numaNodeCount = maxNode + 1;
+        return topology;
+    }
+
+    size_t CpuTopology::numaNodeOf(size_t cpuIndex) const {
+        for (const auto& cpu : m_cpus)
+            if (cpu.index == cpuIndex) return cpu.numaNode;
+        return 0;
+    }
+
+    std::vector<size_t> CpuTopology::compactOrder() const {
+        return orderBy(m_cpus, [](const LogicalCpu& cpu, const CpuRanks& ranks) {
+            return std::make_tuple(cpu.package, ranks.coreRank, ranks.siblingRank);
+        });
+    }
+
+    std::vector<size_t> CpuTopology::scatterOrder() const {
+        return orderBy(m_cpus, [](const LogicalCpu& cpu, const CpuRanks& ranks) {
+            return std::make_tuple(ranks.siblingRank, ranks.coreRank, cpu.package);
+        });
+    }
+}
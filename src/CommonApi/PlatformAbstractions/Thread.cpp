@@ -2,10 +2,18 @@
 #include <windows.h>
 #else
 #include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <cerrno>
 #endif
 
 #include "CommonApi/PlatformAbstractions/Thread.h"
 
+#include <string>
+#include <vector>
+
 namespace Platform
 {
 #ifdef _WIN32
@@ -20,6 +28,46 @@ namespace Platform
         return 0;
     }
 
+#ifdef _WIN32
+    // Processors beyond the first 64 belong to other processor groups, which a plain affinity mask can not address
+    static DWORD_PTR affinityMask(std::span<const size_t> cpus) {
+        DWORD_PTR mask = 0;
+        for (size_t cpu : cpus) {
+            if (cpu >= sizeof(DWORD_PTR) * 8) throw Exception(Error::InvalidArg);
+            mask |= DWORD_PTR(1) << cpu;
+        }
+        if (mask == 0) throw Exception(Error::InvalidArg);
+        return mask;
+    }
+
+    static void setAffinity(HANDLE thread, std::span<const size_t> cpus) {
+        if (!SetThreadAffinityMask(thread, affinityMask(cpus))) throw Exception(ErrorMapper::fromSystem());
+    }
+
+    static void setName(HANDLE thread, std::string_view name) {
+        int length = MultiByteToWideChar(CP_UTF8, 0, name.data(), static_cast<int>(name.size()), nullptr, 0);
+        std::wstring wideName(static_cast<size_t>(length), L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, name.data(), static_cast<int>(name.size()), wideName.data(), length);
+        if (FAILED(SetThreadDescription(thread, wideName.c_str()))) throw Exception(Error::Unknown);
+    }
+#else
+    static void setAffinity(pthread_t thread, std::span<const size_t> cpus) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (size_t cpu : cpus) {
+            if (cpu >= CPU_SETSIZE) throw Exception(Error::InvalidArg);
+            CPU_SET(cpu, &set);
+        }
+        if (CPU_COUNT(&set) == 0) throw Exception(Error::InvalidArg);
+        if (auto error = pthread_setaffinity_np(thread, sizeof(set), &set)) throw Exception(ErrorMapper::convert(error));
+    }
+
+    static void setName(pthread_t thread, std::string_view name) {
+        std::string truncated(name.substr(0, 15));
+        if (auto error = pthread_setname_np(thread, truncated.c_str())) throw Exception(ErrorMapper::convert(error));
+    }
+#endif
+
     void Thread::startInternal(std::unique_ptr<std::function<void()>> callable) {
 #ifdef _WIN32
         m_thread = CreateThread(
@@ -34,7 +82,7 @@ namespace Platform
         if(!m_thread) throw Exception(ErrorMapper::fromSystem());
 #else
         auto error = pthread_create(&m_thread, nullptr, &threadEntry, callable.get());
-        if (!error)
+        if (error)
         {
             m_thread = 0;
             throw Exception(ErrorMapper::convert(error));
@@ -72,4 +120,76 @@ namespace Platform
             m_thread = 0;
         }
     }
-}
\ No newline at end of file
+
+    void Thread::setAffinity(std::span<const size_t> cpus) {
+        if (!m_thread) throw std::runtime_error("Thread not started");
+        Platform::setAffinity(m_thread, cpus);
+    }
+
+    void Thread::setName(std::string_view name) {
+        if (!m_thread) throw std::runtime_error("Thread not started");
+        Platform::setName(m_thread, name);
+    }
+
+    void Thread::setCurrentAffinity(std::span<const size_t> cpus) {
+#ifdef _WIN32
+        Platform::setAffinity(GetCurrentThread(), cpus);
+#else
+        Platform::setAffinity(pthread_self(), cpus);
+#endif
+    }
+
+    void Thread::setCurrentName(std::string_view name) {
+#ifdef _WIN32
+        Platform::setName(GetCurrentThread(), name);
+#else
+        Platform::setName(pthread_self(), name);
+#endif
+    }
+
+    void Thread::setCurrentPriority(ThreadPriority priority) {
+#ifdef _WIN32
+        static constexpr int s_priorities[] = {
+            THREAD_PRIORITY_LOWEST,
+            THREAD_PRIORITY_BELOW_NORMAL,
+            THREAD_PRIORITY_NORMAL,
+            THREAD_PRIORITY_ABOVE_NORMAL,
+            THREAD_PRIORITY_HIGHEST,
+        };
+        if (!SetThreadPriority(GetCurrentThread(), s_priorities[static_cast<size_t>(priority)]))
+            throw Exception(ErrorMapper::fromSystem());
+#else
+        // Under the default scheduler Linux threads are prioritized by their own nice value
+        static constexpr int s_niceValues[] = { 19, 5, 0, -5, -10 };
+        pid_t threadId = static_cast<pid_t>(syscall(SYS_gettid));
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(threadId), s_niceValues[static_cast<size_t>(priority)]) != 0)
+            throw Exception(ErrorMapper::fromSystem());
+#endif
+    }
+
+    void Thread::setCurrentPreferredNumaNode(size_t node) {
+#ifdef _WIN32
+        GROUP_AFFINITY nodeAffinity;
+        if (node > USHRT_MAX || !GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &nodeAffinity))
+            throw Exception(ErrorMapper::fromSystem());
+        if (nodeAffinity.Mask == 0) throw Exception(Error::InvalidArg);
+
+        PROCESSOR_NUMBER processor{};
+        processor.Group = nodeAffinity.Group;
+        while (!(nodeAffinity.Mask & (KAFFINITY(1) << processor.Number))) ++processor.Number;
+        if (!SetThreadIdealProcessorEx(GetCurrentThread(), &processor, nullptr))
+            throw Exception(ErrorMapper::fromSystem());
+#elif defined(SYS_set_mempolicy)
+        // MPOL_PREFERRED from <numaif.h>, spelled out to avoid depending on libnuma
+        constexpr int s_preferredPolicy = 1;
+        constexpr size_t s_bitsPerWord = sizeof(unsigned long) * 8;
+        std::vector<unsigned long> mask(node / s_bitsPerWord + 1, 0);
+        mask[node / s_bitsPerWord] |= 1ul << (node % s_bitsPerWord);
+        if (syscall(SYS_set_mempolicy, s_preferredPolicy, mask.data(), mask.size() * s_bitsPerWord + 1) != 0)
+            throw Exception(ErrorMapper::fromSystem());
+#else
+        (void)node;
+        throw Exception(Error::OpNotSupported);
+#endif
+    }
+}
@@ -0,0 +1,73 @@
+#include "Benchmark.h"
+
+#include "CommonApi/MultiThreading/ThreadPools/MinimalThreadPool.h"
+
+#include <atomic>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Pool = MultiThreading::MinimalThreadPool;
+
+    constexpr size_t s_bufferBytes = 32 << 20;     // per worker, well past the last level cache
+    constexpr size_t s_passesPerWorker = 8;
+
+    const char* policyName(Pool::AffinityPolicy policy) {
+        switch (policy) {
+        case Pool::AffinityPolicy::Compact: return "compact ";
+        case Pool::AffinityPolicy::Scatter: return "scatter ";
+        default: return "unpinned";
+        }
+    }
+}
+
+// Memory-bound streaming: every worker sums its own buffer, which it first touched itself so its pages
+// live on the worker's NUMA node. Unpinned workers may migrate away from their pages between passes.
+COMMON_API_BENCHMARK(AffinityMemoryStreaming)
+{
+    const size_t maxThreads = std::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+    const size_t wordCount = s_bufferBytes / sizeof(uint64_t);
+    std::atomic<uint64_t> sink = 0;
+
+    out << "GB/s streamed, " << (s_bufferBytes >> 20) << " MiB per worker\n";
+    out << std::fixed << std::setprecision(2);
+
+    for (size_t threads : Benchmarks::threadCounts(maxThreads)) {
+        for (auto policy : { Pool::AffinityPolicy::None, Pool::AffinityPolicy::Compact, Pool::AffinityPolicy::Scatter }) {
+            Pool pool;
+            pool.init(threads, std::cerr, Pool::Options{
+                .affinity = policy,
+                .numaLocalMemory = policy != Pool::AffinityPolicy::None,
+                .threadName = "Streaming"
+                });
+
+            std::vector<std::vector<uint64_t>> buffers(threads);
+            for (size_t i = 0; i < threads; ++i)
+                pool.postTask([&]() {
+                    auto& buffer = buffers[pool.getCurrentThreadIndex()];
+                    if (buffer.empty()) buffer.assign(wordCount, 1);
+                });
+            pool.waitIdle();
+            // A worker may have run none of the first touch tasks
+            for (auto& buffer : buffers) if (buffer.empty()) buffer.assign(wordCount, 1);
+
+            double seconds = Benchmarks::measureSeconds([&]() {
+                for (size_t i = 0; i < threads * s_passesPerWorker; ++i)
+                    pool.postTask([&]() {
+                        const auto& buffer = buffers[pool.getCurrentThreadIndex()];
+                        uint64_t sum = 0;
+                        for (uint64_t word : buffer) sum += word;
+                        sink.fetch_add(sum, std::memory_order_relaxed);
+                    });
+                pool.waitIdle();
+            });
+
+            double bytes = double(s_bufferBytes) * threads * s_passesPerWorker;
+            out << std::setw(3) << threads << " threads  " << policyName(policy)
+                << "  " << std::setw(8) << bytes / seconds / 1e9 << "\n";
+        }
+    }
+    Benchmarks::doNotOptimize(sink.load());
+}
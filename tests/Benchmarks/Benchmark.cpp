@@ -0,0 +1,34 @@
+#include "Benchmark.h"
+
+namespace Benchmarks
+{
+    std::vector<Entry>& registry() {
+        static std::vector<Entry> entries;
+        return entries;
+    }
+
+    int run(std::string_view filter, std::ostream& out) {
+        size_t ran = 0;
+        for (const auto& entry : registry()) {
+            if (!filter.empty() && std::string_view(entry.name).find(filter) == std::string_view::npos)
+                continue;
+            out << "== " << entry.name << " ==\n";
+            entry.function(out);
+            out << std::endl;
+            ++ran;
+        }
+        if (ran == 0) {
+            out << "No benchmarks match \"" << filter << "\"" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::vector<size_t> threadCounts(size_t maxThreads) {
+        std::vector<size_t> counts;
+        if (maxThreads == 0) maxThreads = 1;
+        for (size_t count = 1; count < maxThreads; count *= 2) counts.push_back(count);
+        counts.push_back(maxThreads);
+        return counts;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+// Tiny benchmark registry for the test executable.
+// Benchmarks are only run when the executable is started with "--bench [filter]".
+namespace Benchmarks
+{
+    using Function = void(*)(std::ostream& out);
+
+    struct Entry {
+        const char* name;
+        Function function;
+    };
+
+    std::vector<Entry>& registry();
+
+    struct Registrar {
+        Registrar(const char* name, Function function) {
+            registry().push_back(Entry{ name, function });
+        }
+    };
+
+    // Runs every registered benchmark whose name contains filter (all if empty)
+    int run(std::string_view filter, std::ostream& out);
+
+    template<typename Callable>
+    inline double measureSeconds(Callable&& callable) {
+        auto start = std::chrono::steady_clock::now();
+        callable();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Prevents the optimizer from discarding a computed value
+    template<typename T>
+    inline void doNotOptimize(const T& value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        static volatile const void* sink;
+        sink = &value;
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    // Thread counts 1, 2, 4, ... up to and including maxThreads
+    std::vector<size_t> threadCounts(size_t maxThreads);
+}
+
+#define COMMON_API_BENCHMARK(name) \
+    static void name(std::ostream& out); \
+    static const ::Benchmarks::Registrar name##Registrar(#name, &name); \
+    static void name(std::ostream& out)
@@ -0,0 +1,97 @@
+#include "Benchmark.h"
+
+#include "CommonApi/MultiThreading/ThreadPools/Coroutine.h"
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Pool = MultiThreading::MinimalThreadPool;
+    template<typename T = void>
+    using Task = MultiThreading::Task<T>;
+
+    constexpr size_t s_fanOutCount = 1 << 14;
+    constexpr size_t s_offloadCount = 1 << 12;
+
+    inline uint64_t work(uint64_t seed) {
+        for (int i = 0; i < 64; ++i) seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return seed;
+    }
+
+    Task<uint64_t> scheduledWork(Pool& pool, uint64_t seed) {
+        co_await pool.schedule();
+        co_return work(seed);
+    }
+
+    Task<uint64_t> fanOut(Pool& pool) {
+        std::vector<Task<uint64_t>> tasks;
+        tasks.reserve(s_fanOutCount);
+        for (size_t i = 0; i < s_fanOutCount; ++i) tasks.push_back(scheduledWork(pool, i));
+        uint64_t sum = 0;
+        for (uint64_t value : co_await MultiThreading::whenAll(std::move(tasks))) sum += value;
+        co_return sum;
+    }
+
+    // Every round trip hops to the blocking pool and back to the compute pool
+    Task<uint64_t> offloadChain(Pool& compute, Pool& blocking) {
+        co_await compute.schedule();
+        uint64_t value = 0;
+        for (size_t i = 0; i < s_offloadCount; ++i) value = co_await MultiThreading::offload(blocking, [value]() { return work(value); });
+        co_return value;
+    }
+
+    Task<void> countDown(Pool& pool, std::atomic<size_t>& done) {
+        co_await pool.schedule();
+        done.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Fan-out of small jobs as coroutines joined by whenAll against submit and Future::get,
+// plus offload round trips between two pools and detached spawns
+COMMON_API_BENCHMARK(CoroutineFanOut)
+{
+    const size_t threads = std::max<unsigned int>(std::thread::hardware_concurrency(), 2);
+    Pool pool, blocking;
+    pool.init(threads, std::cerr);
+    blocking.init(2, std::cerr);
+
+    uint64_t expected = 0;
+    for (size_t i = 0; i < s_fanOutCount; ++i) expected += work(i);
+
+    uint64_t futureSum = 0;
+    double futures = Benchmarks::measureSeconds([&]() {
+        std::vector<Pool::Future<uint64_t>> results;
+        results.reserve(s_fanOutCount);
+        for (size_t i = 0; i < s_fanOutCount; ++i) results.push_back(pool.submit([i]() { return work(i); }));
+        for (auto& result : results) futureSum += result.get();
+    });
+
+    uint64_t coroutineSum = 0;
+    double coroutines = Benchmarks::measureSeconds([&]() { coroutineSum = MultiThreading::syncWait(fanOut(pool)); });
+    if (futureSum != expected || coroutineSum != expected) out << "fan-out mismatch\n";
+
+    double offloads = Benchmarks::measureSeconds([&]() { Benchmarks::doNotOptimize(MultiThreading::syncWait(offloadChain(pool, blocking))); });
+
+    std::atomic<size_t> done = 0;
+    double spawns = Benchmarks::measureSeconds([&]() {
+        for (size_t i = 0; i < s_fanOutCount; ++i) MultiThreading::spawn(pool, countDown(pool, done));
+        while (done.load(std::memory_order_relaxed) != s_fanOutCount) std::this_thread::yield();
+    });
+
+    std::vector<Task<uint64_t>> racers;
+    for (uint64_t i = 0; i < 4; ++i) racers.push_back(scheduledWork(pool, i));
+    auto first = MultiThreading::syncWait(MultiThreading::whenAny(std::move(racers)));
+    if (first.value != work(first.index)) out << "whenAny mismatch\n";
+    pool.waitIdle();
+
+    out << std::fixed << std::setprecision(2);
+    out << s_fanOutCount << " jobs on " << threads << " threads, ms\n";
+    out << "submit + Future::get " << std::setw(8) << futures * 1000 << "\n";
+    out << "whenAll coroutines   " << std::setw(8) << coroutines * 1000 << "\n";
+    out << "spawn                " << std::setw(8) << spawns * 1000 << "\n";
+    out << s_offloadCount << " offload round trips " << std::setw(8) << offloads * 1000 << "\n";
+}
@@ -0,0 +1,95 @@
+#include "Benchmark.h"
+
+#include "CommonApi/MultiThreading/ConcurrentHashMap.h"
+#include "CommonApi/MultiThreading/Synchronized.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t s_operationCount = 1 << 20;
+    constexpr uint64_t s_keyCount = 1 << 16;
+
+    struct SynchronizedMap {
+        MultiThreading::Synchronized<std::unordered_map<uint64_t, uint64_t>> map;
+
+        inline bool find(uint64_t key) {
+            auto access = map.getReadAccess();
+            return access->find(key) != access->end();
+        }
+        inline void insert(uint64_t key) { (*map.getWriteAccess())[key] = key; }
+        inline void erase(uint64_t key) { map.getWriteAccess()->erase(key); }
+    };
+
+    struct ShardedMap {
+        MultiThreading::ConcurrentHashMap<uint64_t, uint64_t> map{ s_keyCount };
+
+        inline bool find(uint64_t key) { return map.find(key) != nullptr; }
+        inline void insert(uint64_t key) { map.insertOrAssign(key, key); }
+        inline void erase(uint64_t key) { map.erase(key); }
+    };
+
+    // Every thread runs its share of s_operationCount random operations on a map prefilled with half
+    // of the keys: readPercent finds, the rest split evenly between inserts and erases.
+    // Returns millions of operations per second.
+    template<typename Map>
+    double measure(size_t threadCount, unsigned readPercent) {
+        Map map;
+        for (uint64_t key = 0; key < s_keyCount; key += 2) map.insert(key);
+
+        std::atomic<bool> start = false;
+        std::atomic<size_t> found = 0;
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < threadCount; ++i)
+            threads.emplace_back([&, i]() {
+                uint64_t state = 0x9E3779B97F4A7C15ull * (i + 1);
+                size_t hits = 0;
+                while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+                for (size_t operation = 0; operation < s_operationCount / threadCount; ++operation) {
+                    state = state * 6364136223846793005ull + 1442695040888963407ull;
+                    uint64_t key = (state >> 33) % s_keyCount;
+                    unsigned roll = (state >> 20) % 100;
+                    if (roll < readPercent) hits += map.find(key);
+                    else if (roll % 2) map.insert(key);
+                    else map.erase(key);
+                }
+                found.fetch_add(hits, std::memory_order_relaxed);
+            });
+
+        auto begin = Clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto& thread : threads) thread.join();
+        Benchmarks::doNotOptimize(found.load());
+        return s_operationCount / std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+    }
+
+    void compare(std::ostream& out, unsigned readPercent) {
+        out << std::fixed << std::setprecision(2);
+        out << s_operationCount << " operations, " << readPercent << "% finds, " << s_keyCount
+            << " keys, million operations per second\n";
+        out << "threads   Synchronized<unordered_map>   ConcurrentHashMap\n";
+        for (size_t threads : { 1, 4, 16 })
+            out << std::setw(7) << threads << std::setw(30) << measure<SynchronizedMap>(threads, readPercent)
+                << std::setw(20) << measure<ShardedMap>(threads, readPercent) << "\n";
+    }
+}
+
+// Lookup table use: almost every operation is a find
+COMMON_API_BENCHMARK(HashMapReadHeavy)
+{
+    compare(out, 95);
+}
+
+// Churn: most operations insert or erase
+COMMON_API_BENCHMARK(HashMapWriteHeavy)
+{
+    compare(out, 20);
+}
@@ -0,0 +1,122 @@
+#include "Benchmark.h"
+
+#include "CommonApi/MultiThreading/ThreadPools/Parallel.h"
+
+#include <functional>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Pool = MultiThreading::MinimalThreadPool;
+
+    constexpr size_t s_volumeSize = 96;     // a 96^3 block of voxels
+    constexpr size_t s_skewedCount = 1 << 16;
+    constexpr size_t s_manualBatchCount = 256;
+
+    // Stand-in for evaluating one voxel of a density field
+    inline float voxelWork(size_t x, size_t y, size_t z) {
+        uint64_t seed = (x * 73856093) ^ (y * 19349663) ^ (z * 83492791);
+        for (int i = 0; i < 16; ++i) seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<float>(seed >> 40) * (1.0f / (1 << 24));
+    }
+
+    // Cost grows with the index, so equal static splits leave most threads idle
+    inline uint64_t skewedWork(size_t i) {
+        uint64_t seed = i;
+        for (size_t j = 0; j < 1 + i / 512; ++j) seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return seed;
+    }
+
+    const char* modeName(Pool::SchedulerMode mode) {
+        return mode == Pool::SchedulerMode::GlobalQueue ? "global queue " : "work stealing";
+    }
+
+    // The pre parallelFor approach: cut the range into a fixed number of batches and wait for the pool
+    template<typename Body>
+    void manualBatches(Pool& pool, size_t count, Body body) {
+        std::vector<std::function<void()>> tasks;
+        tasks.reserve(s_manualBatchCount);
+        const size_t batch = (count + s_manualBatchCount - 1) / s_manualBatchCount;
+        for (size_t begin = 0; begin < count; begin += batch) {
+            size_t end = std::min(count, begin + batch);
+            tasks.emplace_back([&body, begin, end]() { for (size_t i = begin; i < end; ++i) body(i); });
+        }
+        pool.postTasks(tasks);
+        pool.waitIdle();
+    }
+}
+
+COMMON_API_BENCHMARK(ParallelForVoxels)
+{
+    const size_t maxThreads = std::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+    const size_t volume = s_volumeSize * s_volumeSize * s_volumeSize;
+    std::vector<float> density(volume);
+
+    auto voxel = [&](size_t i) {
+        size_t x = i / (s_volumeSize * s_volumeSize), y = (i / s_volumeSize) % s_volumeSize, z = i % s_volumeSize;
+        density[i] = voxelWork(x, y, z);
+    };
+
+    double serial = Benchmarks::measureSeconds([&]() { for (size_t i = 0; i < volume; ++i) voxel(i); });
+    out << "ms for " << s_volumeSize << "^3 voxels, serial " << std::fixed << std::setprecision(2) << serial * 1000 << "\n";
+
+    for (size_t threads : Benchmarks::threadCounts(maxThreads)) {
+        for (auto mode : { Pool::SchedulerMode::GlobalQueue, Pool::SchedulerMode::WorkStealing }) {
+            Pool pool;
+            pool.init(threads, std::cerr, Pool::Options{ .schedulerMode = mode });
+
+            double manual = Benchmarks::measureSeconds([&]() { manualBatches(pool, volume, voxel); });
+            double parallel = Benchmarks::measureSeconds([&]() {
+                MultiThreading::parallelFor3d(pool, s_volumeSize, s_volumeSize, s_volumeSize,
+                    [&](size_t x, size_t y, size_t z, size_t) {
+                        density[(x * s_volumeSize + y) * s_volumeSize + z] = voxelWork(x, y, z);
+                    });
+            });
+
+            out << std::setw(3) << threads << " threads  " << modeName(mode)
+                << "  postTasks " << std::setw(8) << manual * 1000
+                << "  parallelFor3d " << std::setw(8) << parallel * 1000 << "\n";
+        }
+    }
+    Benchmarks::doNotOptimize(density.data());
+}
+
+COMMON_API_BENCHMARK(ParallelForSkewed)
+{
+    const size_t maxThreads = std::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+    std::vector<uint64_t> results(s_skewedCount);
+    auto item = [&](size_t i) { results[i] = skewedWork(i); };
+
+    uint64_t serialSum = 0;
+    double serial = Benchmarks::measureSeconds([&]() {
+        for (size_t i = 0; i < s_skewedCount; ++i) serialSum += skewedWork(i);
+    });
+    out << "ms for " << s_skewedCount << " items of growing cost, serial " << std::fixed << std::setprecision(2)
+        << serial * 1000 << "\n";
+
+    for (size_t threads : Benchmarks::threadCounts(maxThreads)) {
+        for (auto mode : { Pool::SchedulerMode::GlobalQueue, Pool::SchedulerMode::WorkStealing }) {
+            Pool pool;
+            pool.init(threads, std::cerr, Pool::Options{ .schedulerMode = mode });
+
+            double manual = Benchmarks::measureSeconds([&]() { manualBatches(pool, s_skewedCount, item); });
+            double parallel = Benchmarks::measureSeconds([&]() {
+                MultiThreading::parallelFor(pool, 0, s_skewedCount, [&](size_t i, size_t) { item(i); });
+            });
+            uint64_t sum = 0;
+            double reduce = Benchmarks::measureSeconds([&]() {
+                sum = MultiThreading::parallelReduce(pool, 0, s_skewedCount, uint64_t(0),
+                    [](size_t i, size_t) { return skewedWork(i); }, std::plus<uint64_t>());
+            });
+            if (sum != serialSum) out << "parallelReduce mismatch\n";
+
+            out << std::setw(3) << threads << " threads  " << modeName(mode)
+                << "  postTasks " << std::setw(8) << manual * 1000
+                << "  parallelFor " << std::setw(8) << parallel * 1000
+                << "  parallelReduce " << std::setw(8) << reduce * 1000 << "\n";
+        }
+    }
+    Benchmarks::doNotOptimize(results.data());
+}
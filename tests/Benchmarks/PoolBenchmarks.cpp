@@ -0,0 +1,183 @@
+#include "Benchmark.h"
+
+#include "CommonApi/MultiThreading/HandlePool.h"
+#include "CommonApi/MultiThreading/MemoryPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t s_allocationCount = 1 << 20;
+    constexpr size_t s_liveObjects = 64;
+    constexpr size_t s_copyCount = 1 << 22;
+    constexpr size_t s_sharedObjects = 256;
+    constexpr size_t s_entityCount = 1 << 16;
+    constexpr size_t s_updatePasses = 64;
+
+    struct Particle {
+        double position[3] = {};
+        double velocity[3] = {};
+        uint64_t id = 0;
+    };
+
+    inline void integrate(Particle& particle) {
+        for (int axis = 0; axis < 3; ++axis) particle.position[axis] += particle.velocity[axis] * 0.01;
+    }
+
+    // Runs update s_updatePasses times, returns millions of objects updated per second
+    template<typename Update>
+    double measureUpdates(Update update) {
+        auto begin = Clock::now();
+        for (size_t pass = 0; pass < s_updatePasses; ++pass) update();
+        return s_entityCount * s_updatePasses / std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+    }
+
+    // Every thread repeatedly allocates s_liveObjects objects and frees them again until the threads
+    // together made s_allocationCount allocations. Returns millions of allocate/free pairs per second.
+    template<typename Allocate>
+    double measure(size_t threadCount, Allocate allocate) {
+        std::atomic<bool> start = false;
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < threadCount; ++i)
+            threads.emplace_back([&]() {
+                using Pointer = decltype(allocate());
+                std::vector<Pointer> live;
+                live.reserve(s_liveObjects);
+                while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+                for (size_t done = 0; done < s_allocationCount / threadCount; done += s_liveObjects) {
+                    for (size_t j = 0; j < s_liveObjects; ++j) live.push_back(allocate());
+                    Benchmarks::doNotOptimize(live.back()->id);
+                    live.clear();
+                }
+            });
+
+        auto begin = Clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto& thread : threads) thread.join();
+        return s_allocationCount / std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+    }
+
+    // Every thread copies the same s_sharedObjects pointers into a local vector and drops the copies
+    // again until the threads together made s_copyCount copies. Returns millions of copy/drop pairs per second.
+    template<typename Pointer>
+    double measureCopies(size_t threadCount, const std::vector<Pointer>& shared) {
+        std::atomic<bool> start = false;
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < threadCount; ++i)
+            threads.emplace_back([&]() {
+                std::vector<Pointer> copies;
+                copies.reserve(shared.size());
+                while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+                for (size_t done = 0; done < s_copyCount / threadCount; done += shared.size()) {
+                    copies.assign(shared.begin(), shared.end());
+                    Benchmarks::doNotOptimize(copies.back()->id);
+                    copies.clear();
+                }
+            });
+
+        auto begin = Clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto& thread : threads) thread.join();
+        return s_copyCount / std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+    }
+}
+
+// Allocate/free throughput of the pool against the global allocator
+COMMON_API_BENCHMARK(MemoryPoolThroughput)
+{
+    out << std::fixed << std::setprecision(2);
+    out << s_allocationCount << " allocations of " << sizeof(Particle) << " bytes, " << s_liveObjects
+        << " live per thread, million allocate/free pairs per second\n";
+    out << "threads   new/delete   MemoryPool slabs   MemoryPool single slab\n";
+
+    for (size_t threads : Benchmarks::threadCounts(32)) {
+        double global = measure(threads, []() { return std::make_unique<Particle>(); });
+
+        // Growing pools cache slots per thread
+        MultiThreading::MemoryPool<Particle> slabs(MultiThreading::MemoryPool<Particle>::SlabOptions{ 4096, 1024, 1 });
+        double cached = measure(threads, [&]() { return slabs.makeUnique(); });
+
+        // A single slab shares every slot through the lock-free stack
+        MultiThreading::MemoryPool<Particle> single(static_cast<unsigned int>(threads * s_liveObjects));
+        double shared = measure(threads, [&]() { return single.makeUnique(); });
+
+        out << std::setw(7) << threads << std::setw(13) << global << std::setw(19) << cached << std::setw(25) << shared << "\n";
+    }
+}
+
+// Reference count traffic: copying and dropping pointers to objects all threads share
+COMMON_API_BENCHMARK(SharedPointerCopies)
+{
+    using PoolPointer = MultiThreading::MemoryPool<Particle>::SharedPointer;
+
+    std::vector<std::shared_ptr<Particle>> standard;
+    MultiThreading::MemoryPool<Particle> pool(static_cast<unsigned int>(s_sharedObjects));
+    std::vector<PoolPointer> pooled;
+    for (size_t i = 0; i < s_sharedObjects; ++i) {
+        standard.push_back(std::make_shared<Particle>());
+        pooled.push_back(pool.makeShared());
+    }
+
+    out << std::fixed << std::setprecision(2);
+    out << s_copyCount << " copies of " << s_sharedObjects << " shared objects, pointer size "
+        << sizeof(std::shared_ptr<Particle>) << " and " << sizeof(PoolPointer) << " bytes, million copy/drop pairs per second\n";
+    out << "threads   std::shared_ptr   MemoryPool::SharedPointer\n";
+    for (size_t threads : { 1, 4, 16 })
+        out << std::setw(7) << threads << std::setw(18) << measureCopies(threads, standard)
+            << std::setw(28) << measureCopies(threads, pooled) << "\n";
+}
+
+// Systems update: touching every live entity, stored as handles or as shared pointers. Both hold
+// s_entityCount objects after a round of random erases and inserts, as a running game would.
+COMMON_API_BENCHMARK(HandlePoolIteration)
+{
+    using Pool = MultiThreading::MemoryPool<Particle>;
+    using Handles = MultiThreading::HandlePool<Particle>;
+
+    Pool pool(Pool::SlabOptions{ 4096, 64, 1 });
+    std::vector<Pool::SharedPointer> pointers;
+    Handles handles(Handles::SlabOptions{ 4096, 64, 1 });
+    std::vector<Handles::Handle> issued;
+    for (size_t i = 0; i < s_entityCount; ++i) {
+        Particle particle{ {}, { 1.0, 2.0, 3.0 }, i };
+        pointers.push_back(pool.makeShared(particle));
+        issued.push_back(handles.insert(particle));
+    }
+
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < s_entityCount / 2; ++i) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        size_t victim = (state >> 33) % s_entityCount;
+        Particle particle{ {}, { 1.0, 2.0, 3.0 }, s_entityCount + i };
+        pointers[victim] = nullptr;
+        pointers[victim] = pool.makeShared(particle);
+        handles.erase(issued[victim]);
+        issued[victim] = handles.insert(particle);
+    }
+
+    double walked = measureUpdates([&]() {
+        for (auto& pointer : pointers) integrate(*pointer);
+    });
+    double dense = measureUpdates([&]() {
+        handles.forEach([](Particle& particle) { integrate(particle); });
+    });
+    double lookedUp = measureUpdates([&]() {
+        for (auto handle : issued) integrate(*handles.find(handle));
+    });
+    Benchmarks::doNotOptimize(pointers.front()->position[0] + handles.at(issued.front()).position[0]);
+
+    out << std::fixed << std::setprecision(2);
+    out << s_entityCount << " entities of " << sizeof(Particle) << " bytes, " << s_updatePasses
+        << " passes, million entities updated per second\n";
+    out << "SharedPointer walk   HandlePool::forEach   HandlePool lookups   forEach / walk\n";
+    out << std::setw(18) << walked << std::setw(22) << dense << std::setw(21) << lookedUp
+        << std::setw(16) << dense / walked << "\n";
+}
@@ -0,0 +1,155 @@
+#include "Benchmark.h"
+
+#include "CommonApi/MultiThreading/BlockingBoundedQueue.h"
+#include "CommonApi/MultiThreading/Queue.h"
+#include "CommonApi/MultiThreading/SpscRing.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t s_itemCount = 1 << 20;
+    constexpr size_t s_capacity = 1024;
+    constexpr size_t s_batchSize = 32;
+
+    // Producers push s_itemCount items in total, consumers pop their share of them.
+    // Returns millions of items per second.
+    template<typename Produce, typename Consume>
+    double measure(size_t producers, size_t consumers, Produce produce, Consume consume) {
+        std::atomic<bool> start = false;
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < producers; ++i)
+            threads.emplace_back([&, i]() {
+                while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+                produce(s_itemCount / producers + (i < s_itemCount % producers));
+            });
+        for (size_t i = 0; i < consumers; ++i)
+            threads.emplace_back([&, i]() {
+                while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+                consume(s_itemCount / consumers + (i < s_itemCount % consumers));
+            });
+
+        auto begin = Clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto& thread : threads) thread.join();
+        return s_itemCount / std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+    }
+}
+
+// Throughput of the mutex queue against the lock-free bounded queue, one item at a time and in batches.
+// The mutex queue is unbounded, so unlike the blocking bounded queue its producers never wait for room.
+COMMON_API_BENCHMARK(QueueThroughput)
+{
+    out << std::fixed << std::setprecision(2);
+    out << s_itemCount << " items, million items per second\n";
+    out << "               mutex queue   bounded   bounded batched   blocking bounded\n";
+
+    for (size_t threads : { 1, 4, 16 }) {
+        double mutexQueue, bounded, batched, blocking;
+        {
+            MultiThreading::Queue<uint64_t> queue;
+            mutexQueue = measure(threads, threads,
+                [&](size_t count) { for (size_t i = 0; i < count; ++i) queue.push(i); },
+                [&](size_t count) { uint64_t value; for (size_t i = 0; i < count; ++i) queue.waitAndPop(value); });
+        }
+        {
+            MultiThreading::BoundedQueue<uint64_t> queue(s_capacity);
+            bounded = measure(threads, threads,
+                [&](size_t count) { for (size_t i = 0; i < count; ++i) while (!queue.tryPush(i)) std::this_thread::yield(); },
+                [&](size_t count) { uint64_t value; for (size_t i = 0; i < count; ++i) while (!queue.tryPop(value)) std::this_thread::yield(); });
+        }
+        {
+            MultiThreading::BoundedQueue<uint64_t> queue(s_capacity);
+            batched = measure(threads, threads,
+                [&](size_t count) {
+                    std::array<uint64_t, s_batchSize> items{};
+                    for (size_t pushed = 0; pushed < count;) {
+                        size_t batch = queue.pushN(items.begin(), std::min(s_batchSize, count - pushed));
+                        if (batch == 0) std::this_thread::yield();
+                        pushed += batch;
+                    }
+                },
+                [&](size_t count) {
+                    std::array<uint64_t, s_batchSize> items;
+                    for (size_t popped = 0; popped < count;) {
+                        size_t batch = queue.popN(items.begin(), std::min(s_batchSize, count - popped));
+                        if (batch == 0) std::this_thread::yield();
+                        popped += batch;
+                    }
+                });
+        }
+        {
+            MultiThreading::BlockingBoundedQueue<uint64_t> queue(s_capacity);
+            blocking = measure(threads, threads,
+                [&](size_t count) { for (size_t i = 0; i < count; ++i) queue.push(i); },
+                [&](size_t count) { uint64_t value; for (size_t i = 0; i < count; ++i) queue.pop(value); });
+        }
+
+        out << std::setw(3) << threads << "P" << std::setw(2) << threads << "C  " << std::setw(12) << mutexQueue
+            << std::setw(10) << bounded << std::setw(18) << batched << std::setw(19) << blocking << "\n";
+    }
+}
+
+// One producer and one consumer: the mutex queue, the MPMC bounded queue, and the SPSC ring
+// one item at a time and written and read in place
+COMMON_API_BENCHMARK(SpscThroughput)
+{
+    double mutexQueue, bounded, ring, ringInPlace;
+    {
+        MultiThreading::Queue<uint64_t> queue;
+        mutexQueue = measure(1, 1,
+            [&](size_t count) { for (size_t i = 0; i < count; ++i) queue.push(i); },
+            [&](size_t count) { uint64_t value; for (size_t i = 0; i < count; ++i) queue.waitAndPop(value); });
+    }
+    {
+        MultiThreading::BoundedQueue<uint64_t> queue(s_capacity);
+        bounded = measure(1, 1,
+            [&](size_t count) { for (size_t i = 0; i < count; ++i) while (!queue.tryPush(i)) std::this_thread::yield(); },
+            [&](size_t count) { uint64_t value; for (size_t i = 0; i < count; ++i) while (!queue.tryPop(value)) std::this_thread::yield(); });
+    }
+    {
+        MultiThreading::SpscRing<uint64_t> queue(s_capacity);
+        ring = measure(1, 1,
+            [&](size_t count) { for (size_t i = 0; i < count; ++i) while (!queue.tryPush(i)) std::this_thread::yield(); },
+            [&](size_t count) { uint64_t value; for (size_t i = 0; i < count; ++i) while (!queue.tryPop(value)) std::this_thread::yield(); });
+    }
+    uint64_t checksum = 0;
+    {
+        MultiThreading::SpscRing<uint64_t> queue(s_capacity);
+        ringInPlace = measure(1, 1,
+            [&](size_t count) {
+                for (size_t written = 0; written < count;) {
+                    std::span<uint64_t> slots = queue.reserve(std::min(s_batchSize, count - written));
+                    if (slots.empty()) std::this_thread::yield();
+                    for (uint64_t& slot : slots) slot = written++;
+                    queue.commit(slots.size());
+                }
+            },
+            [&](size_t count) {
+                for (size_t read = 0; read < count;) {
+                    std::span<const uint64_t> items = queue.peek(s_batchSize);
+                    if (items.empty()) std::this_thread::yield();
+                    for (uint64_t item : items) checksum += item;
+                    read += items.size();
+                    queue.release(items.size());
+                }
+            });
+    }
+
+    out << std::fixed << std::setprecision(2);
+    out << s_itemCount << " items, 1P1C, million items per second\n";
+    out << "mutex queue              " << std::setw(8) << mutexQueue << "\n";
+    out << "bounded MPMC queue       " << std::setw(8) << bounded << "\n";
+    out << "SPSC ring                " << std::setw(8) << ring << "\n";
+    out << "SPSC ring reserve/peek   " << std::setw(8) << ringInPlace << "  (checksum " << checksum << ")\n";
+}
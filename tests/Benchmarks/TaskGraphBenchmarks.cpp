@@ -0,0 +1,81 @@
+#include "Benchmark.h"
+
+#include "CommonApi/MultiThreading/ThreadPools/TaskGraph.h"
+
+#include <atomic>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Pool = MultiThreading::MinimalThreadPool;
+
+    constexpr size_t s_chunkCount = 64;
+    constexpr size_t s_stageCount = 4;      // noise, meshing, broadphase, lighting
+    constexpr size_t s_frameCount = 200;
+
+    // Later stages are cheaper, and every chunk is a little different, as in a real frame
+    inline uint64_t stageWork(size_t stage, size_t chunk) {
+        uint64_t seed = stage * 131 + chunk;
+        const size_t steps = 2000 / (stage + 1) + (chunk % 7) * 150;
+        for (size_t i = 0; i < steps; ++i) seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return seed;
+    }
+
+    const char* modeName(Pool::SchedulerMode mode) {
+        return mode == Pool::SchedulerMode::GlobalQueue ? "global queue " : "work stealing";
+    }
+}
+
+COMMON_API_BENCHMARK(TaskGraphFramePipeline)
+{
+    const size_t maxThreads = std::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+    std::atomic<uint64_t> sink = 0;
+
+    // A chunk's stage depends on its own and its left neighbour's previous stage
+    MultiThreading::TaskGraph graph;
+    std::vector<MultiThreading::TaskGraph::NodeId> previous, current;
+    for (size_t stage = 0; stage < s_stageCount; ++stage) {
+        current.clear();
+        for (size_t chunk = 0; chunk < s_chunkCount; ++chunk) {
+            current.push_back(graph.addNode([&sink, stage, chunk]() {
+                sink.fetch_add(stageWork(stage, chunk), std::memory_order_relaxed);
+            }));
+            if (stage == 0) continue;
+            graph.addDependency(previous[chunk], current.back());
+            if (chunk > 0) graph.addDependency(previous[chunk - 1], current.back());
+        }
+        std::swap(previous, current);
+    }
+
+    out << "ms per frame, " << s_chunkCount << " chunks through " << s_stageCount << " stages\n";
+    out << std::fixed << std::setprecision(3);
+
+    for (size_t threads : Benchmarks::threadCounts(maxThreads)) {
+        for (auto mode : { Pool::SchedulerMode::GlobalQueue, Pool::SchedulerMode::WorkStealing }) {
+            Pool pool;
+            pool.init(threads, std::cerr, Pool::Options{ .schedulerMode = mode });
+
+            double barriers = Benchmarks::measureSeconds([&]() {
+                for (size_t frame = 0; frame < s_frameCount; ++frame) {
+                    for (size_t stage = 0; stage < s_stageCount; ++stage) {
+                        for (size_t chunk = 0; chunk < s_chunkCount; ++chunk)
+                            pool.postTask([&sink, stage, chunk]() {
+                                sink.fetch_add(stageWork(stage, chunk), std::memory_order_relaxed);
+                            });
+                        pool.waitIdle();
+                    }
+                }
+            });
+            double graphed = Benchmarks::measureSeconds([&]() {
+                for (size_t frame = 0; frame < s_frameCount; ++frame) graph.run(pool);
+            });
+
+            out << std::setw(3) << threads << " threads  " << modeName(mode)
+                << "  waitIdle barriers " << std::setw(8) << barriers * 1000 / s_frameCount
+                << "  task graph " << std::setw(8) << graphed * 1000 / s_frameCount << "\n";
+        }
+    }
+    Benchmarks::doNotOptimize(sink.load());
+}
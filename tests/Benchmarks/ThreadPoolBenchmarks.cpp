@@ -0,0 +1,131 @@
+#include "Benchmark.h"
+
+#include "CommonApi/MultiThreading/ThreadPools/MinimalThreadPool.h"
+
+#include <atomic>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Pool = MultiThreading::MinimalThreadPool;
+
+    constexpr size_t s_flatTaskCount = 200000;
+    constexpr size_t s_rootTaskCount = 2000;
+    constexpr size_t s_childTaskCount = 100;
+
+    // Roughly the cost of a small chunk-generation step
+    inline uint64_t tinyWork(uint64_t seed) {
+        for (int i = 0; i < 64; ++i) seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return seed;
+    }
+
+    const char* modeName(Pool::SchedulerMode mode) {
+        return mode == Pool::SchedulerMode::GlobalQueue ? "global queue " : "work stealing";
+    }
+
+    // Every task is submitted from the main thread
+    double runFlat(Pool& pool, std::atomic<uint64_t>& sink) {
+        return Benchmarks::measureSeconds([&]() {
+            for (size_t i = 0; i < s_flatTaskCount; ++i)
+                pool.postTask([&sink, i]() { sink.fetch_add(tinyWork(i), std::memory_order_relaxed); });
+            pool.waitIdle();
+        });
+    }
+
+    // Tasks spawn their own subtasks, as chunk generation does for its sections
+    double runNested(Pool& pool, std::atomic<uint64_t>& sink) {
+        return Benchmarks::measureSeconds([&]() {
+            for (size_t i = 0; i < s_rootTaskCount; ++i)
+                pool.postTask([&pool, &sink, i]() {
+                    for (size_t j = 0; j < s_childTaskCount; ++j)
+                        pool.postTask([&sink, i, j]() { sink.fetch_add(tinyWork(i ^ j), std::memory_order_relaxed); });
+                });
+            pool.waitIdle();
+        });
+    }
+}
+
+COMMON_API_BENCHMARK(ThreadPoolSchedulerScaling)
+{
+    std::atomic<uint64_t> sink = 0;
+    const size_t maxThreads = std::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+
+    out << "tasks/sec, flat = " << s_flatTaskCount << " tasks pushed by one thread, nested = "
+        << s_rootTaskCount << " tasks pushing " << s_childTaskCount << " subtasks each\n";
+    out << std::fixed << std::setprecision(0);
+
+    for (size_t threads : Benchmarks::threadCounts(maxThreads)) {
+        for (auto mode : { Pool::SchedulerMode::GlobalQueue, Pool::SchedulerMode::WorkStealing }) {
+            Pool pool;
+            pool.init(threads, std::cerr, Pool::Options{ .schedulerMode = mode });
+
+            double flat = runFlat(pool, sink);
+            double nested = runNested(pool, sink);
+            const double nestedTasks = static_cast<double>(s_rootTaskCount * (s_childTaskCount + 1));
+
+            out << std::setw(3) << threads << " threads  " << modeName(mode)
+                << "  flat " << std::setw(12) << s_flatTaskCount / flat
+                << "  nested " << std::setw(12) << nestedTasks / nested << "\n";
+        }
+    }
+    Benchmarks::doNotOptimize(sink.load());
+}
+
+namespace
+{
+    constexpr size_t s_bulkTaskCount = 10000;
+    constexpr size_t s_bulkRoundCount = 20;
+
+    // Stands in for a chunk generation task, large enough that std::function would allocate
+    struct ChunkTask {
+        std::atomic<uint64_t>* sink;
+        uint64_t seed;
+        uint64_t padding[3];
+
+        void operator()() const { sink->fetch_add(tinyWork(seed), std::memory_order_relaxed); }
+    };
+}
+
+COMMON_API_BENCHMARK(ThreadPoolBulkSubmission)
+{
+    std::atomic<uint64_t> sink = 0;
+    const size_t maxThreads = std::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+
+    out << "us per " << s_bulkTaskCount << " tasks, submit = until the push returns, total = until waitIdle returns\n";
+    out << std::fixed << std::setprecision(1);
+
+    std::vector<ChunkTask> tasks(s_bulkTaskCount);
+    for (size_t i = 0; i < tasks.size(); ++i) tasks[i] = ChunkTask{ &sink, i, {} };
+
+    for (size_t threads : Benchmarks::threadCounts(maxThreads)) {
+        for (auto mode : { Pool::SchedulerMode::GlobalQueue, Pool::SchedulerMode::WorkStealing }) {
+            Pool pool;
+            pool.init(threads, std::cerr, Pool::Options{ .schedulerMode = mode });
+
+            double loopSubmit = 0, loopTotal = 0, bulkSubmit = 0, bulkTotal = 0;
+            for (size_t round = 0; round < s_bulkRoundCount; ++round) {
+                loopTotal += Benchmarks::measureSeconds([&]() {
+                    loopSubmit += Benchmarks::measureSeconds([&]() {
+                        for (const ChunkTask& task : tasks) pool.postTask(task);
+                    });
+                    pool.waitIdle();
+                });
+
+                bulkTotal += Benchmarks::measureSeconds([&]() {
+                    bulkSubmit += Benchmarks::measureSeconds([&]() {
+                        pool.postTasks(tasks);
+                    });
+                    pool.waitIdle();
+                });
+            }
+
+            const double scale = 1e6 / s_bulkRoundCount;
+            out << std::setw(3) << threads << " threads  " << modeName(mode)
+                << "  postTask loop submit " << std::setw(8) << loopSubmit * scale << " total " << std::setw(8) << loopTotal * scale
+                << "  postTasks submit " << std::setw(8) << bulkSubmit * scale << " total " << std::setw(8) << bulkTotal * scale << "\n";
+        }
+    }
+    Benchmarks::doNotOptimize(sink.load());
+}
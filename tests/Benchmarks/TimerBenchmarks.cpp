@@ -0,0 +1,129 @@
+#include "Benchmark.h"
+
+#include "CommonApi/MultiThreading/ThreadPools/MinimalThreadPool.h"
+#include "CommonApi/MultiThreading/ThreadPools/TimerWheel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Pool = MultiThreading::MinimalThreadPool;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t s_timerCount = 100000;
+    constexpr size_t s_lateTimerCount = 1000;
+
+    double nanosecondsPer(Clock::duration duration, size_t count) {
+        return std::chrono::duration<double, std::nano>(duration).count() / count;
+    }
+
+    double percentile(std::vector<double>& samples, double fraction) {
+        size_t index = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    }
+
+    // Deadlines between one second and one hour out in 1 ms ticks, in insertion order, and a random cancel order
+    void makeWorkload(std::vector<uint64_t>& deadlines, std::vector<size_t>& cancelOrder) {
+        std::mt19937_64 random(42);
+        std::uniform_int_distribution<uint64_t> deadline(1000, 3600000);
+        deadlines.resize(s_timerCount);
+        cancelOrder.resize(s_timerCount);
+        for (size_t i = 0; i < s_timerCount; ++i) {
+            deadlines[i] = deadline(random);
+            cancelOrder[i] = i;
+        }
+        std::shuffle(cancelOrder.begin(), cancelOrder.end(), random);
+    }
+}
+
+// Insert and cancel of 100k pending timers, the timer wheel against an ordered multimap
+COMMON_API_BENCHMARK(TimerWheelInsertCancel)
+{
+    std::vector<uint64_t> deadlines;
+    std::vector<size_t> cancelOrder;
+    makeWorkload(deadlines, cancelOrder);
+    out << std::fixed << std::setprecision(1);
+    out << s_timerCount << " timers, ns per insert / cancel\n";
+
+    {
+        MultiThreading::TimerWheel<uint32_t> wheel;
+        std::vector<MultiThreading::TimerWheel<uint32_t>::Handle> handles(s_timerCount);
+        // Second round reuses the freed nodes
+        for (int round = 0; round < 2; ++round) {
+            auto start = Clock::now();
+            for (size_t i = 0; i < s_timerCount; ++i) handles[i] = wheel.insert(deadlines[i], static_cast<uint32_t>(i));
+            auto inserted = Clock::now();
+            for (size_t i : cancelOrder) wheel.cancel(handles[i]);
+            auto cancelled = Clock::now();
+            if (round == 1)
+                out << "timer wheel  " << std::setw(8) << nanosecondsPer(inserted - start, s_timerCount)
+                    << " / " << std::setw(8) << nanosecondsPer(cancelled - inserted, s_timerCount) << "\n";
+        }
+    }
+
+    {
+        std::multimap<uint64_t, uint32_t> timers;
+        std::vector<std::multimap<uint64_t, uint32_t>::iterator> handles(s_timerCount);
+        for (int round = 0; round < 2; ++round) {
+            auto start = Clock::now();
+            for (size_t i = 0; i < s_timerCount; ++i) handles[i] = timers.emplace(deadlines[i], static_cast<uint32_t>(i));
+            auto inserted = Clock::now();
+            for (size_t i : cancelOrder) timers.erase(handles[i]);
+            auto cancelled = Clock::now();
+            if (round == 1)
+                out << "multimap     " << std::setw(8) << nanosecondsPer(inserted - start, s_timerCount)
+                    << " / " << std::setw(8) << nanosecondsPer(cancelled - inserted, s_timerCount) << "\n";
+        }
+    }
+}
+
+// Pool timers with 100k pending: cost of scheduleAfter and cancelTimer, and how late short timers
+// start their task while the long ones stay pending
+COMMON_API_BENCHMARK(ThreadPoolTimers)
+{
+    const size_t threads = std::max<size_t>(std::min<unsigned int>(std::thread::hardware_concurrency(), 4), 1);
+    std::vector<uint64_t> deadlines;
+    std::vector<size_t> cancelOrder;
+    makeWorkload(deadlines, cancelOrder);
+
+    Pool pool;
+    pool.init(threads, std::cerr);
+    std::vector<Pool::TimerHandle> handles(s_timerCount);
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < s_timerCount; ++i)
+        handles[i] = pool.scheduleAfter(std::chrono::milliseconds(deadlines[i]), []() {});
+    auto scheduled = Clock::now();
+
+    std::vector<double> lateness(s_lateTimerCount);
+    std::atomic<size_t> fired = 0;
+    Clock::time_point base = Clock::now();
+    for (size_t i = 0; i < s_lateTimerCount; ++i) {
+        Clock::time_point due = base + std::chrono::microseconds(250 * i);
+        pool.scheduleAt(due, [&lateness, &fired, due, i]() {
+            lateness[i] = std::chrono::duration<double, std::micro>(Clock::now() - due).count();
+            fired.fetch_add(1, std::memory_order_release);
+        });
+    }
+    while (fired.load(std::memory_order_acquire) < s_lateTimerCount) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    auto cancelStart = Clock::now();
+    for (size_t i : cancelOrder) pool.cancelTimer(handles[i]);
+    auto cancelled = Clock::now();
+
+    out << std::fixed << std::setprecision(1);
+    out << s_timerCount << " pending timers, " << threads << " threads\n";
+    out << "scheduleAfter " << std::setw(8) << nanosecondsPer(scheduled - start, s_timerCount) << " ns\n";
+    out << "cancelTimer   " << std::setw(8) << nanosecondsPer(cancelled - cancelStart, s_timerCount) << " ns\n";
+    out << "start lateness of " << s_lateTimerCount << " short timers in us, p50 / p99  "
+        << percentile(lateness, 0.5) << " / " << percentile(lateness, 0.99) << "\n";
+}
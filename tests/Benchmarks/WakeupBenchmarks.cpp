@@ -0,0 +1,73 @@
+#include "Benchmark.h"
+
+#include "CommonApi/MultiThreading/ThreadPools/MinimalThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Pool = MultiThreading::MinimalThreadPool;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t s_sampleCount = 2000;
+
+    const char* modeName(Pool::SchedulerMode mode) {
+        return mode == Pool::SchedulerMode::GlobalQueue ? "global queue " : "work stealing";
+    }
+
+    const char* policyName(Pool::WakeupPolicy policy) {
+        return policy == Pool::WakeupPolicy::Park ? "park          " : "spin then park";
+    }
+
+    // Busy waits, sleeping would put the producer itself through a wake-up
+    void pause(std::chrono::microseconds duration) {
+        auto end = Clock::now() + duration;
+        while (Clock::now() < end) {}
+    }
+
+    double percentile(std::vector<double>& samples, double fraction) {
+        size_t index = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    }
+}
+
+// Time from postTask until the task starts, for a single task pushed after the workers ran dry.
+// The gap is how long the pool was idle before the push.
+COMMON_API_BENCHMARK(ThreadPoolWakeupLatency)
+{
+    const size_t threads = std::max<size_t>(std::min<unsigned int>(std::thread::hardware_concurrency(), 4), 1);
+    std::vector<double> samples(s_sampleCount);
+
+    out << "push to start latency in us, " << threads << " threads, p50 / p99\n";
+    out << std::fixed << std::setprecision(2);
+
+    for (auto gap : { std::chrono::microseconds(5), std::chrono::microseconds(200) }) {
+        for (auto mode : { Pool::SchedulerMode::GlobalQueue, Pool::SchedulerMode::WorkStealing }) {
+            for (auto policy : { Pool::WakeupPolicy::Park, Pool::WakeupPolicy::SpinThenPark }) {
+                Pool pool;
+                pool.init(threads, std::cerr, Pool::Options{ .schedulerMode = mode, .wakeupPolicy = policy });
+
+                for (size_t i = 0; i < s_sampleCount; ++i) {
+                    pause(gap);
+                    std::atomic<bool> started = false;
+                    Clock::time_point pushed = Clock::now();
+                    pool.postTask([&samples, &started, pushed, i]() {
+                        samples[i] = std::chrono::duration<double, std::micro>(Clock::now() - pushed).count();
+                        started.store(true, std::memory_order_release);
+                    });
+                    while (!started.load(std::memory_order_acquire)) std::this_thread::yield();
+                }
+                pool.waitIdle();
+
+                out << "gap " << std::setw(4) << gap.count() << " us  " << modeName(mode) << "  " << policyName(policy)
+                    << "  " << std::setw(8) << percentile(samples, 0.5) << " / " << std::setw(8) << percentile(samples, 0.99) << "\n";
+            }
+        }
+    }
+}
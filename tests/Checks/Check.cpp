@@ -0,0 +1,91 @@
+#include "Check.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace
+{
+    std::atomic<size_t> s_failingScopes = 0;
+    std::atomic<size_t> s_refusedAllocations = 0;
+}
+
+// Replaced so that AlignedAllocationFailure can refuse them, the array and nothrow forms end up here
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (s_failingScopes.load() > 0) {
+        s_refusedAllocations.fetch_add(1);
+        throw std::bad_alloc();
+    }
+    size_t align = static_cast<size_t>(alignment);
+#ifdef _WIN32
+    void* memory = _aligned_malloc(size ? size : 1, align);
+#else
+    void* memory = std::aligned_alloc(align, (size + align - 1) / align * align + (size ? 0 : align));
+#endif
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept {
+    operator delete(memory, alignment);
+}
+
+namespace Checks
+{
+    std::vector<Entry>& registry() {
+        static std::vector<Entry> entries;
+        return entries;
+    }
+
+    void fail(const char* expression, const char* file, int line) {
+        throw Failure(std::string(file) + ":" + std::to_string(line) + ": expected " + expression);
+    }
+
+    int run(std::string_view filter, std::ostream& out) {
+        size_t ran = 0, failed = 0;
+        for (const auto& entry : registry()) {
+            if (!filter.empty() && std::string_view(entry.name).find(filter) == std::string_view::npos)
+                continue;
+            ++ran;
+            try {
+                entry.function();
+                out << "ok      " << entry.name << std::endl;
+                continue;
+            }
+            catch (const Failure& failure) {
+                out << "FAILED  " << entry.name << "\n    " << failure.what() << std::endl;
+            }
+            catch (const std::exception& exception) {
+                out << "FAILED  " << entry.name << "\n    unexpected exception: " << exception.what() << std::endl;
+            }
+            ++failed;
+        }
+        if (ran == 0) {
+            out << "No checks match \"" << filter << "\"" << std::endl;
+            return 1;
+        }
+        out << ran - failed << " of " << ran << " checks passed" << std::endl;
+        return failed ? 1 : 0;
+    }
+
+    AlignedAllocationFailure::AlignedAllocationFailure() : m_failuresBefore(s_refusedAllocations.load()) {
+        s_failingScopes.fetch_add(1);
+    }
+
+    AlignedAllocationFailure::~AlignedAllocationFailure() {
+        s_failingScopes.fetch_sub(1);
+    }
+
+    size_t AlignedAllocationFailure::failures() const {
+        return s_refusedAllocations.load() - m_failuresBefore;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+// Tiny registry of behavior checks for the test executable, run with "--check [filter]".
+// A failed COMMON_API_EXPECT ends its check and is reported with its location, the other checks still run.
+namespace Checks
+{
+    using Function = void(*)();
+
+    struct Entry {
+        const char* name;
+        Function function;
+    };
+
+    std::vector<Entry>& registry();
+
+    struct Registrar {
+        Registrar(const char* name, Function function) {
+            registry().push_back(Entry{ name, function });
+        }
+    };
+
+    struct Failure : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    [[noreturn]] void fail(const char* expression, const char* file, int line);
+
+    // Runs every registered check whose name contains filter (all if empty), 1 if any of them failed
+    int run(std::string_view filter, std::ostream& out);
+
+    // While one is alive, aligned operator new throws std::bad_alloc on every thread. SlotPool and the
+    // MemoryPool slabs allocate through it, so their growth fails as it would once memory runs out.
+    class AlignedAllocationFailure {
+    public:
+        AlignedAllocationFailure();
+        ~AlignedAllocationFailure();
+
+        AlignedAllocationFailure(const AlignedAllocationFailure&) = delete;
+        AlignedAllocationFailure& operator=(const AlignedAllocationFailure&) = delete;
+
+        // Allocations refused since construction
+        size_t failures() const;
+
+    private:
+        size_t m_failuresBefore;
+    };
+}
+
+#define COMMON_API_CHECK(name) \
+    static void name(); \
+    static const ::Checks::Registrar name##Registrar(#name, &name); \
+    static void name()
+
+#define COMMON_API_EXPECT(condition) \
+    do { if (!(condition)) ::Checks::fail(#condition, __FILE__, __LINE__); } while (false)
+
+// Expects statement to throw Exception
+#define COMMON_API_EXPECT_THROW(statement, Exception) \
+    do { \
+        bool thrown = false; \
+        try { statement; } catch (const Exception&) { thrown = true; } \
+        if (!thrown) ::Checks::fail(#statement " throws " #Exception, __FILE__, __LINE__); \
+    } while (false)
@@ -0,0 +1,76 @@
+#include "Check.h"
+
+#include "CommonApi/MultiThreading/MemoryPool.h"
+#include "CommonApi/MultiThreading/Queue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::atomic<int64_t> s_liveItems = 0;
+
+    // Written twice apart so that a slot handed out to two owners at once shows up as a torn stamp
+    struct Item {
+        uint64_t stamp;
+        uint64_t padding[4];
+        uint64_t check;
+
+        Item(uint64_t stamp) : stamp(stamp), padding{}, check(~stamp) { s_liveItems.fetch_add(1); }
+        ~Item() { s_liveItems.fetch_sub(1); }
+    };
+
+    constexpr size_t s_threadCount = 4;
+    constexpr size_t s_itemsPerThread = 20000;
+}
+
+// Objects allocated on one thread are freed on another, through the magazines and the shared stack,
+// while every thread keeps allocating. No slot is live twice and every object is destroyed once.
+COMMON_API_CHECK(MemoryPoolCrossThreadFree)
+{
+    using Pool = MultiThreading::MemoryPool<Item>;
+    {
+        Pool pool(Pool::SlabOptions{ 256, 256, 1 });
+        std::vector<MultiThreading::Queue<Pool::SharedPointer>> mailboxes(s_threadCount);
+        std::atomic<size_t> torn = 0, received = 0;
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < s_threadCount; ++t)
+            threads.emplace_back([&, t]() {
+                std::vector<Pool::SharedPointer> kept;
+                for (uint64_t i = 0; i < s_itemsPerThread; ++i) {
+                    Pool::SharedPointer item = pool.makeShared(uint64_t(t) << 32 | i);
+                    if (i % 4 == 0) kept.push_back(item);
+                    mailboxes[(t + 1) % s_threadCount].push(std::move(item));
+                    if (kept.size() > 64) kept.clear();
+
+                    Pool::SharedPointer incoming;
+                    while (mailboxes[t].pop(incoming)) {
+                        if (incoming->check != ~incoming->stamp) torn.fetch_add(1);
+                        received.fetch_add(1);
+                        incoming = nullptr;
+                    }
+                }
+            });
+        for (auto& thread : threads) thread.join();
+
+        Pool::SharedPointer incoming;
+        for (auto& mailbox : mailboxes)
+            while (mailbox.pop(incoming)) {
+                if (incoming->check != ~incoming->stamp) torn.fetch_add(1);
+                received.fetch_add(1);
+                incoming = nullptr;
+            }
+        COMMON_API_EXPECT(torn == 0);
+        COMMON_API_EXPECT(received == s_threadCount * s_itemsPerThread);
+        COMMON_API_EXPECT(s_liveItems == 0);
+
+        // Everything went back to the free lists, so a fresh batch fits without new slabs
+        size_t slabs = pool.getSlabCount();
+        std::vector<Pool::UniquePointer> again = pool.makeUniqueN(1000, uint64_t(1));
+        COMMON_API_EXPECT(again.size() == 1000 && pool.getSlabCount() == slabs);
+    }
+    COMMON_API_EXPECT(s_liveItems == 0);
+}
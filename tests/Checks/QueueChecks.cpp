@@ -0,0 +1,109 @@
+#include "Check.h"
+
+#include "CommonApi/MultiThreading/BlockingBoundedQueue.h"
+#include "CommonApi/MultiThreading/BoundedQueue.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr size_t s_producerCount = 4;
+    constexpr size_t s_consumerCount = 4;
+    constexpr size_t s_itemsPerProducer = 50000;
+    constexpr size_t s_batchSize = 8;
+}
+
+// Producers and consumers mix single and batched calls on a small queue, every item comes out exactly once
+COMMON_API_CHECK(BoundedQueueConservation)
+{
+    constexpr size_t itemCount = s_producerCount * s_itemsPerProducer;
+    MultiThreading::BoundedQueue<uint64_t> queue(64);
+    auto seen = std::make_unique<std::atomic<uint8_t>[]>(itemCount);
+    std::atomic<size_t> popped = 0;
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < s_producerCount; ++p)
+        threads.emplace_back([&, p]() {
+            uint64_t next = p * s_itemsPerProducer, end = next + s_itemsPerProducer;
+            while (next < end) {
+                if (next % 3 == 0) {
+                    std::array<uint64_t, s_batchSize> items;
+                    size_t count = std::min<size_t>(s_batchSize, end - next);
+                    for (size_t i = 0; i < count; ++i) items[i] = next + i;
+                    size_t pushed = queue.pushN(items.begin(), count);
+                    next += pushed;
+                    if (pushed == 0) std::this_thread::yield();
+                }
+                else if (queue.tryPush(next)) ++next;
+                else std::this_thread::yield();
+            }
+        });
+    for (size_t c = 0; c < s_consumerCount; ++c)
+        threads.emplace_back([&, c]() {
+            std::array<uint64_t, s_batchSize> items;
+            while (popped.load(std::memory_order_relaxed) < itemCount) {
+                size_t count = c % 2 ? queue.popN(items.begin(), items.size()) : queue.tryPop(items[0]) ? 1 : 0;
+                for (size_t i = 0; i < count; ++i) seen[items[i]].fetch_add(1, std::memory_order_relaxed);
+                if (count == 0) std::this_thread::yield();
+                popped.fetch_add(count, std::memory_order_relaxed);
+            }
+        });
+    for (auto& thread : threads) thread.join();
+
+    size_t wrong = 0;
+    for (size_t i = 0; i < itemCount; ++i) wrong += seen[i].load() != 1;
+    COMMON_API_EXPECT(popped == itemCount);
+    COMMON_API_EXPECT(wrong == 0);
+    COMMON_API_EXPECT(queue.emptyApprox());
+}
+
+// close() wakes blocked producers and consumers, everything a push accepted is still popped
+COMMON_API_CHECK(BlockingBoundedQueueClose)
+{
+    for (int round = 0; round < 10; ++round) {
+        MultiThreading::BlockingBoundedQueue<uint64_t> queue(8);
+        std::atomic<uint64_t> pushedSum = 0, poppedSum = 0;
+
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < s_producerCount; ++p)
+            threads.emplace_back([&]() {
+                std::array<uint64_t, 5> items = { 1, 2, 3, 4, 5 };
+                for (uint64_t i = 1;; ++i) {
+                    if (i % 4 == 0) {
+                        size_t count = queue.pushN(items.begin(), items.size());
+                        for (size_t k = 0; k < count; ++k) pushedSum += items[k];
+                        if (count < items.size()) return;
+                    }
+                    else if (queue.push(i)) pushedSum += i;
+                    else return;
+                }
+            });
+        for (size_t c = 0; c < s_consumerCount; ++c)
+            threads.emplace_back([&, c]() {
+                std::array<uint64_t, 3> items;
+                for (;;) {
+                    if (c % 2) {
+                        if (!queue.pop(items[0])) return;
+                        poppedSum += items[0];
+                    }
+                    else {
+                        size_t count = queue.popN(items.begin(), items.size());
+                        if (count == 0) return;
+                        for (size_t k = 0; k < count; ++k) poppedSum += items[k];
+                    }
+                }
+            });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(round % 3 == 0 ? 1 : 5));
+        queue.close();
+        for (auto& thread : threads) thread.join();
+        COMMON_API_EXPECT(pushedSum == poppedSum);
+        COMMON_API_EXPECT(!queue.push(1));
+    }
+}
@@ -0,0 +1,314 @@
+#include "Check.h"
+
+#include "CommonApi/MultiThreading/ThreadPools/Coroutine.h"
+#include "CommonApi/MultiThreading/ThreadPools/MinimalThreadPool.h"
+#include "CommonApi/MultiThreading/ThreadPools/Parallel.h"
+#include "CommonApi/MultiThreading/ThreadPools/TaskGraph.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Pool = MultiThreading::MinimalThreadPool;
+
+    constexpr Pool::SchedulerMode s_modes[] = { Pool::SchedulerMode::GlobalQueue, Pool::SchedulerMode::WorkStealing };
+
+    // Holds count task slots in timers that never fall due, with AlignedAllocationFailure the pool
+    // then runs out of slots once the rest are taken
+    std::vector<Pool::TimerHandle> parkTaskSlots(Pool& pool, size_t count) {
+        std::vector<Pool::TimerHandle> timers;
+        for (size_t i = 0; i < count; ++i) timers.push_back(pool.scheduleAfter(std::chrono::hours(1), []() {}));
+        return timers;
+    }
+
+    void releaseTaskSlots(Pool& pool, const std::vector<Pool::TimerHandle>& timers) {
+        for (auto timer : timers) pool.cancelTimer(timer);
+    }
+
+    MultiThreading::Task<void> offloadAndRecord(Pool& home, Pool& blocking, std::atomic<bool>& offloaded,
+        std::atomic<bool>& gate, std::atomic<Pool*>& resumedOn) {
+        co_await home.schedule();
+        co_await MultiThreading::offload(blocking, [&]() {
+            offloaded = true;
+            while (!gate) std::this_thread::yield();
+            });
+        resumedOn = Pool::getCurrentPool();
+    }
+}
+
+// Every push returns the submission lock owned, so it chains into waitIdle and the other Lock&& calls,
+// also from a worker pushing into its own deque, and holding lock() holds pushTask back
+COMMON_API_CHECK(ThreadPoolLockChaining)
+{
+    for (auto mode : s_modes) {
+        Pool pool;
+        pool.init(2, std::cerr, Pool::Options{ .schedulerMode = mode });
+        std::atomic<size_t> ran = 0;
+
+        Pool::Lock lock = pool.pushTask([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            ran.fetch_add(1);
+        });
+        COMMON_API_EXPECT(lock.isLocked());
+        lock = pool.waitIdle(std::move(lock));
+        COMMON_API_EXPECT(lock.isLocked() && ran == 1);
+        lock = pool.pushTasks(std::vector<std::function<void()>>(8, [&]() { ran.fetch_add(1); }), std::move(lock));
+        lock = pool.waitIdle(std::move(lock));
+        COMMON_API_EXPECT(lock.isLocked() && ran == 9);
+        lock.unlock();
+
+        std::atomic<bool> owned = false;
+        pool.postTask([&]() {
+            Pool::Lock inner = pool.pushTask([&]() { ran.fetch_add(1); });
+            size_t threads = 0;
+            inner = pool.size(threads, std::move(inner));
+            owned = inner.isLocked() && threads == 2;
+        });
+        pool.waitIdle();
+        COMMON_API_EXPECT(owned && ran == 10);
+
+        std::atomic<bool> pushed = false;
+        {
+            Pool::Lock held = pool.lock();
+            std::thread producer([&]() {
+                pool.pushTask([&]() { ran.fetch_add(1); });
+                pushed = true;
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            COMMON_API_EXPECT(!pushed);
+            held.unlock();
+            producer.join();
+        }
+        pool.waitIdle();
+        COMMON_API_EXPECT(ran == 11);
+
+        // Calls taking a Lock lock an unowned one themselves
+        lock = pool.waitIdle(Pool::Lock());
+        COMMON_API_EXPECT(lock.isLocked());
+    }
+}
+
+// Producers keep pushing and posting while init replaces the priority levels, every task that was
+// accepted runs exactly once and pushes to a level that disappeared throw std::out_of_range
+COMMON_API_CHECK(ThreadPoolInitRacingProducers)
+{
+    for (auto mode : s_modes) {
+        Pool pool;
+        Pool::Options options{ .schedulerMode = mode, .taskSlotCapacity = 64 };
+        pool.init(2, std::cerr, options);
+        std::atomic<size_t> ran = 0, accepted = 0;
+        std::atomic<bool> stop = false;
+
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < 4; ++p)
+            producers.emplace_back([&, p]() {
+                std::vector<std::function<void()>> batch(16, [&]() { ran.fetch_add(1, std::memory_order_relaxed); });
+                for (size_t i = 0; !stop.load(); ++i) {
+                    try {
+                        size_t priority = (i + p) % 3;
+                        if (i % 3 == 0) {
+                            if (p % 2) pool.pushTasks(batch, i % 2);
+                            else pool.postTasks(batch, i % 2);
+                            accepted.fetch_add(batch.size());
+                        }
+                        else {
+                            auto task = [&]() { ran.fetch_add(1, std::memory_order_relaxed); };
+                            if (p % 2) pool.pushTask(task, priority);
+                            else pool.postTask(task, priority);
+                            accepted.fetch_add(1);
+                        }
+                    }
+                    catch (const std::out_of_range&) {}
+                }
+            });
+
+        for (size_t round = 0; round < 10; ++round) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            options.priorityLevelCount = 2 + round % 2;
+            pool.init(2, std::cerr, options);
+        }
+        stop = true;
+        for (auto& producer : producers) producer.join();
+        pool.waitIdle();
+        COMMON_API_EXPECT(ran == accepted);
+    }
+}
+
+// submit hands back references, move-only values and the task's exception
+COMMON_API_CHECK(ThreadPoolSubmitResults)
+{
+    Pool pool;
+    pool.init(2, std::cerr);
+
+    int value = 1;
+    int& reference = pool.submit([&]() -> int& { return value; }).get();
+    COMMON_API_EXPECT(&reference == &value);
+
+    std::string text = "text";
+    const std::string& constReference = pool.submit([&]() -> const std::string& { return text; }).get();
+    COMMON_API_EXPECT(&constReference == &text);
+
+    auto owner = std::make_unique<int>(7);
+    std::unique_ptr<int> taken = std::move(pool.submit([&]() -> std::unique_ptr<int>&& { return std::move(owner); }).get());
+    COMMON_API_EXPECT(taken && *taken == 7 && !owner);
+
+    COMMON_API_EXPECT(*pool.submit([]() { return std::make_unique<int>(3); }).get() == 3);
+    pool.submit([]() {}).get();
+
+    auto thrower = pool.submit([&]() -> int& { throw std::logic_error("task failed"); });
+    COMMON_API_EXPECT_THROW(thrower.get(), std::logic_error);
+}
+
+// Without workers, submission and the helpers built on it throw instead of waiting forever
+COMMON_API_CHECK(ThreadPoolNotInitialized)
+{
+    Pool pool;
+    COMMON_API_EXPECT_THROW(pool.pushTask([]() {}), std::runtime_error);
+    COMMON_API_EXPECT_THROW(pool.postTask([]() {}), std::runtime_error);
+    COMMON_API_EXPECT_THROW(pool.submit([]() { return 1; }), std::runtime_error);
+    COMMON_API_EXPECT_THROW(MultiThreading::parallelFor(pool, 0, 100, [](size_t, size_t) {}), std::runtime_error);
+
+    MultiThreading::TaskGraph graph;
+    graph.addNode([]() {});
+    COMMON_API_EXPECT_THROW(graph.run(pool), std::runtime_error);
+
+    pool.init(2, std::cerr);
+    int sum = MultiThreading::parallelReduce(pool, 0, 100, 0,
+        [](size_t i, size_t) { return static_cast<int>(i); }, [](int a, int b) { return a + b; });
+    COMMON_API_EXPECT(sum == 4950);
+    pool.destroy();
+    COMMON_API_EXPECT_THROW(MultiThreading::parallelFor(pool, 0, 100, [](size_t, size_t) {}), std::runtime_error);
+}
+
+// When the pool cannot take another task a parallel loop keeps the half it failed to hand out, every
+// index still runs once, and with no slot for the first task the call throws instead of waiting forever
+COMMON_API_CHECK(ParallelForTaskSlotExhaustion)
+{
+    for (auto mode : s_modes) {
+        Pool pool;
+        pool.init(2, std::cerr, Pool::Options{ .schedulerMode = mode, .taskSlotCapacity = 64 });
+        std::vector<Pool::TimerHandle> parked = parkTaskSlots(pool, 63);
+
+        constexpr size_t count = 4096;
+        auto visits = std::make_unique<std::atomic<uint32_t>[]>(count);
+        size_t refused = 0;
+        {
+            Checks::AlignedAllocationFailure failing;
+            MultiThreading::parallelFor(pool, 0, count, 1, [&](size_t i, size_t) { visits[i].fetch_add(1); });
+            refused = failing.failures();
+        }
+        size_t wrong = 0;
+        for (size_t i = 0; i < count; ++i) wrong += visits[i].load() != 1;
+        COMMON_API_EXPECT(refused > 0);
+        COMMON_API_EXPECT(wrong == 0);
+
+        // The loop's tasks may still be giving their slots back, parking the last one before would grow the pool
+        pool.waitIdle();
+        std::vector<Pool::TimerHandle> last = parkTaskSlots(pool, 1);
+        {
+            Checks::AlignedAllocationFailure failing;
+            COMMON_API_EXPECT_THROW(MultiThreading::parallelFor(pool, 0, count, [](size_t, size_t) {}), std::bad_alloc);
+        }
+        releaseTaskSlots(pool, last);
+        releaseTaskSlots(pool, parked);
+        pool.waitIdle();
+    }
+}
+
+// A node the pool cannot take fails the run with the pool's exception instead of leaving it waiting,
+// the nodes behind it are skipped and the graph runs normally again afterwards
+COMMON_API_CHECK(TaskGraphTaskSlotExhaustion)
+{
+    for (auto mode : s_modes) {
+        Pool pool;
+        pool.init(2, std::cerr, Pool::Options{ .schedulerMode = mode, .taskSlotCapacity = 64 });
+
+        std::atomic<size_t> ran = 0;
+        MultiThreading::TaskGraph graph;
+        auto root = graph.addNode([&]() { ran.fetch_add(1); });
+        auto join = graph.addNode([&]() { ran.fetch_add(1); });
+        for (size_t i = 0; i < 32; ++i) {
+            auto branch = graph.addNode([&]() { ran.fetch_add(1); });
+            graph.addDependency(root, branch);
+            graph.addDependency(branch, join);
+        }
+
+        std::vector<Pool::TimerHandle> parked = parkTaskSlots(pool, 63);
+        {
+            Checks::AlignedAllocationFailure failing;
+            COMMON_API_EXPECT_THROW(graph.run(pool), std::bad_alloc);
+        }
+        COMMON_API_EXPECT(ran == 1);
+        pool.waitIdle();
+        releaseTaskSlots(pool, parked);
+
+        ran = 0;
+        graph.run(pool);
+        COMMON_API_EXPECT(ran == graph.size());
+    }
+}
+
+// A periodic firing the pool cannot take a slot for is reported and skipped, the timer thread keeps
+// going and the timer runs again once slots are back
+COMMON_API_CHECK(TimerTaskSlotExhaustion)
+{
+    Pool pool;
+    std::ostringstream errors;
+    pool.init(2, errors, Pool::Options{ .taskSlotCapacity = 64 });
+    std::vector<Pool::TimerHandle> parked = parkTaskSlots(pool, 64);
+
+    std::atomic<size_t> ran = 0;
+    Pool::TimerHandle periodic;
+    {
+        Checks::AlignedAllocationFailure failing;
+        periodic = pool.scheduleEvery(std::chrono::milliseconds(1), [&]() { ran.fetch_add(1); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        COMMON_API_EXPECT(failing.failures() > 0);
+    }
+    COMMON_API_EXPECT(ran == 0);
+    {
+        auto lock = pool.lock();
+        COMMON_API_EXPECT(errors.str().find("Timer: ") != std::string::npos);
+    }
+
+    releaseTaskSlots(pool, parked);
+    for (int i = 0; i < 2000 && ran == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    COMMON_API_EXPECT(ran > 0);
+    pool.cancelTimer(periodic);
+    pool.waitIdle();
+}
+
+// When the awaiting coroutine's pool can not take it back, offload continues it on the worker that ran
+// the callable instead of dropping it
+COMMON_API_CHECK(OffloadHomeExhaustion)
+{
+    Pool home, blocking;
+    home.init(2, std::cerr, Pool::Options{ .taskSlotCapacity = 64 });
+    blocking.init(1, std::cerr);
+
+    std::atomic<bool> offloaded = false, gate = false;
+    std::atomic<Pool*> resumedOn = nullptr;
+    MultiThreading::spawn(home, offloadAndRecord(home, blocking, offloaded, gate, resumedOn));
+    while (!offloaded) std::this_thread::yield();
+    home.waitIdle();
+    std::vector<Pool::TimerHandle> parked = parkTaskSlots(home, 64);
+    {
+        Checks::AlignedAllocationFailure failing;
+        gate = true;
+        for (int i = 0; i < 2000 && !resumedOn; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        COMMON_API_EXPECT(failing.failures() > 0);
+    }
+    COMMON_API_EXPECT(resumedOn == &blocking);
+    blocking.waitIdle();
+    releaseTaskSlots(home, parked);
+}
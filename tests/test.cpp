@@ -124,9 +124,19 @@ public:
 #include "CommonApi/PlatformAbstractions/Console.h"
 #include "CommonApi/PlatformAbstractions/Thread.h"
 
+#include "Benchmarks/Benchmark.h"
+#include "Checks/Check.h"
+
+#include <string_view>
+
 static inline auto& console = MT::Console::getInstance();
 
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string_view(argv[1]) == "--bench")
+        return Benchmarks::run(argc > 2 ? argv[2] : "", std::cout);
+    if (argc > 1 && std::string_view(argv[1]) == "--check")
+        return Checks::run(argc > 2 ? argv[2] : "", std::cout);
+
     MultiThreading::MinimalThreadPool threadPool;
     threadPool.init(16, std::cerr);
 